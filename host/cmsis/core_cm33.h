@@ -0,0 +1,57 @@
+/**
+ * @file core_cm33.h
+ * @brief host stand-in for the CMSIS Cortex-M33 core header
+ *
+ * stm32h563.h includes <core_cm33.h>. The host build puts this directory in front of the real
+ * CMSIS headers, so the device header can be used for its register layouts and bit definitions
+ * without pulling in the ARM inline assembly.
+ */
+#ifndef CORE_CM33_HOST_H
+#define CORE_CM33_HOST_H
+
+#include <stdint.h>
+
+#define __I     volatile const
+#define __O     volatile
+#define __IO    volatile
+#define __IM    volatile const
+#define __OM    volatile
+#define __IOM   volatile
+
+#define __USED                  __attribute__((used))
+#define __STATIC_INLINE         static inline
+#define __STATIC_FORCEINLINE    static inline __attribute__((always_inline))
+
+// there are no interrupts on the host, the primask is only kept for the sake of the driver code
+extern uint32_t hostCore_primask;
+
+__STATIC_INLINE uint32_t __get_PRIMASK(void)            { return hostCore_primask; }
+__STATIC_INLINE void __set_PRIMASK(uint32_t priMask)    { hostCore_primask = priMask; }
+__STATIC_INLINE void __disable_irq(void)                { hostCore_primask = 1; }
+__STATIC_INLINE void __enable_irq(void)                 { hostCore_primask = 0; }
+
+// interrupts are raised by the flash emulator calling the handlers, the NVIC has nothing to do
+__STATIC_INLINE void NVIC_EnableIRQ(IRQn_Type IRQn)                     { (void) IRQn; }
+__STATIC_INLINE void NVIC_DisableIRQ(IRQn_Type IRQn)                    { (void) IRQn; }
+__STATIC_INLINE void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority) { (void) IRQn; (void) priority; }
+
+// the host has no MPU, region setup is accepted and ignored
+#define MPU_CTRL_PRIVDEFENA_Msk                 (1UL << 2U)
+#define ARM_MPU_ATTR_NON_CACHEABLE              (4U)
+#define ARM_MPU_SH_NON                          (0U)
+#define ARM_MPU_ATTR_MEMORY_(NT, WB, RA, WA)    ((((NT) & 1U) << 3U) | (((WB) & 1U) << 2U) | (((RA) & 1U) << 1U) | ((WA) & 1U))
+#define ARM_MPU_ATTR(O, I)                      ((((O) & 0xFU) << 4U) | ((I) & 0xFU))
+#define ARM_MPU_RBAR(BASE, SH, RO, NP, XN)      ((BASE) & ~0x1FUL)
+#define ARM_MPU_RLAR(LIMIT, IDX)                (((LIMIT) & ~0x1FUL) | ((IDX) << 1U) | 1U)
+
+__STATIC_INLINE void ARM_MPU_SetMemAttr(uint8_t idx, uint8_t attr)                 { (void) idx; (void) attr; }
+__STATIC_INLINE void ARM_MPU_SetRegion(uint32_t rnr, uint32_t rbar, uint32_t rlar)  { (void) rnr; (void) rbar; (void) rlar; }
+__STATIC_INLINE void ARM_MPU_Enable(uint32_t MPU_Control)                           { (void) MPU_Control; }
+__STATIC_INLINE void ARM_MPU_Disable(void)                                          {}
+
+#define __DSB()     __sync_synchronize()
+#define __DMB()     __sync_synchronize()
+#define __ISB()     __sync_synchronize()
+#define __NOP()     ((void) 0)
+
+#endif // CORE_CM33_HOST_H
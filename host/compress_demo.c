@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <string.h>
+#include "hc_compress.h"
+
+/*payloads compressed into a record store in the eight high cyclic sectors of bank 2*/
+#define COMPRESS_SECTORS    8
+#define COMPRESS_KEYS       4
+#define COMPRESS_FUZZ       2000
+
+static hcStore_t store;
+static hcCompress_t compress;
+static uint32_t failures;
+static uint32_t seed = 12345;
+
+static void expect(const char* what, const bool ok)
+{
+    printf("%-48s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok)
+    {
+        failures++;
+    }
+}
+
+static uint32_t randomNumber(void)
+{
+    seed = seed * 1103515245UL + 12345UL;
+    return seed >> 8;
+}
+
+/**
+ * @brief write a payload, read it back and compare
+ *
+ * @return true if the payload came back unchanged
+ */
+static bool roundTrip(const uint16_t key, const uint8_t* data, const uint16_t length)
+{
+    uint8_t buffer[HCCOMPRESS_MAX_LENGTH];
+    uint16_t read;
+    return !hcCompress_write(&compress, &store, key, data, length) &&
+           !hcCompress_read(&compress, &store, key, buffer, sizeof(buffer), &read) &&
+           read == length && memcmp(buffer, data, length) == 0;
+}
+
+/**
+ * @brief round trip a payload in a fresh compressor and print its ratio
+ *
+ * @return the bytes stored per 1000 bytes of payload
+ */
+static uint32_t measure(const char* name, const uint8_t* data, const uint16_t length)
+{
+    char what[64];
+    hcCompress_init(&compress);
+    snprintf(what, sizeof(what), "%s round trip", name);
+    expect(what, roundTrip(1, data, length));
+    uint32_t permille = hcCompress_getPermille(&compress);
+    printf("%-32s %4u bytes  %4u permille\n", name, (unsigned) length, (unsigned) permille);
+    return permille;
+}
+
+/**
+ * @brief round trip typical and adversarial payloads and print the compression ratio of each
+ *
+ * @return 0 if every check passed, 1 otherwise
+ */
+int main(void)
+{
+    if (flashEmu_init())
+    {
+        return 1;
+    }
+    highCyclic_setArea(8, 8);
+    if (hcStore_mount(&store, 2, HIGH_CYCLIC_PAGE_OFFSET, COMPRESS_SECTORS))
+    {
+        return 1;
+    }
+
+    uint8_t data[HCCOMPRESS_MAX_LENGTH];
+    uint16_t length = 0;
+    while (length < sizeof(data) - 40)
+    {
+        length += (uint16_t) snprintf((char*) data + length, sizeof(data) - length,
+                                      "t=%05u temp=%d.%u state=RUN\n", (unsigned) length * 7,
+                                      20 + length % 5, (unsigned) length % 10);
+    }
+    expect("text shrinks", measure("log text", data, length) < 700);
+
+    memset(data, 0, sizeof(data));
+    expect("zeros shrink", measure("zeros", data, sizeof(data)) < 100);
+
+    for (uint32_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = (uint8_t) randomNumber();
+    }
+    expect("random bytes are stored", measure("random", data, sizeof(data)) <= 1000 + 2000 / sizeof(data));
+
+    for (uint32_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = (uint8_t) (i % 7 == 0 ? randomNumber() : i / 16);
+    }
+    measure("counter with noise", data, sizeof(data));
+
+    // payloads of any length from a small alphabet with repeats, across keys so the store reclaims
+    hcCompress_init(&compress);
+    uint32_t wrong = 0;
+    uint16_t size = 0;
+    for (uint32_t i = 0; i < COMPRESS_FUZZ; i++)
+    {
+        size = (uint16_t) (randomNumber() % (HCCOMPRESS_MAX_LENGTH + 1));
+        uint32_t alphabet = 1 + randomNumber() % 64;
+        for (uint32_t j = 0; j < size; j++)
+        {
+            bool repeat = j >= 8 && randomNumber() % 4 == 0;
+            data[j] = repeat ? data[j - 1 - randomNumber() % (j < 300 ? j : 300)] : (uint8_t) (randomNumber() % alphabet);
+        }
+        wrong += !roundTrip((uint16_t) (1 + i % COMPRESS_KEYS), data, size);
+    }
+    printf("fuzz: %u payloads, %u mismatches, %u permille\n", COMPRESS_FUZZ, (unsigned) wrong,
+           (unsigned) hcCompress_getPermille(&compress));
+    expect("fuzzed payloads round trip", wrong == 0);
+
+    // the newest payloads survive a restart
+    uint8_t buffer[HCCOMPRESS_MAX_LENGTH];
+    uint16_t read;
+    flashEmu_powerCycle();
+    expect("remount", !hcStore_mount(&store, 2, HIGH_CYCLIC_PAGE_OFFSET, COMPRESS_SECTORS));
+    expect("last payload decodes after a restart",
+           !hcCompress_read(&compress, &store, 1 + (COMPRESS_FUZZ - 1) % COMPRESS_KEYS, buffer, sizeof(buffer), &read) &&
+           read == size && memcmp(buffer, data, size) == 0);
+    return failures != 0;
+}
@@ -0,0 +1,61 @@
+#include <stdio.h>
+#include <string.h>
+#include "flash_crc.h"
+#include "flash.h"
+
+/*the check input of the CRC catalogue, both CRCs are listed with their result for it*/
+static const char check[] = "123456789";
+
+static uint32_t failures;
+
+static void expect(const char* what, const bool ok)
+{
+    printf("%-48s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok)
+    {
+        failures++;
+    }
+}
+
+/**
+ * @brief check the CRCs against their catalogue values and verify a write in the emulated flash
+ *
+ * @return 0 if every check passed, 1 otherwise
+ */
+int main(void)
+{
+    if (flashEmu_init())
+    {
+        return 1;
+    }
+    highCyclic_setArea(8, 8);
+
+    expect("CRC-16/CCITT-FALSE of \"123456789\" is 0x29B1", flashCrc_crc16(FLASH_CRC16_INIT, check, 9) == 0x29B1);
+    expect("CRC-32/ISO-HDLC of \"123456789\" is 0xCBF43926", flashCrc_crc32(FLASH_CRC32_INIT, check, 9) == 0xCBF43926UL);
+
+    // a CRC continued over a split input equals the one over the whole input
+    uint16_t crc16 = flashCrc_crc16(FLASH_CRC16_INIT, check, 4);
+    expect("CRC-16 chained over 4 + 5 bytes", flashCrc_crc16(crc16, check + 4, 5) == 0x29B1);
+    uint32_t crc32 = flashCrc_crc32(FLASH_CRC32_INIT, check, 4);
+    expect("CRC-32 chained over 4 + 5 bytes", flashCrc_crc32(crc32, check + 4, 5) == 0xCBF43926UL);
+
+    // unaligned start and a size that is no multiple of a word, as fed to the unit by bytes and words
+    uint8_t buffer[1000];
+    for (uint32_t i = 0; i < sizeof(buffer); i++)
+    {
+        buffer[i] = (uint8_t) (i * 7 + 3);
+    }
+    uint32_t dmaCrc;
+    expect("DMA-fed CRC-32 started", !flashCrc_crc32Dma(FLASH_CRC32_INIT, buffer + 1, sizeof(buffer) - 3));
+    expect("DMA-fed CRC-32 equals the software CRC-32",
+           !flashCrc_crc32Wait(&dmaCrc) && dmaCrc == flashCrc_crc32Software(FLASH_CRC32_INIT, buffer + 1, sizeof(buffer) - 3));
+    expect("DMA-fed CRC-32 of high cyclic memory refused", flashCrc_crc32Dma(FLASH_CRC32_INIT, (const void*) HIGH_CYCLIC_START_BANK2, 16));
+
+    uint16_t* target = (uint16_t*) HIGH_CYCLIC_START_BANK2;
+    expect("erase high cyclic sector", !flash_erase(2, HIGH_CYCLIC_PAGE_OFFSET));
+    expect("write verified", !flashCrc_writeVerified(target, buffer, 64));
+    expect("verify against another CRC fails", flashCrc_verify(target, 64, flashCrc_crc32(FLASH_CRC32_INIT, buffer + 2, 64)));
+    expect("verify of virgin cells fails", flashCrc_verify(target + 32, 64, flashCrc_crc32(FLASH_CRC32_INIT, buffer, 64)));
+
+    return failures != 0;
+}
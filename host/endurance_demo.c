@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <time.h>
+#include <string.h>
+#include "flash.h"
+#include "flash_ecc.h"
+#include "flash_profile.h"
+#include "hc_counter.h"
+#include "hc_slot.h"
+#include "hc_store.h"
+
+/*updates of the four half-word record of TEST2 in main.c*/
+#define RECORD_WORDS        4
+#define RECORD_SIZE         (RECORD_WORDS * 2)
+#define UPDATES             1000000UL
+#define UPDATES_PER_DAY     (24 * 3600UL)
+
+/**
+ * @brief TEST2: erase the sector and rewrite the record for every update
+ */
+static void updateInPlace(const uint32_t update)
+{
+    flash_erase(2, HIGH_CYCLIC_PAGE_OFFSET);
+    for (uint32_t i = 0; i < RECORD_WORDS; i++)
+    {
+        flash_write16((uint16_t*) (HIGH_CYCLIC_START_BANK2 + 2 * i), (uint16_t) (update + i), 2);
+    }
+}
+
+/**
+ * @brief append every update behind the previous one over all sectors of bank 2, erase on wrap
+ */
+static void updateAppend(const uint32_t update)
+{
+    const uint32_t slotsPerSector = HIGH_CYCLIC_SECTOR_SIZE / RECORD_SIZE;
+    uint32_t slot = update % (8 * slotsPerSector);
+    uint32_t sector = slot / slotsPerSector;
+    if (slot % slotsPerSector == 0)
+    {
+        flash_erase(2, HIGH_CYCLIC_PAGE_OFFSET + sector);
+    }
+
+    uint32_t address = HIGH_CYCLIC_START_BANK2 + slot * RECORD_SIZE;
+    for (uint32_t i = 0; i < RECORD_WORDS; i++)
+    {
+        flash_write16((uint16_t*) (address + 2 * i), (uint16_t) (update + i), 2);
+    }
+}
+
+/**
+ * @brief program every update into the next erased slot of two sectors, erase a sector once it is full
+ */
+static void updateSlots(const uint32_t update)
+{
+    static hcSlot_t slot;
+    uint16_t record[RECORD_WORDS];
+    if (update == 0)
+    {
+        hcSlot_open(&slot, 2, HIGH_CYCLIC_PAGE_OFFSET, RECORD_SIZE);
+    }
+    for (uint32_t i = 0; i < RECORD_WORDS; i++)
+    {
+        record[i] = (uint16_t) (update + i);
+    }
+    hcSlot_write(&slot, record);
+}
+
+/**
+ * @brief count every update by one in a counter over two sectors
+ */
+static void updateCounter(const uint32_t update)
+{
+    static hcCounter_t counter;
+    if (update == 0)
+    {
+        hcCounter_open(&counter, 2, HIGH_CYCLIC_PAGE_OFFSET, 2);
+    }
+    hcCounter_add(&counter, 1);
+}
+
+static void run(const char* name, void (*update)(const uint32_t), const uint32_t userBytes)
+{
+    const flashEmu_wearModel_t model = FLASH_EMU_WEAR_DEFAULT;
+    flashEmu_wearReport_t report;
+    struct timespec start, end;
+
+    flashEmu_reset();
+    flashEmu_setWearModel(&model);
+    highCyclic_setArea(8, 8);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t i = 0; i < UPDATES; i++)
+    {
+        update(i);
+        flashEmu_addUserBytes(userBytes);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    flashEmu_getWearReport(&report);
+    printf("--- %s: %lu updates in %.1f s host time\n", name, UPDATES,
+           (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9);
+    flashEmu_printWearReport(&report);
+    if (report.maxEraseCount != 0)
+    {
+        double updates = (double) UPDATES * model.enduranceEdata / report.maxEraseCount;
+        printf("updates until endurance %.3g, %.1f years at one update per second\n",
+               updates, updates / UPDATES_PER_DAY / 365.25);
+    }
+}
+
+/*a store of four sectors worn until its cells show correctable errors, refreshed in the background*/
+#define REFRESH_UPDATES     100000UL
+#define REFRESH_SCRUB       1000        // updates between remounts, reading every record checks its ECC
+#define REFRESH_THRESHOLD   4           // corrected errors after which a sector is refreshed
+#define REFRESH_COLD_KEYS   16          // keys written once, they are only rewritten by reclaims and refreshes
+#define REFRESH_HOT_KEY     100
+
+static void coldValue(const uint16_t key, uint8_t* value)
+{
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        value[i] = (uint8_t) (key * 16 + i);
+    }
+}
+
+/**
+ * @brief check that the records of a store survive a refresh of sectors collecting correctable errors
+ *
+ * @return false    OK
+ * @return true     Error: a write, mount or refresh failed or a record was lost
+ */
+static bool runRefresh(void)
+{
+    flashEmu_wearModel_t model = FLASH_EMU_WEAR_DEFAULT;
+    flashEmu_wearReport_t report;
+    hcStore_t store;
+    uint8_t value[16];
+    uint32_t refreshes = 0;
+
+    // worn after a few hundred erases, correctable errors only
+    model.enduranceEdata = 1000;
+    model.singleErrorRate = 0.02;
+    model.doubleErrorRate = 0;
+    model.errorExponent = 1.0;
+
+    flashEmu_reset();
+    flashEmu_setWearModel(&model);
+    highCyclic_setArea(8, 8);
+    flashEcc_enableCorrectionMonitor(REFRESH_THRESHOLD);
+
+    if (hcStore_mount(&store, 2, HIGH_CYCLIC_PAGE_OFFSET, 4))
+    {
+        return true;
+    }
+    for (uint16_t key = 1; key <= REFRESH_COLD_KEYS; key++)
+    {
+        coldValue(key, value);
+        if (hcStore_write(&store, key, value, sizeof(value)))
+        {
+            return true;
+        }
+    }
+
+    for (uint32_t i = 1; i <= REFRESH_UPDATES; i++)
+    {
+        if (hcStore_write(&store, REFRESH_HOT_KEY, &i, sizeof(i)))
+        {
+            return true;
+        }
+        flashEmu_addUserBytes(sizeof(i));
+        if (i % REFRESH_SCRUB == 0)
+        {
+            if (hcStore_mount(&store, 2, HIGH_CYCLIC_PAGE_OFFSET, 4))
+            {
+                return true;
+            }
+            for (uint32_t sector = HIGH_CYCLIC_PAGE_OFFSET; sector < HIGH_CYCLIC_PAGE_OFFSET + 4; sector++)
+            {
+                refreshes += flashEcc_refreshDue(2, sector);
+            }
+            if (hcStore_maintain(&store))
+            {
+                return true;
+            }
+        }
+    }
+
+    flashEmu_powerCycle();
+    flashProfile_t profile;
+    bool failed;
+    FLASH_PROFILE(&profile, failed = hcStore_mount(&store, 2, HIGH_CYCLIC_PAGE_OFFSET, 4));
+    if (failed)
+    {
+        return true;
+    }
+    uint32_t lost = 0;
+    uint32_t hot;
+    for (uint16_t key = 1; key <= REFRESH_COLD_KEYS; key++)
+    {
+        uint8_t expected[16];
+        coldValue(key, expected);
+        lost += hcStore_read(&store, key, value, sizeof(value)) || memcmp(value, expected, sizeof(value)) != 0;
+    }
+    lost += hcStore_read(&store, REFRESH_HOT_KEY, &hot, sizeof(hot)) || hot != REFRESH_UPDATES;
+
+    flashEmu_getWearReport(&report);
+    printf("--- store refresh: %lu updates, %lu sectors refreshed, %lu of %u records lost\n",
+           REFRESH_UPDATES, (unsigned long) refreshes, (unsigned long) lost, REFRESH_COLD_KEYS + 1);
+    flashEmu_printWearReport(&report);
+    printf("--- mounting the refreshed store\n");
+    flashProfile_print(&profile);
+    return refreshes == 0 || lost != 0;
+}
+
+int main(void)
+{
+    if (flashEmu_init())
+    {
+        return 1;
+    }
+    run("in place", updateInPlace, RECORD_SIZE);
+    run("append", updateAppend, RECORD_SIZE);
+    run("slots", updateSlots, RECORD_SIZE);
+    run("counter", updateCounter, 2);
+    return runRefresh();
+}
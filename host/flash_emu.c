@@ -0,0 +1,755 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/mman.h>
+#include "flash.h"
+#include "flash_ll.h"
+
+// the firmware handlers, called like the device raises the NMI on a double ECC fault
+// and the flash interrupt on a corrected ECC error
+extern void NMI_Handler(void);
+extern void FLASH_IRQHandler(void);
+
+#define EMU_MAIN_SIZE           (2 * FLASH_BANK_SIZE_STATIC)
+#define EMU_MAIN_SECTORS        (2 * FLASH_PAGES_PER_BANK)
+#define EMU_QUADWORDS           (EMU_MAIN_SIZE / 16)
+#define EMU_EDATA_SIZE          FLASH_EDATA_SIZE
+#define EMU_EDATA_BANK_SIZE     (EMU_EDATA_SIZE / 2)
+#define EMU_EDATA_SECTORS       (EMU_EDATA_SIZE / HIGH_CYCLIC_SECTOR_SIZE)
+#define EMU_HALFWORDS           (EMU_EDATA_SIZE / 2)
+
+// HDPL1, hide protection is not evaluated by the driver below HDPL2
+#define EMU_HDPL_DEFAULT        0x51
+
+FLASH_TypeDef flashEmu_regs;
+SBS_TypeDef flashEmu_sbs;
+ICACHE_TypeDef flashEmu_icache;
+DCACHE_TypeDef flashEmu_dcache;
+uint32_t hostCore_primask;
+
+static uint8_t* const mainFlash = (uint8_t*) FLASH_START_BANK1;
+static uint8_t* const edata = (uint8_t*) HIGH_CYCLIC_START_BANK1;
+static uint8_t mainCells[EMU_QUADWORDS];
+static uint8_t edataCells[EMU_HALFWORDS];
+
+// snapshot for the power loss harness, only dirty sectors are restored
+static uint8_t snapMain[EMU_MAIN_SIZE];
+static uint8_t snapMainCells[EMU_QUADWORDS];
+static uint8_t snapEdata[EMU_EDATA_SIZE];
+static uint8_t snapEdataCells[EMU_HALFWORDS];
+static FLASH_TypeDef snapRegs;
+static bool mainDirty[EMU_MAIN_SECTORS];
+static bool edataDirty[EMU_EDATA_SECTORS];
+
+// quad-word write buffer of main flash
+static uint32_t writeBuffer[4];
+static uint32_t writeBufferAddress;
+static uint32_t writeBufferCount;
+
+// power cut injection
+static uint32_t crashPoints;
+static uint32_t cutAt;
+static bool cutArmed;
+static void (*cutHandler)(void);
+static uint32_t rng;
+
+// wear model
+static flashEmu_wearModel_t wearModel;
+static bool wearEnabled;
+static uint32_t wearRng = 1;
+static uint32_t eraseCounts[EMU_MAIN_SECTORS];
+static flashEmu_wearReport_t wear;
+
+/**
+ * @brief xorshift32, deterministic per crash point so that a failing point can be replayed
+ */
+static uint32_t random32(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+/**
+ * @brief uniformly distributed value in [0, 1) for the error injection, independent of crash points
+ */
+static double uniform(void)
+{
+    wearRng ^= wearRng << 13;
+    wearRng ^= wearRng >> 17;
+    wearRng ^= wearRng << 5;
+    return wearRng / 4294967296.0;
+}
+
+/**
+ * @brief count a crash point
+ *
+ * @return true if power has to be cut at this point
+ */
+static bool crashPoint(void)
+{
+    bool due = cutArmed && (crashPoints == cutAt);
+    crashPoints++;
+    if (due)
+    {
+        rng = 0x9E3779B9UL ^ (cutAt * 0x85EBCA6BUL);
+    }
+    return due;
+}
+
+/**
+ * @brief cut power: reset the device state and hand control back to the harness
+ */
+static void powerCut(void)
+{
+    cutArmed = false;
+    flashEmu_powerCycle();
+    if (cutHandler != NULL)
+    {
+        cutHandler();
+    }
+    fprintf(stderr, "flash_emu: power cut without handler\n");
+    abort();
+}
+
+/**
+ * @brief get the amount of high cyclic sectors configured in a bank
+ */
+static uint32_t edataSectorCount(const uint32_t bank)
+{
+    uint32_t reg = (bank == 1) ? flashEmu_regs.EDATA1R_CUR : flashEmu_regs.EDATA2R_CUR;
+    if ((reg & FLASH_EDATAR_EDATA_EN) == 0)
+    {
+        return 0;
+    }
+    return 1 + ((reg & FLASH_EDATAR_EDATA_STRT_Msk) >> FLASH_EDATAR_EDATA_STRT_Pos);
+}
+
+/**
+ * @brief check if a half-word lies inside the currently configured high cyclic area
+ */
+static bool edataEnabled(const uint32_t offset)
+{
+    uint32_t bank = 1 + offset / EMU_EDATA_BANK_SIZE;
+    uint32_t sector = (offset % EMU_EDATA_BANK_SIZE) / HIGH_CYCLIC_SECTOR_SIZE;
+    return sector >= (EMU_EDATA_SECTORS / 2) - edataSectorCount(bank);
+}
+
+/**
+ * @brief check if a sector of a bank is currently configured as high cyclic sector
+ */
+static bool isEdataSector(const uint32_t bank, const uint32_t sector)
+{
+    return sector >= FLASH_PAGES_PER_BANK - edataSectorCount(bank);
+}
+
+/**
+ * @brief account a finished erase and check the sector against its endurance
+ */
+static void wearErase(const uint32_t bank, const uint32_t sector, const uint32_t size)
+{
+    uint32_t index = (bank - 1) * FLASH_PAGES_PER_BANK + sector;
+    uint32_t count = ++eraseCounts[index];
+    wear.erases++;
+    wear.erasedBytes += size;
+    wear.simulatedUs += wearModel.eraseTimeUs;
+    if (count > wear.maxEraseCount)
+    {
+        wear.maxEraseCount = count;
+    }
+
+    bool edataSector = isEdataSector(bank, sector);
+    uint32_t endurance = edataSector ? wearModel.enduranceEdata : wearModel.enduranceMain;
+    if (wearEnabled && !wear.enduranceExceeded && count > endurance)
+    {
+        wear.enduranceExceeded = true;
+        wear.wornBank = bank;
+        wear.wornSector = sector;
+        wear.wornEdata = edataSector;
+        wear.wornAfterErases = wear.erases;
+        wear.wornAfterUs = wear.simulatedUs;
+    }
+}
+
+/**
+ * @brief account a finished program and inject bit errors depending on the sector's age
+ *
+ * @param sectorIndex physical sector, (bank - 1) * FLASH_PAGES_PER_BANK + sector
+ * @param edataSector the sector is used as high cyclic sector
+ * @param data the programmed bytes
+ * @param cell state of the programmed cell
+ * @param size bytes per cell
+ */
+static void wearProgram(const uint32_t sectorIndex, const bool edataSector, uint8_t* data, uint8_t* cell, const uint32_t size)
+{
+    wear.programmedBytes += size;
+    wear.simulatedUs += (size == 2) ? wearModel.program16TimeUs : wearModel.program128TimeUs;
+    if (!wearEnabled)
+    {
+        return;
+    }
+
+    uint32_t endurance = edataSector ? wearModel.enduranceEdata : wearModel.enduranceMain;
+    double age = pow((double) eraseCounts[sectorIndex] / endurance, wearModel.errorExponent);
+    double r = uniform();
+    if (r < wearModel.doubleErrorRate * age)
+    {
+        // two flipped bits in the same cell
+        uint32_t bit = wearRng % (size * 8);
+        data[bit / 8] ^= (uint8_t) (1 << (bit % 8));
+        bit = (bit + 1) % (size * 8);
+        data[bit / 8] ^= (uint8_t) (1 << (bit % 8));
+        *cell = FLASH_EMU_CELL_UNCORRECTABLE;
+        wear.doubleErrors++;
+    }
+    else if (r < (wearModel.doubleErrorRate + wearModel.singleErrorRate) * age)
+    {
+        // the stored content stays correct, since ECC corrects it on every read
+        *cell = FLASH_EMU_CELL_CORRECTABLE;
+        wear.singleErrors++;
+    }
+}
+
+/**
+ * @brief bring the cells of an erase in progress into a state between programmed and erased
+ *
+ * @param data first byte of the sector
+ * @param cells cell states of the sector
+ * @param cellCount amount of cells
+ * @param cellSize bytes per cell
+ * @param step the erase step at which power was cut
+ */
+static void tearErase(uint8_t* data, uint8_t* cells, const uint32_t cellCount, const uint32_t cellSize, const uint32_t step)
+{
+    for (uint32_t i = 0; i < cellCount; i++)
+    {
+        if ((random32() % FLASH_EMU_ERASE_STEPS) < step)
+        {
+            memset(&data[i * cellSize], 0xFF, cellSize);
+            cells[i] = FLASH_EMU_CELL_ERASED;
+        }
+        else
+        {
+            for (uint32_t b = 0; b < cellSize; b++)
+            {
+                data[i * cellSize + b] |= (uint8_t) random32();
+            }
+            cells[i] = FLASH_EMU_CELL_TORN;
+        }
+    }
+}
+
+/**
+ * @brief erase a sector, either a main flash sector or a high cyclic sector mapped onto it
+ */
+static void eraseSector(const uint32_t bank, const uint32_t sector)
+{
+    uint8_t* data;
+    uint8_t* cells;
+    uint32_t cellCount;
+    uint32_t cellSize;
+
+    if (isEdataSector(bank, sector))
+    {
+        uint32_t index = (bank - 1) * (EMU_EDATA_SECTORS / 2) + (sector - HIGH_CYCLIC_PAGE_OFFSET);
+        data = &edata[index * HIGH_CYCLIC_SECTOR_SIZE];
+        cells = &edataCells[index * HIGH_CYCLIC_SECTOR_SIZE / 2];
+        cellCount = HIGH_CYCLIC_SECTOR_SIZE / 2;
+        cellSize = 2;
+        edataDirty[index] = true;
+    }
+    else
+    {
+        uint32_t index = (bank - 1) * FLASH_PAGES_PER_BANK + sector;
+        data = &mainFlash[index * FLASH_PAGE_SIZE];
+        cells = &mainCells[index * FLASH_PAGE_SIZE / 16];
+        cellCount = FLASH_PAGE_SIZE / 16;
+        cellSize = 16;
+        mainDirty[index] = true;
+    }
+
+    for (uint32_t step = 0; step < FLASH_EMU_ERASE_STEPS; step++)
+    {
+        if (crashPoint())
+        {
+            if (step > 0)
+            {
+                tearErase(data, cells, cellCount, cellSize, step);
+            }
+            powerCut();
+        }
+    }
+
+    memset(data, 0xFF, cellCount * cellSize);
+    memset(cells, FLASH_EMU_CELL_ERASED, cellCount);
+    wearErase(bank, sector, cellCount * cellSize);
+}
+
+/**
+ * @brief map the emulated memories to the addresses of the real device and reset them
+ *
+ * @return false    OK
+ * @return true     Error, the address ranges are already in use by the host process
+ */
+bool flashEmu_init(void)
+{
+    void* mainMap = mmap(mainFlash, EMU_MAIN_SIZE, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    void* edataMap = mmap(edata, EMU_EDATA_SIZE, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (mainMap != (void*) mainFlash || edataMap != (void*) edata)
+    {
+        fprintf(stderr, "flash_emu: cannot map flash to its device addresses\n");
+        return true;
+    }
+    flashEmu_reset();
+    return false;
+}
+
+/**
+ * @brief factory state: all sectors erased, no high cyclic area, no protections
+ */
+void flashEmu_reset(void)
+{
+    memset(mainFlash, 0xFF, EMU_MAIN_SIZE);
+    memset(edata, 0xFF, EMU_EDATA_SIZE);
+    memset(mainCells, FLASH_EMU_CELL_ERASED, sizeof(mainCells));
+    memset(edataCells, FLASH_EMU_CELL_ERASED, sizeof(edataCells));
+    memset((void*) &flashEmu_regs, 0, sizeof(flashEmu_regs));
+    memset((void*) &flashEmu_sbs, 0, sizeof(flashEmu_sbs));
+    memset((void*) &flashEmu_icache, 0, sizeof(flashEmu_icache));
+    memset((void*) &flashEmu_dcache, 0, sizeof(flashEmu_dcache));
+    flashEmu_regs.WRP1R_CUR = 0xFFFFFFFFUL;
+    flashEmu_regs.WRP2R_CUR = 0xFFFFFFFFUL;
+    flashEmu_sbs.HDPLSR = EMU_HDPL_DEFAULT;
+    flashEmu_powerCycle();
+    cutArmed = false;
+    crashPoints = 0;
+    memset(eraseCounts, 0, sizeof(eraseCounts));
+    memset(&wear, 0, sizeof(wear));
+}
+
+/**
+ * @brief reset everything a power cycle resets. Memory content and option bytes persist
+ */
+void flashEmu_powerCycle(void)
+{
+    flashEmu_regs.NSSR = 0;
+    flashEmu_regs.NSCR = FLASH_CR_LOCK;
+    flashEmu_regs.OPTCR = FLASH_OPTCR_OPTLOCK;
+    // the option byte program registers are loaded with the option bytes in effect
+    flashEmu_regs.EDATA1R_PRG = flashEmu_regs.EDATA1R_CUR;
+    flashEmu_regs.EDATA2R_PRG = flashEmu_regs.EDATA2R_CUR;
+    flashEmu_regs.WRP1R_PRG = flashEmu_regs.WRP1R_CUR;
+    flashEmu_regs.WRP2R_PRG = flashEmu_regs.WRP2R_CUR;
+    flashEmu_regs.HDP1R_PRG = flashEmu_regs.HDP1R_CUR;
+    flashEmu_regs.HDP2R_PRG = flashEmu_regs.HDP2R_CUR;
+    flashEmu_regs.ECCCORR = 0;
+    flashEmu_regs.ECCDETR = 0;
+    flashEmu_regs.ECCDR = 0;
+    writeBufferCount = 0;
+    hostCore_primask = 0;
+
+    // the driver's knowledge of erased cells is lost with its RAM
+    memset(highCyclic_blankMap, 0, sizeof(highCyclic_blankMap));
+}
+
+/**
+ * @brief execute the operation started in the control registers
+ *
+ * Called wherever the driver waits for BSY, which it does after every START and OPTSTART.
+ */
+void flashEmu_waitBusy(void)
+{
+    if (flashEmu_regs.NSCR & FLASH_CR_START)
+    {
+        if (flashEmu_regs.NSCR & FLASH_CR_SER)
+        {
+            uint32_t bank = 1 + ((flashEmu_regs.NSCR & FLASH_CR_BKSEL_Msk) >> FLASH_CR_BKSEL_Pos);
+            uint32_t sector = (flashEmu_regs.NSCR & FLASH_CR_SNB_Msk) >> FLASH_CR_SNB_Pos;
+            eraseSector(bank, sector);
+        }
+        flashEmu_regs.NSCR &= ~FLASH_CR_START;
+    }
+
+    if (flashEmu_regs.OPTCR & FLASH_OPTCR_OPTSTART)
+    {
+        if (crashPoint())
+        {
+            powerCut();
+        }
+        flashEmu_regs.EDATA1R_CUR = flashEmu_regs.EDATA1R_PRG;
+        flashEmu_regs.EDATA2R_CUR = flashEmu_regs.EDATA2R_PRG;
+        flashEmu_regs.WRP1R_CUR = flashEmu_regs.WRP1R_PRG;
+        flashEmu_regs.WRP2R_CUR = flashEmu_regs.WRP2R_PRG;
+        flashEmu_regs.HDP1R_CUR = flashEmu_regs.HDP1R_PRG;
+        flashEmu_regs.HDP2R_CUR = flashEmu_regs.HDP2R_PRG;
+        flashEmu_regs.OPTCR &= ~FLASH_OPTCR_OPTSTART;
+    }
+}
+
+/**
+ * @brief program a half-word of the high cyclic area
+ */
+void flashEmu_program16(volatile uint16_t* address, const uint16_t data)
+{
+    uint32_t offset = (uint32_t) address - HIGH_CYCLIC_START_BANK1;
+    if (!(flashEmu_regs.NSCR & FLASH_CR_PG) || offset >= EMU_EDATA_SIZE || !edataEnabled(offset))
+    {
+        flashEmu_regs.NSSR |= FLASH_SR_PGSERR;
+        return;
+    }
+
+    // a half-word cannot be programmed twice without erase
+    if (edataCells[offset / 2] != FLASH_EMU_CELL_ERASED)
+    {
+        flashEmu_regs.NSSR |= FLASH_SR_PGSERR;
+        return;
+    }
+
+    edataDirty[offset / HIGH_CYCLIC_SECTOR_SIZE] = true;
+    if (crashPoint())
+    {
+        powerCut();
+    }
+    if (crashPoint())
+    {
+        *(uint16_t*) &edata[offset] = data | (uint16_t) random32();
+        edataCells[offset / 2] = FLASH_EMU_CELL_TORN;
+        powerCut();
+    }
+    *(uint16_t*) &edata[offset] = data;
+    edataCells[offset / 2] = FLASH_EMU_CELL_PROGRAMMED;
+
+    uint32_t bank = 1 + offset / EMU_EDATA_BANK_SIZE;
+    uint32_t sector = HIGH_CYCLIC_PAGE_OFFSET + (offset % EMU_EDATA_BANK_SIZE) / HIGH_CYCLIC_SECTOR_SIZE;
+    wearProgram((bank - 1) * FLASH_PAGES_PER_BANK + sector, true, &edata[offset], &edataCells[offset / 2], 2);
+}
+
+/**
+ * @brief collect a word of a main flash quad-word and program the quad-word once it is complete
+ */
+void flashEmu_program32(volatile uint32_t* address, const uint32_t data)
+{
+    uint32_t offset = (uint32_t) address - FLASH_START_BANK1;
+    if (!(flashEmu_regs.NSCR & FLASH_CR_PG) || offset >= EMU_MAIN_SIZE)
+    {
+        flashEmu_regs.NSSR |= FLASH_SR_PGSERR;
+        return;
+    }
+
+    // words of one quad-word have to be written in order
+    if (writeBufferCount == 0)
+    {
+        writeBufferAddress = offset;
+    }
+    if (offset != writeBufferAddress + 4 * writeBufferCount || (writeBufferAddress & 0xF) != 0)
+    {
+        flashEmu_regs.NSSR |= FLASH_SR_INCERR;
+        writeBufferCount = 0;
+        return;
+    }
+    writeBuffer[writeBufferCount++] = data;
+    if (writeBufferCount < 4)
+    {
+        return;
+    }
+    writeBufferCount = 0;
+
+    uint32_t quadWord = writeBufferAddress / 16;
+    if (mainCells[quadWord] != FLASH_EMU_CELL_ERASED)
+    {
+        flashEmu_regs.NSSR |= FLASH_SR_PGSERR;
+        return;
+    }
+
+    mainDirty[writeBufferAddress / FLASH_PAGE_SIZE] = true;
+    if (crashPoint())
+    {
+        powerCut();
+    }
+    if (crashPoint())
+    {
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            ((uint32_t*) &mainFlash[writeBufferAddress])[i] = writeBuffer[i] | random32();
+        }
+        mainCells[quadWord] = FLASH_EMU_CELL_TORN;
+        powerCut();
+    }
+    memcpy(&mainFlash[writeBufferAddress], writeBuffer, 16);
+    mainCells[quadWord] = FLASH_EMU_CELL_PROGRAMMED;
+    wearProgram(writeBufferAddress / FLASH_PAGE_SIZE, false, &mainFlash[writeBufferAddress], &mainCells[quadWord], 16);
+}
+
+/**
+ * @brief get the state of the cell containing an address
+ */
+flashEmu_cell_t flashEmu_getCell(const void* address)
+{
+    uint32_t addr = (uint32_t) address;
+    if (addr >= HIGH_CYCLIC_START_BANK1 && addr < HIGH_CYCLIC_START_BANK1 + EMU_EDATA_SIZE)
+    {
+        return edataCells[(addr - HIGH_CYCLIC_START_BANK1) / 2];
+    }
+    if (addr >= FLASH_START_BANK1 && addr < FLASH_START_BANK1 + EMU_MAIN_SIZE)
+    {
+        return mainCells[(addr - FLASH_START_BANK1) / 16];
+    }
+    return FLASH_EMU_CELL_ERASED;
+}
+
+/**
+ * @brief check if an address range can be read on a real device without an ECC fault
+ *
+ * Torn cells always count as faulting. Virgin cells only fault in the high cyclic area,
+ * erased main flash reads back as 0xFF.
+ *
+ * @param address first address of the range
+ * @param size amount of bytes
+ * @return true if every byte of the range is readable
+ */
+bool flashEmu_isReadable(const void* address, const uint32_t size)
+{
+    for (uint32_t addr = (uint32_t) address; addr < (uint32_t) address + size; addr++)
+    {
+        flashEmu_cell_t cell = flashEmu_getCell((const void*) (uintptr_t) addr);
+        bool isEdata = addr >= HIGH_CYCLIC_START_BANK1 && addr < HIGH_CYCLIC_START_BANK1 + EMU_EDATA_SIZE;
+        if (cell == FLASH_EMU_CELL_TORN || cell == FLASH_EMU_CELL_UNCORRECTABLE || (isEdata && cell == FLASH_EMU_CELL_ERASED))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief read an address range like the device would and report ECC events in ECCCORR and ECCDETR
+ *
+ * ADDR_ECC holds the index of the failing cell within its bank: the half-word index in the high
+ * cyclic area, the quad-word index in main flash.
+ *
+ * @param address first address of the range
+ * @param size amount of bytes
+ * @return false    OK, possibly after correction
+ * @return true     Error, uncorrectable ECC error (double ECC fault on the device)
+ */
+bool flashEmu_eccRead(const void* address, const uint32_t size)
+{
+    for (uint32_t addr = (uint32_t) address; addr < (uint32_t) address + size; addr++)
+    {
+        flashEmu_cell_t cell = flashEmu_getCell((const void*) (uintptr_t) addr);
+        bool isEdata = addr >= HIGH_CYCLIC_START_BANK1 && addr < HIGH_CYCLIC_START_BANK1 + EMU_EDATA_SIZE;
+        uint32_t eccInfo;
+        if (isEdata)
+        {
+            uint32_t offset = addr - HIGH_CYCLIC_START_BANK1;
+            eccInfo = FLASH_ECCR_DATA_ECC | (((offset % EMU_EDATA_BANK_SIZE) / 2) << FLASH_ECCR_ADDR_ECC_Pos) |
+                      ((offset / EMU_EDATA_BANK_SIZE) << FLASH_ECCR_BK_ECC_Pos);
+        }
+        else
+        {
+            uint32_t offset = addr - FLASH_START_BANK1;
+            eccInfo = (((offset % FLASH_BANK_SIZE_STATIC) / 16) << FLASH_ECCR_ADDR_ECC_Pos) |
+                      ((offset / FLASH_BANK_SIZE_STATIC) << FLASH_ECCR_BK_ECC_Pos);
+        }
+
+        if (cell == FLASH_EMU_CELL_TORN || cell == FLASH_EMU_CELL_UNCORRECTABLE || (isEdata && cell == FLASH_EMU_CELL_ERASED))
+        {
+            flashEmu_regs.ECCDETR = FLASH_ECCR_ECCD | eccInfo;
+            flashEmu_regs.ECCDR = *(const uint16_t*) (uintptr_t) (addr & ~0x1UL);
+            wear.detectedReads++;
+            return true;
+        }
+        if (cell == FLASH_EMU_CELL_CORRECTABLE)
+        {
+            flashEmu_regs.ECCCORR = (flashEmu_regs.ECCCORR & FLASH_ECCR_ECCIE) | FLASH_ECCR_ECCC | eccInfo;
+            wear.correctedReads++;
+            // a cell is reported once per read, skip its remaining bytes
+            addr |= isEdata ? 0x1 : 0xF;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief raise the flash interrupt for a corrected ECC error if it is enabled
+ */
+static void raiseCorrection(void)
+{
+    if ((flashEmu_regs.ECCCORR & (FLASH_ECCR_ECCC | FLASH_ECCR_ECCIE)) == (FLASH_ECCR_ECCC | FLASH_ECCR_ECCIE))
+    {
+        FLASH_IRQHandler();
+    }
+}
+
+/**
+ * @brief read a half-word through the flash interface, ECC errors raise the NMI or the flash interrupt
+ *
+ * @param address address of the half-word
+ * @return the stored content, undefined on the device after a double ECC fault
+ */
+uint16_t flashEmu_read16(const void* address)
+{
+    if (flashEmu_eccRead(address, 2))
+    {
+        NMI_Handler();
+    }
+    raiseCorrection();
+    return *(const uint16_t*) address;
+}
+
+/**
+ * @brief read a word through the flash interface, ECC errors raise the NMI or the flash interrupt
+ *
+ * @param address address of the word
+ * @return the stored content, undefined on the device after a double ECC fault
+ */
+uint32_t flashEmu_read32(const void* address)
+{
+    if (flashEmu_eccRead(address, 4))
+    {
+        NMI_Handler();
+    }
+    raiseCorrection();
+    return *(const uint32_t*) address;
+}
+
+/**
+ * @brief enable the wear model
+ *
+ * @param model the wear model, NULL disables error injection and endurance checks
+ */
+void flashEmu_setWearModel(const flashEmu_wearModel_t* model)
+{
+    wearEnabled = (model != NULL);
+    if (wearEnabled)
+    {
+        wearModel = *model;
+        wearRng = (model->seed != 0) ? model->seed : 1;
+    }
+}
+
+/**
+ * @brief declare payload bytes written by the workload, the base of the write amplification
+ */
+void flashEmu_addUserBytes(const uint32_t bytes)
+{
+    wear.userBytes += bytes;
+}
+
+/**
+ * @brief get how often a physical sector has been erased since the last reset
+ */
+uint32_t flashEmu_getEraseCount(const uint32_t bank, const uint32_t sector)
+{
+    return eraseCounts[(bank - 1) * FLASH_PAGES_PER_BANK + sector];
+}
+
+void flashEmu_getWearReport(flashEmu_wearReport_t* report)
+{
+    *report = wear;
+}
+
+/**
+ * @brief print a wear report
+ */
+void flashEmu_printWearReport(const flashEmu_wearReport_t* report)
+{
+    printf("erases               %12llu\n", (unsigned long long) report->erases);
+    printf("max erase count      %12u\n", report->maxEraseCount);
+    printf("programmed bytes     %12llu\n", (unsigned long long) report->programmedBytes);
+    printf("user bytes           %12llu\n", (unsigned long long) report->userBytes);
+    if (report->userBytes != 0)
+    {
+        printf("write amplification  %12.2f\n", (double) report->programmedBytes / report->userBytes);
+        printf("erase amplification  %12.2f\n", (double) report->erasedBytes / report->userBytes);
+    }
+    printf("correctable errors   %12llu  (%llu corrected reads)\n",
+           (unsigned long long) report->singleErrors, (unsigned long long) report->correctedReads);
+    printf("uncorrectable errors %12llu  (%llu detected reads)\n",
+           (unsigned long long) report->doubleErrors, (unsigned long long) report->detectedReads);
+    printf("device busy time     %12.1f s\n", report->simulatedUs * 1e-6);
+    if (report->enduranceExceeded)
+    {
+        printf("endurance exceeded   bank %u sector %u (%s) after %llu erases, %.1f s busy time\n",
+               report->wornBank, report->wornSector, report->wornEdata ? "high cyclic" : "main flash",
+               (unsigned long long) report->wornAfterErases, report->wornAfterUs * 1e-6);
+    }
+    else
+    {
+        printf("endurance exceeded   no\n");
+    }
+}
+
+/**
+ * @brief remember the current memory content as the state every power loss run starts from
+ */
+void flashEmu_snapshot(void)
+{
+    memcpy(snapMain, mainFlash, EMU_MAIN_SIZE);
+    memcpy(snapMainCells, mainCells, sizeof(mainCells));
+    memcpy(snapEdata, edata, EMU_EDATA_SIZE);
+    memcpy(snapEdataCells, edataCells, sizeof(edataCells));
+    memcpy(&snapRegs, (void*) &flashEmu_regs, sizeof(snapRegs));
+    memset(mainDirty, 0, sizeof(mainDirty));
+    memset(edataDirty, 0, sizeof(edataDirty));
+}
+
+/**
+ * @brief return to the snapshot, copying back only the sectors modified since
+ */
+void flashEmu_restore(void)
+{
+    for (uint32_t i = 0; i < EMU_MAIN_SECTORS; i++)
+    {
+        if (mainDirty[i])
+        {
+            memcpy(&mainFlash[i * FLASH_PAGE_SIZE], &snapMain[i * FLASH_PAGE_SIZE], FLASH_PAGE_SIZE);
+            memcpy(&mainCells[i * FLASH_PAGE_SIZE / 16], &snapMainCells[i * FLASH_PAGE_SIZE / 16], FLASH_PAGE_SIZE / 16);
+            mainDirty[i] = false;
+        }
+    }
+    for (uint32_t i = 0; i < EMU_EDATA_SECTORS; i++)
+    {
+        if (edataDirty[i])
+        {
+            memcpy(&edata[i * HIGH_CYCLIC_SECTOR_SIZE], &snapEdata[i * HIGH_CYCLIC_SECTOR_SIZE], HIGH_CYCLIC_SECTOR_SIZE);
+            memcpy(&edataCells[i * HIGH_CYCLIC_SECTOR_SIZE / 2], &snapEdataCells[i * HIGH_CYCLIC_SECTOR_SIZE / 2], HIGH_CYCLIC_SECTOR_SIZE / 2);
+            edataDirty[i] = false;
+        }
+    }
+    memcpy((void*) &flashEmu_regs, &snapRegs, sizeof(snapRegs));
+    flashEmu_powerCycle();
+}
+
+/**
+ * @brief cut power once the given crash point is reached
+ *
+ * @param crashPoint index of the crash point, counted from the last flashEmu_resetCrashPoints()
+ * @param onPowerCut called after the power cycle, must not return (longjmp back into the harness)
+ */
+void flashEmu_armPowerCut(const uint32_t crashPoint, void (*onPowerCut)(void))
+{
+    cutAt = crashPoint;
+    cutHandler = onPowerCut;
+    cutArmed = true;
+}
+
+void flashEmu_disarmPowerCut(void)
+{
+    cutArmed = false;
+}
+
+void flashEmu_resetCrashPoints(void)
+{
+    crashPoints = 0;
+}
+
+uint32_t flashEmu_getCrashPoints(void)
+{
+    return crashPoints;
+}
@@ -0,0 +1,131 @@
+#ifndef FLASH_EMU_H
+#define FLASH_EMU_H
+/**
+ * @file flash_emu.h
+ * @brief emulated STM32H5 flash for host builds
+ *
+ * Included by flash.h after stm32h563.h when FLASH_EMULATION is defined. Main flash and the
+ * high cyclic area are mapped to their real addresses, so the driver and everything built on it
+ * run unchanged on the host. The FLASH, SBS, ICACHE and DCACHE1 register blocks are redirected to plain structs,
+ * the driver's hardware access primitives are routed into the emulator.
+ *
+ * Every point at which a real device could lose power inside an erase or a program operation is
+ * a numbered crash point. The emulator can be armed to cut power at one of them, which leaves
+ * the affected cells erased, torn or partially erased, and calls back into the power loss harness.
+ *
+ * With a wear model set, the emulator counts erase cycles per sector, injects correctable and
+ * uncorrectable bit errors into programmed cells at a rate rising with the sector's age and
+ * accumulates the device time the operations would take.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+extern FLASH_TypeDef flashEmu_regs;
+extern SBS_TypeDef flashEmu_sbs;
+extern ICACHE_TypeDef flashEmu_icache;
+extern DCACHE_TypeDef flashEmu_dcache;
+
+#undef FLASH
+#define FLASH                           (&flashEmu_regs)
+#undef SBS
+#define SBS                             (&flashEmu_sbs)
+#undef ICACHE
+#define ICACHE                          (&flashEmu_icache)
+#undef DCACHE1
+#define DCACHE1                         (&flashEmu_dcache)
+
+#define FLASH_WAIT_BSY()                flashEmu_waitBusy()
+#define FLASH_PROGRAM16(address, data)  flashEmu_program16((address), (data))
+#define FLASH_PROGRAM32(address, data)  flashEmu_program32((address), (data))
+#define FLASH_READ16(address)           flashEmu_read16((const void*) (address))
+#define FLASH_READ32(address)           flashEmu_read32((const void*) (address))
+#define FLASH_ECC_CLEAR(reg, flag)      ((reg) &= ~(flag))
+#define FLASH_ERRORS_CLEAR(flags)       (flashEmu_regs.NSSR &= ~(flags))
+
+// amount of crash points per sector erase, the first one cuts before the erase started
+#define FLASH_EMU_ERASE_STEPS           4
+
+typedef enum
+{
+    FLASH_EMU_CELL_ERASED = 0,          // erased, never programmed. Virgin high cyclic cells fault on read
+    FLASH_EMU_CELL_PROGRAMMED,          // programmed, reads back with valid ECC
+    FLASH_EMU_CELL_TORN,                // program or erase was interrupted, content and ECC are undefined
+    FLASH_EMU_CELL_CORRECTABLE,         // programmed with a single bit error, ECC corrects it on read
+    FLASH_EMU_CELL_UNCORRECTABLE        // programmed with a double bit error, faults on read
+} flashEmu_cell_t;
+
+typedef struct
+{
+    uint32_t enduranceEdata;            // rated erase cycles of a high cyclic sector
+    uint32_t enduranceMain;             // rated erase cycles of a main flash sector
+    double singleErrorRate;             // probability of a correctable error per programmed cell at rated endurance
+    double doubleErrorRate;             // probability of an uncorrectable error per programmed cell at rated endurance
+    double errorExponent;               // error rates scale with (erase cycles / endurance) ^ errorExponent
+    uint32_t eraseTimeUs;               // device time of a sector erase
+    uint32_t program16TimeUs;           // device time of a half-word program
+    uint32_t program128TimeUs;          // device time of a quad-word program
+    uint32_t seed;                      // seed of the error injection
+} flashEmu_wearModel_t;
+
+// approximate datasheet values of the STM32H563
+#define FLASH_EMU_WEAR_DEFAULT { \
+    .enduranceEdata = 100000, \
+    .enduranceMain = 10000, \
+    .singleErrorRate = 1e-4, \
+    .doubleErrorRate = 1e-7, \
+    .errorExponent = 3.0, \
+    .eraseTimeUs = 2000, \
+    .program16TimeUs = 16, \
+    .program128TimeUs = 50, \
+    .seed = 1, \
+}
+
+typedef struct
+{
+    uint64_t erases;                    // sector erases
+    uint64_t erasedBytes;               // bytes of all erased sectors
+    uint64_t programmedBytes;           // bytes programmed, including torn programs
+    uint64_t userBytes;                 // bytes the workload declared as payload
+    uint64_t singleErrors;              // injected correctable errors
+    uint64_t doubleErrors;              // injected uncorrectable errors
+    uint64_t correctedReads;            // reads corrected by ECC
+    uint64_t detectedReads;             // reads with an uncorrectable ECC error
+    uint64_t simulatedUs;               // device time spent erasing and programming
+    uint32_t maxEraseCount;             // highest erase count of any sector
+    bool enduranceExceeded;             // a sector was erased more often than its endurance
+    uint32_t wornBank;                  // bank of the first sector exceeding its endurance
+    uint32_t wornSector;                // the first sector exceeding its endurance
+    bool wornEdata;                     // it was configured as high cyclic sector when exceeding
+    uint64_t wornAfterErases;           // total erases when it exceeded
+    uint64_t wornAfterUs;               // device time when it exceeded
+} flashEmu_wearReport_t;
+
+extern bool flashEmu_init(void);
+extern void flashEmu_reset(void);
+extern void flashEmu_powerCycle(void);
+
+extern void flashEmu_waitBusy(void);
+extern void flashEmu_program16(volatile uint16_t* address, const uint16_t data);
+extern void flashEmu_program32(volatile uint32_t* address, const uint32_t data);
+
+extern flashEmu_cell_t flashEmu_getCell(const void* address);
+extern bool flashEmu_isReadable(const void* address, const uint32_t size);
+
+extern bool flashEmu_eccRead(const void* address, const uint32_t size);
+extern uint16_t flashEmu_read16(const void* address);
+extern uint32_t flashEmu_read32(const void* address);
+
+extern void flashEmu_setWearModel(const flashEmu_wearModel_t* model);
+extern void flashEmu_addUserBytes(const uint32_t bytes);
+extern uint32_t flashEmu_getEraseCount(const uint32_t bank, const uint32_t sector);
+extern void flashEmu_getWearReport(flashEmu_wearReport_t* report);
+extern void flashEmu_printWearReport(const flashEmu_wearReport_t* report);
+
+extern void flashEmu_snapshot(void);
+extern void flashEmu_restore(void);
+extern void flashEmu_armPowerCut(const uint32_t crashPoint, void (*onPowerCut)(void));
+extern void flashEmu_disarmPowerCut(void);
+extern void flashEmu_resetCrashPoints(void);
+extern uint32_t flashEmu_getCrashPoints(void);
+
+#endif // FLASH_EMU_H
@@ -0,0 +1,435 @@
+/**
+ * @file hcimage.c
+ * @brief build a ready-to-flash high cyclic record store image from a text description
+ *
+ * hcimage <description> <image.hex|image.bin>
+ *
+ * description, one entry per line, # starts a comment:
+ *   bank 1                     bank of the store (default 1)
+ *   sectors 120 127            first and last sector of the store (default 120 127)
+ *   0x0010 u16 1234 0x5678     key, type and values; types: u8, u16, u32, hex (bytes), str ("text")
+ *
+ * The image gets a header in every sector holding records and an index checkpoint behind the
+ * records, so the firmware mounts it with hcStore_mount() by reading the checkpoint only. Before writing, the
+ * image is programmed into the flash emulator and mounted with the firmware code to verify it.
+ *
+ * The Intel HEX output only contains the programmed half-words. The binary output covers the
+ * whole store and fills unused space with 0xFF, which would program those half-words as well;
+ * only use it with a programmer that skips erased patterns.
+ */
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hc_store.h"
+
+#define MAX_ENTRIES         1024
+#define MAX_PAYLOAD         (HIGH_CYCLIC_SECTOR_SIZE - sizeof(hcStore_sectorHeader_t) - sizeof(hcStore_recordHeader_t))
+#define STORE_MAX_SIZE      (FLASH_GEOM_HC_SECTORS_PER_BANK * HIGH_CYCLIC_SECTOR_SIZE)
+
+typedef struct
+{
+    uint16_t key;
+    uint16_t length;
+    uint8_t payload[MAX_PAYLOAD];
+    uint16_t offset;            // offset of the record in the image
+} entry_t;
+
+static entry_t entries[MAX_ENTRIES];
+static uint32_t entryCount;
+static uint32_t bank = 1;
+static uint32_t sectorFirst = HIGH_CYCLIC_PAGE_OFFSET;
+static uint32_t sectorLast = FLASH_PAGES_PER_BANK - 1;
+
+static uint8_t image[STORE_MAX_SIZE];
+static bool programmed[STORE_MAX_SIZE / 2];
+
+static void fail(const char* file, const uint32_t line, const char* message)
+{
+    fprintf(stderr, "%s:%u: %s\n", file, line, message);
+    exit(1);
+}
+
+static bool parseNumber(const char* text, unsigned long* value)
+{
+    char* end;
+    errno = 0;
+    *value = strtoul(text, &end, 0);
+    return errno == 0 && end != text && *end == '\0';
+}
+
+/**
+ * @brief append values of a numeric type to a payload
+ */
+static void appendValue(entry_t* entry, const unsigned long value, const uint32_t width, const char* file, const uint32_t line)
+{
+    if (width < 4 && value >> (8 * width) != 0)
+    {
+        fail(file, line, "value does not fit the type");
+    }
+    if (entry->length + width > MAX_PAYLOAD)
+    {
+        fail(file, line, "payload does not fit into a sector");
+    }
+    for (uint32_t i = 0; i < width; i++)
+    {
+        entry->payload[entry->length++] = (uint8_t) (value >> (8 * i));
+    }
+}
+
+/**
+ * @brief get the entry of a key, later definitions replace earlier ones
+ */
+static entry_t* entryFor(const uint16_t key)
+{
+    for (uint32_t i = 0; i < entryCount; i++)
+    {
+        if (entries[i].key == key)
+        {
+            entries[i].length = 0;
+            return &entries[i];
+        }
+    }
+    if (entryCount == MAX_ENTRIES)
+    {
+        return NULL;
+    }
+    entries[entryCount].key = key;
+    entries[entryCount].length = 0;
+    return &entries[entryCount++];
+}
+
+static void parseDescription(const char* file)
+{
+    FILE* in = fopen(file, "r");
+    if (in == NULL)
+    {
+        perror(file);
+        exit(1);
+    }
+
+    char text[4096];
+    uint32_t line = 0;
+    while (fgets(text, sizeof(text), in) != NULL)
+    {
+        line++;
+        char* comment = strchr(text, '#');
+        if (comment != NULL && strchr(text, '"') == NULL)
+        {
+            *comment = '\0';
+        }
+
+        char* save;
+        char* word = strtok_r(text, " \t\r\n", &save);
+        if (word == NULL)
+        {
+            continue;
+        }
+
+        unsigned long value;
+        if (strcmp(word, "bank") == 0)
+        {
+            if (!parseNumber(strtok_r(NULL, " \t\r\n", &save) ?: "", &value) || (value != 1 && value != 2))
+            {
+                fail(file, line, "bank has to be 1 or 2");
+            }
+            bank = value;
+            continue;
+        }
+        if (strcmp(word, "sectors") == 0)
+        {
+            unsigned long last;
+            if (!parseNumber(strtok_r(NULL, " \t\r\n", &save) ?: "", &value) ||
+                !parseNumber(strtok_r(NULL, " \t\r\n", &save) ?: "", &last) ||
+                value < HIGH_CYCLIC_PAGE_OFFSET || last >= FLASH_PAGES_PER_BANK || value > last)
+            {
+                fail(file, line, "sectors have to be a range of high cyclic sectors, 120 to 127");
+            }
+            sectorFirst = value;
+            sectorLast = last;
+            continue;
+        }
+
+        if (!parseNumber(word, &value) || value > HCSTORE_KEY_MAX)
+        {
+            fail(file, line, "invalid key");
+        }
+        entry_t* entry = entryFor((uint16_t) value);
+        if (entry == NULL)
+        {
+            fail(file, line, "too many keys");
+        }
+
+        char* type = strtok_r(NULL, " \t\r\n", &save);
+        if (type == NULL)
+        {
+            fail(file, line, "missing type");
+        }
+
+        if (strcmp(type, "str") == 0)
+        {
+            char* start = strchr(save, '"');
+            char* end = (start != NULL) ? strrchr(start + 1, '"') : NULL;
+            if (end == NULL)
+            {
+                fail(file, line, "str needs a quoted text");
+            }
+            for (char* c = start + 1; c < end; c++)
+            {
+                appendValue(entry, (uint8_t) *c, 1, file, line);
+            }
+            continue;
+        }
+
+        uint32_t width;
+        if (strcmp(type, "u8") == 0 || strcmp(type, "hex") == 0)
+        {
+            width = 1;
+        }
+        else if (strcmp(type, "u16") == 0)
+        {
+            width = 2;
+        }
+        else if (strcmp(type, "u32") == 0)
+        {
+            width = 4;
+        }
+        else
+        {
+            fail(file, line, "unknown type");
+        }
+
+        for (char* v = strtok_r(NULL, " \t\r\n", &save); v != NULL; v = strtok_r(NULL, " \t\r\n", &save))
+        {
+            char number[64];
+            snprintf(number, sizeof(number), "%s%s", strcmp(type, "hex") == 0 ? "0x" : "", v);
+            if (!parseNumber(number, &value))
+            {
+                fail(file, line, "invalid value");
+            }
+            appendValue(entry, value, width, file, line);
+        }
+    }
+    fclose(in);
+}
+
+/**
+ * @brief copy bytes into the image and mark their half-words as programmed
+ */
+static void place(const uint32_t offset, const void* data, const uint32_t size)
+{
+    memcpy(&image[offset], data, size);
+    for (uint32_t i = offset / 2; i < (offset + size + 1) / 2; i++)
+    {
+        programmed[i] = true;
+    }
+}
+
+/**
+ * @brief place a record, moving on to the next sector if it does not fit
+ *
+ * @return offset of the record in the image
+ */
+static uint32_t placeRecord(uint32_t* position, uint32_t* used, const uint16_t key, const void* payload, const uint16_t length)
+{
+    uint32_t sectorCount = sectorLast - sectorFirst + 1;
+    uint32_t sector = *position / HIGH_CYCLIC_SECTOR_SIZE;
+    if ((*position % HIGH_CYCLIC_SECTOR_SIZE) + HCSTORE_RECORD_SIZE(length) > HIGH_CYCLIC_SECTOR_SIZE)
+    {
+        sector++;
+        *position = sector * HIGH_CYCLIC_SECTOR_SIZE + sizeof(hcStore_sectorHeader_t);
+    }
+    if (sector >= sectorCount)
+    {
+        fprintf(stderr, "records do not fit into %u sectors\n", sectorCount);
+        exit(1);
+    }
+
+    hcStore_recordHeader_t record = {.key = key, .length = length};
+    record.crc = hcStore_recordCrc(&record, payload);
+    uint32_t offset = *position;
+    place(offset, &record, sizeof(record));
+    place(offset + sizeof(record), payload, length);
+    *position += HCSTORE_RECORD_SIZE(length);
+    used[sector] = *position - sector * HIGH_CYCLIC_SECTOR_SIZE;
+    return offset;
+}
+
+static int compareKeys(const void* a, const void* b)
+{
+    return (int) ((const entry_t*) a)->key - (int) ((const entry_t*) b)->key;
+}
+
+static void buildImage(void)
+{
+    uint32_t sectorCount = sectorLast - sectorFirst + 1;
+    uint32_t used[FLASH_GEOM_HC_SECTORS_PER_BANK];
+    uint32_t position = sizeof(hcStore_sectorHeader_t);
+    for (uint32_t sector = 0; sector < sectorCount; sector++)
+    {
+        used[sector] = sizeof(hcStore_sectorHeader_t);
+    }
+
+    if (entryCount > HCSTORE_MAX_KEYS)
+    {
+        fprintf(stderr, "%u keys, the firmware store holds up to %u (HCSTORE_MAX_KEYS)\n", entryCount, HCSTORE_MAX_KEYS);
+        exit(1);
+    }
+    qsort(entries, entryCount, sizeof(entry_t), compareKeys);
+    for (uint32_t i = 0; i < entryCount; i++)
+    {
+        entries[i].offset = placeRecord(&position, used, entries[i].key, entries[i].payload, entries[i].length);
+    }
+
+    static hcStore_indexEntry_t index[MAX_ENTRIES];
+    for (uint32_t i = 0; i < entryCount; i++)
+    {
+        index[i].key = entries[i].key;
+        index[i].offset = entries[i].offset;
+    }
+    uint32_t indexOffset = placeRecord(&position, used, HCSTORE_KEY_INDEX, index, entryCount * sizeof(hcStore_indexEntry_t));
+    uint32_t indexSector = indexOffset / HIGH_CYCLIC_SECTOR_SIZE;
+
+    // sectors behind the index stay erased, the firmware formats them when it appends records
+    for (uint32_t sector = 0; sector <= indexSector; sector++)
+    {
+        hcStore_sectorHeader_t header = {
+            .magic = HCSTORE_MAGIC,
+            .version = HCSTORE_VERSION,
+            .used = used[sector],
+            .sequence = sector + 1,
+            .indexOffset = (sector == indexSector) ? indexOffset % HIGH_CYCLIC_SECTOR_SIZE : HCSTORE_NONE,
+        };
+        header.crc = hcStore_headerCrc(&header);
+        place(sector * HIGH_CYCLIC_SECTOR_SIZE, &header, sizeof(header));
+    }
+}
+
+/**
+ * @brief program the image into the flash emulator and mount it with the firmware code
+ *
+ * @return false    OK
+ * @return true     Error
+ */
+static bool verifyImage(void)
+{
+    uint32_t start = FLASH_GEOM_HC_SECTOR_ADDRESS(bank, sectorFirst);
+    uint32_t size = (sectorLast - sectorFirst + 1) * HIGH_CYCLIC_SECTOR_SIZE;
+    hcStore_t store;
+
+    if (flashEmu_init())
+    {
+        return true;
+    }
+    highCyclic_setArea(FLASH_PAGES_PER_BANK - sectorFirst, FLASH_PAGES_PER_BANK - sectorFirst);
+    for (uint32_t offset = 0; offset < size; offset += 2)
+    {
+        if (programmed[offset / 2])
+        {
+            flash_write16((uint16_t*) (uintptr_t) (start + offset), *(uint16_t*) &image[offset], 2);
+        }
+    }
+
+    if (hcStore_mount(&store, bank, sectorFirst, sectorLast - sectorFirst + 1) || store.indexEntries != entryCount)
+    {
+        fprintf(stderr, "verify: image does not mount\n");
+        return true;
+    }
+    for (uint32_t i = 0; i < entryCount; i++)
+    {
+        uint16_t length;
+        const void* payload = hcStore_find(&store, entries[i].key, &length);
+        if (payload == NULL || length != entries[i].length || memcmp(payload, entries[i].payload, length) != 0)
+        {
+            fprintf(stderr, "verify: key 0x%04X does not read back\n", entries[i].key);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void ihexRecord(FILE* out, const uint8_t type, const uint16_t address, const uint8_t* data, const uint8_t size)
+{
+    uint8_t sum = size + (address >> 8) + (address & 0xFF) + type;
+    fprintf(out, ":%02X%04X%02X", size, address, type);
+    for (uint32_t i = 0; i < size; i++)
+    {
+        fprintf(out, "%02X", data[i]);
+        sum += data[i];
+    }
+    fprintf(out, "%02X\n", (uint8_t) -sum);
+}
+
+static void writeIhex(FILE* out)
+{
+    uint32_t start = FLASH_GEOM_HC_SECTOR_ADDRESS(bank, sectorFirst);
+    uint32_t size = (sectorLast - sectorFirst + 1) * HIGH_CYCLIC_SECTOR_SIZE;
+    uint32_t upper = 0xFFFFFFFF;
+
+    for (uint32_t offset = 0; offset < size; )
+    {
+        if (!programmed[offset / 2])
+        {
+            offset += 2;
+            continue;
+        }
+
+        // a run of programmed half-words, at most 16 bytes and not crossing a 64 KB boundary
+        uint32_t address = start + offset;
+        uint32_t length = 0;
+        while (offset + length < size && programmed[(offset + length) / 2] && length < 16 &&
+               ((address + length) >> 16) == (address >> 16))
+        {
+            length += 2;
+        }
+
+        if ((address >> 16) != upper)
+        {
+            upper = address >> 16;
+            uint8_t data[2] = {(uint8_t) (upper >> 8), (uint8_t) upper};
+            ihexRecord(out, 0x04, 0, data, 2);
+        }
+        ihexRecord(out, 0x00, (uint16_t) address, &image[offset], (uint8_t) length);
+        offset += length;
+    }
+    ihexRecord(out, 0x01, 0, NULL, 0);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3)
+    {
+        fprintf(stderr, "usage: %s <description> <image.hex|image.bin>\n", argv[0]);
+        return 1;
+    }
+
+    memset(image, 0xFF, sizeof(image));
+    parseDescription(argv[1]);
+    buildImage();
+    if (verifyImage())
+    {
+        return 1;
+    }
+
+    FILE* out = fopen(argv[2], "w");
+    if (out == NULL)
+    {
+        perror(argv[2]);
+        return 1;
+    }
+    const char* extension = strrchr(argv[2], '.');
+    if (extension != NULL && strcmp(extension, ".bin") == 0)
+    {
+        fwrite(image, 1, (sectorLast - sectorFirst + 1) * HIGH_CYCLIC_SECTOR_SIZE, out);
+    }
+    else
+    {
+        writeIhex(out);
+    }
+    fclose(out);
+
+    printf("%u keys in bank %u sectors %u-%u at 0x%08lX\n", entryCount, bank, sectorFirst, sectorLast,
+           (unsigned long) FLASH_GEOM_HC_SECTOR_ADDRESS(bank, sectorFirst));
+    return 0;
+}
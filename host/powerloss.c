@@ -0,0 +1,98 @@
+#include <setjmp.h>
+#include <stdio.h>
+#include <time.h>
+#include "flash.h"
+#include "powerloss.h"
+
+static jmp_buf restartPoint;
+
+/**
+ * @brief called by the emulator after power was cut, continues behind the setjmp of the replay
+ */
+static void onPowerCut(void)
+{
+    longjmp(restartPoint, 1);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief cut power at every crash point of the scenario's workload and check the invariant after each
+ *
+ * @param scenario the scenario to run
+ * @param result filled with the outcome
+ * @return false    OK, no invariant violation
+ * @return true     Error, at least one violation
+ */
+bool powerLoss_run(const powerLoss_scenario_t* scenario, powerLoss_result_t* result)
+{
+    double start = now();
+    *result = (powerLoss_result_t) {0};
+
+    flashEmu_reset();
+    if (scenario->setup != NULL)
+    {
+        scenario->setup(scenario->context);
+    }
+    flashEmu_snapshot();
+
+    // uninterrupted run: count crash points, the invariant has to hold afterwards as well
+    flashEmu_resetCrashPoints();
+    scenario->workload(scenario->context);
+    result->crashPoints = flashEmu_getCrashPoints();
+    flashEmu_powerCycle();
+    result->completedRunFailed = !scenario->check(scenario->context);
+
+    for (volatile uint32_t point = 0; point < result->crashPoints; point++)
+    {
+        flashEmu_restore();
+        flashEmu_resetCrashPoints();
+        flashEmu_armPowerCut(point, onPowerCut);
+
+        if (setjmp(restartPoint) == 0)
+        {
+            scenario->workload(scenario->context);
+            result->missedPoints++;
+        }
+        flashEmu_disarmPowerCut();
+
+        if (!scenario->check(scenario->context))
+        {
+            if (result->violations == 0)
+            {
+                result->firstViolation = point;
+            }
+            result->violations++;
+        }
+    }
+
+    flashEmu_restore();
+    result->seconds = now() - start;
+    return result->completedRunFailed || result->violations != 0;
+}
+
+/**
+ * @brief print a one-line summary of a power loss run
+ */
+void powerLoss_print(const powerLoss_scenario_t* scenario, const powerLoss_result_t* result)
+{
+    printf("%-24s crash points %7u  violations %7u", scenario->name, result->crashPoints, result->violations);
+    if (result->violations != 0)
+    {
+        printf(" (first at %u)", result->firstViolation);
+    }
+    if (result->completedRunFailed)
+    {
+        printf("  completed run FAILED");
+    }
+    if (result->missedPoints != 0)
+    {
+        printf("  %u missed, workload not deterministic", result->missedPoints);
+    }
+    printf("  %.0f points/s\n", result->seconds > 0 ? result->crashPoints / result->seconds : 0.0);
+}
@@ -0,0 +1,38 @@
+#ifndef POWERLOSS_H
+#define POWERLOSS_H
+/**
+ * @file powerloss.h
+ * @brief power loss fault injection against the emulated flash
+ *
+ * A scenario brings the flash into a start state, runs a workload and checks an invariant after
+ * restart. The harness first runs the workload uninterrupted to count its crash points, then
+ * replays it once per crash point with power cut exactly there.
+ * Workloads have to be deterministic, every run from the snapshot has to issue the same flash
+ * operations.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct
+{
+    const char* name;
+    void (*setup)(void* context);       // bring the flash into the start state, never interrupted
+    void (*workload)(void* context);    // the operations to interrupt
+    bool (*check)(void* context);       // recover after restart and verify the invariant, false on violation
+    void* context;
+} powerLoss_scenario_t;
+
+typedef struct
+{
+    uint32_t crashPoints;               // crash points of one uninterrupted workload run
+    uint32_t violations;                // crash points after which check() failed
+    uint32_t firstViolation;            // index of the first failing crash point, valid if violations != 0
+    uint32_t missedPoints;              // replays that finished without reaching their crash point
+    bool completedRunFailed;            // check() failed after the uninterrupted run
+    double seconds;                     // host time spent
+} powerLoss_result_t;
+
+extern bool powerLoss_run(const powerLoss_scenario_t* scenario, powerLoss_result_t* result);
+extern void powerLoss_print(const powerLoss_scenario_t* scenario, const powerLoss_result_t* result);
+
+#endif // POWERLOSS_H
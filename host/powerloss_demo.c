@@ -0,0 +1,1026 @@
+#include <stdio.h>
+#include <string.h>
+#include "flash.h"
+#include "flash_wc.h"
+#include "hc_bd.h"
+#include "hc_checkpoint.h"
+#include "hc_counter.h"
+#include "hc_mirror.h"
+#include "hc_series.h"
+#include "hc_slot.h"
+#include "hc_store.h"
+#include "hc_tier.h"
+#include "powerloss.h"
+
+/**
+ * @brief hold the flash unlocked like a DMA-fed write in progress, the driver refuses every
+ *        erase and program meanwhile without touching a cell
+ *
+ * @param refuse true to refuse, false to release the flash again
+ */
+static void refuseFlash(const bool refuse)
+{
+    if (refuse)
+    {
+        FLASH->NSCR &= ~FLASH_CR_LOCK;
+    }
+    else
+    {
+        FLASH->NSCR |= FLASH_CR_LOCK;
+    }
+}
+
+/*the record of TEST2 in main.c, rewritten in place by erase and four half-word programs*/
+#define RECORD_ADDRESS      (HIGH_CYCLIC_START_BANK2)
+#define RECORD_WORDS        4
+
+static const uint16_t recordOld[RECORD_WORDS] = {0x0123, 0x4567, 0x89AB, 0xCDEF};
+static const uint16_t recordNew[RECORD_WORDS] = {0x7f7f, 0x5d5d, 0xc8c8, 0x0101};
+
+static void writeRecord(const uint16_t* record)
+{
+    flash_erase(2, HIGH_CYCLIC_PAGE_OFFSET);
+    for (uint32_t i = 0; i < RECORD_WORDS; i++)
+    {
+        flash_write16((uint16_t*) (RECORD_ADDRESS + 2 * i), record[i], 2);
+    }
+}
+
+static void test2Setup(void* context)
+{
+    highCyclic_setArea(8, 8);
+    writeRecord(recordOld);
+}
+
+static void test2Workload(void* context)
+{
+    writeRecord(recordNew);
+}
+
+/**
+ * @brief after restart the record has to be readable and either completely old or completely new
+ */
+static bool test2Check(void* context)
+{
+    const uint16_t* record = (const uint16_t*) RECORD_ADDRESS;
+    if (!flashEmu_isReadable(record, RECORD_WORDS * 2))
+    {
+        return false;
+    }
+
+    bool isOld = true;
+    bool isNew = true;
+    for (uint32_t i = 0; i < RECORD_WORDS; i++)
+    {
+        isOld = isOld && (record[i] == recordOld[i]);
+        isNew = isNew && (record[i] == recordNew[i]);
+    }
+    return isOld || isNew;
+}
+
+/*the same record kept in slots of sectors 120 and 121, updated across a sector switch*/
+static hcSlot_t slotRecord;
+
+static void slotSetup(void* context)
+{
+    highCyclic_setArea(8, 8);
+    hcSlot_open(&slotRecord, 2, HIGH_CYCLIC_PAGE_OFFSET, RECORD_WORDS * 2);
+    hcSlot_write(&slotRecord, recordOld);
+
+    // fill the first sector up to its last slot, so the workload switches sectors
+    for (uint32_t i = 2; i < HCSLOT_SLOTS(RECORD_WORDS * 2); i++)
+    {
+        hcSlot_write(&slotRecord, (i & 1) ? recordNew : recordOld);
+    }
+}
+
+static void slotWorkload(void* context)
+{
+    hcSlot_open(&slotRecord, 2, HIGH_CYCLIC_PAGE_OFFSET, RECORD_WORDS * 2);
+    hcSlot_write(&slotRecord, recordNew);
+    hcSlot_write(&slotRecord, recordOld);
+    hcSlot_write(&slotRecord, recordNew);
+}
+
+/**
+ * @brief after restart the newest slot has to hold a complete record
+ */
+static bool slotCheck(void* context)
+{
+    hcSlot_t slot;
+    const void* record;
+    if (hcSlot_open(&slot, 2, HIGH_CYCLIC_PAGE_OFFSET, RECORD_WORDS * 2) || (record = hcSlot_find(&slot)) == NULL)
+    {
+        return false;
+    }
+    return memcmp(record, recordOld, RECORD_WORDS * 2) == 0 || memcmp(record, recordNew, RECORD_WORDS * 2) == 0;
+}
+
+/*a generation and its inverse kept in slots of sectors 122 and 123, every third update refused
+  once and written again, across a sector switch*/
+#define SLOT_SECTOR         (HIGH_CYCLIC_PAGE_OFFSET + 2)
+#define SLOT_UPDATES        12
+#define SLOT_LEFT           5           // slots of the first sector left to the workload
+
+static uint32_t slotAcked;                          // generation of the last update that succeeded
+
+static void slotValue(const uint32_t generation, uint32_t* value)
+{
+    value[0] = generation;
+    value[1] = ~generation;
+}
+
+static void slotRefusedSetup(void* context)
+{
+    hcSlot_t slot;
+    uint32_t value[2];
+    highCyclic_setArea(8, 8);
+    hcSlot_open(&slot, 2, SLOT_SECTOR, sizeof(value));
+    slotValue(0, value);
+
+    // leave a few slots of the first sector, so the workload switches sectors
+    for (uint32_t i = 0; i < HCSLOT_SLOTS(sizeof(value)) - SLOT_LEFT; i++)
+    {
+        hcSlot_write(&slot, value);
+    }
+}
+
+static void slotRefusedWorkload(void* context)
+{
+    hcSlot_t slot;
+    uint32_t value[2];
+    slotAcked = 0;
+    hcSlot_open(&slot, 2, SLOT_SECTOR, sizeof(value));
+    for (uint32_t generation = 1; generation <= SLOT_UPDATES; generation++)
+    {
+        slotValue(generation, value);
+        refuseFlash(generation % 3 == 1);
+        bool failed = hcSlot_write(&slot, value);
+        refuseFlash(false);
+        if (failed && hcSlot_write(&slot, value))
+        {
+            return;
+        }
+        slotAcked = generation;
+    }
+}
+
+/**
+ * @brief after restart the newest value has to be the acknowledged generation or the one after it,
+ *        and a further update has to become the newest value
+ */
+static bool slotRefusedCheck(void* context)
+{
+    hcSlot_t slot;
+    uint32_t value[2];
+    if (hcSlot_open(&slot, 2, SLOT_SECTOR, sizeof(value)) || hcSlot_read(&slot, value) ||
+        value[1] != ~value[0] || (value[0] != slotAcked && value[0] != slotAcked + 1))
+    {
+        return false;
+    }
+    // refused updates consume no slot, the completed workload took one per generation
+    if (slotAcked == SLOT_UPDATES && value[0] == SLOT_UPDATES && slot.next != SLOT_UPDATES - SLOT_LEFT)
+    {
+        return false;
+    }
+
+    // a refused slot left as a gap would hide the following ones from the binary search
+    slotValue(0xC0, value);
+    if (hcSlot_write(&slot, value))
+    {
+        return false;
+    }
+    flashEmu_powerCycle();
+    return !hcSlot_open(&slot, 2, SLOT_SECTOR, sizeof(value)) && !hcSlot_read(&slot, value) && value[0] == 0xC0;
+}
+
+/*values of a few keys in a record store of four sectors, appended across a sector switch. The
+  context selects high cyclic or main flash sectors and the sector the setup fills up to*/
+#define STORE_SECTORS       4
+#define STORE_MAIN_SECTOR   100         // first sector of the store in main flash of bank 1
+#define STORE_KEYS          5
+#define STORE_STATIC_KEY    100         // one key per sector written once, so a reclaim has records to copy
+#define STORE_WRITES        60          // appends of the workload, every seventh one refused
+
+typedef struct
+{
+    uint32_t generation;
+    uint32_t inverse;
+} storeValue_t;
+
+typedef struct
+{
+    uint32_t fill;                      // sequence of the sector the setup fills, 1 .. STORE_SECTORS + 1
+    bool mainFlash;                     // mounted by hcStore_mountMain()
+} storeContext_t;
+
+static const storeContext_t storeSwitch = {2, false};
+static const storeContext_t storeReclaim = {STORE_SECTORS + 1, false};   // every sector written, the workload reclaims
+static const storeContext_t storeMain = {STORE_SECTORS + 1, true};
+
+static hcStore_t store;
+static uint32_t storeGeneration;                    // generation of the next append
+static uint32_t storeSetupSequence;                 // sectors the setup started, each holds a static key
+static uint32_t storeSetupAcked[STORE_KEYS];        // newest generation of each key after the setup
+static uint32_t storeAcked[STORE_KEYS];             // newest generation of each key the store acknowledged
+static uint32_t storeAttempt;                       // generation of the append in progress
+
+static bool storeAppend(hcStore_t* target, const uint16_t key, const uint32_t generation)
+{
+    storeValue_t value = {generation, ~generation};
+    return hcStore_write(target, key, &value, sizeof(value));
+}
+
+static bool storeMount(hcStore_t* target, const storeContext_t* context)
+{
+    if (context->mainFlash)
+    {
+        return hcStore_mountMain(target, 1, STORE_MAIN_SECTOR, STORE_SECTORS);
+    }
+    return hcStore_mount(target, 2, HIGH_CYCLIC_PAGE_OFFSET, STORE_SECTORS);
+}
+
+static void storeSetup(void* context)
+{
+    const storeContext_t* setup = (const storeContext_t*) context;
+    highCyclic_setArea(8, 8);
+    storeMount(&store, setup);
+
+    // fill the store until only a few records fit into that sector, the workload continues behind it
+    uint32_t sequence = 0;
+    uint32_t generation = 0;
+    while (store.sequence < setup->fill ||
+           (store.active + 1U) * store.sectorSize - store.tail > STORE_WRITES / 3 * HCSTORE_RECORD_SIZE_IN(sizeof(storeValue_t), store.granule))
+    {
+        if (store.sequence != sequence)
+        {
+            sequence = store.sequence;
+            storeAppend(&store, STORE_STATIC_KEY + sequence, sequence);
+        }
+        storeAppend(&store, 1 + generation % STORE_KEYS, generation);
+        storeSetupAcked[generation % STORE_KEYS] = generation;
+        generation++;
+    }
+    storeGeneration = generation;
+    storeSetupSequence = sequence;
+}
+
+static void storeWorkload(void* context)
+{
+    memcpy(storeAcked, storeSetupAcked, sizeof(storeAcked));
+    storeMount(&store, (const storeContext_t*) context);
+    for (uint32_t i = 0; i < STORE_WRITES; i++)
+    {
+        uint32_t generation = storeGeneration + i;
+        storeAttempt = generation;
+        refuseFlash(i % 7 == 3);
+        bool failed = storeAppend(&store, 1 + generation % STORE_KEYS, generation);
+        refuseFlash(false);
+        if (!failed)
+        {
+            storeAcked[generation % STORE_KEYS] = generation;
+        }
+    }
+}
+
+/**
+ * @brief after restart every key has to hold its newest acknowledged value or the one being
+ *        written, and the store has to take and keep a further append
+ */
+static bool storeCheck(void* context)
+{
+    hcStore_t mounted;
+    storeValue_t value;
+    if (storeMount(&mounted, (const storeContext_t*) context))
+    {
+        return false;
+    }
+    for (uint32_t key = 0; key < STORE_KEYS; key++)
+    {
+        if (hcStore_read(&mounted, 1 + key, &value, sizeof(value)) || value.inverse != ~value.generation ||
+            (value.generation != storeAcked[key] && value.generation != storeAttempt))
+        {
+            return false;
+        }
+    }
+    for (uint32_t sequence = 1; sequence <= storeSetupSequence; sequence++)
+    {
+        if (hcStore_read(&mounted, STORE_STATIC_KEY + sequence, &value, sizeof(value)) || value.generation != sequence)
+        {
+            return false;
+        }
+    }
+
+    if (storeAppend(&mounted, 1, 0xC0FFEE))
+    {
+        return false;
+    }
+    flashEmu_powerCycle();
+    return !storeMount(&mounted, (const storeContext_t*) context) &&
+           !hcStore_read(&mounted, 1, &value, sizeof(value)) && value.generation == 0xC0FFEE;
+}
+
+/*a store filling all eight high cyclic sectors of bank 2, the area is shrunk by two sectors and
+  grown again. Records of the leaving sectors are migrated first*/
+#define RESIZE_KEYS         12
+#define RESIZE_AREA         8
+#define RESIZE_SMALL        6
+
+static uint32_t resizeAcked[RESIZE_KEYS];           // newest generation of each key after the setup
+
+static void resizeSetup(void* context)
+{
+    highCyclic_setArea(RESIZE_AREA, RESIZE_AREA);
+    hcStore_mount(&store, 2, FLASH_PAGES_PER_BANK - RESIZE_AREA, RESIZE_AREA);
+
+    // spread the keys over the first sectors, those leave the area
+    for (uint32_t generation = 0; generation < 700; generation++)
+    {
+        storeAppend(&store, 1 + generation % RESIZE_KEYS, generation);
+        resizeAcked[generation % RESIZE_KEYS] = generation;
+    }
+}
+
+static void resizeWorkload(void* context)
+{
+    hcStore_mount(&store, 2, FLASH_PAGES_PER_BANK - RESIZE_AREA, RESIZE_AREA);
+    hcStore_resize(&store, RESIZE_SMALL);
+    hcStore_resize(&store, RESIZE_AREA);
+}
+
+/**
+ * @brief after restart the store has to mount with the area in effect, old or new, and hold
+ *        every key with the value the setup wrote
+ */
+static bool resizeCheck(void* context)
+{
+    uint32_t area = highCyclic_getSectorCount(2);
+    hcStore_t mounted;
+    storeValue_t value;
+    if ((area != RESIZE_AREA && area != RESIZE_SMALL) ||
+        hcStore_mount(&mounted, 2, FLASH_PAGES_PER_BANK - area, area))
+    {
+        return false;
+    }
+    for (uint32_t key = 0; key < RESIZE_KEYS; key++)
+    {
+        if (hcStore_read(&mounted, 1 + key, &value, sizeof(value)) || value.generation != resizeAcked[key])
+        {
+            return false;
+        }
+    }
+    return !storeAppend(&mounted, 1, 0xC0FFEE);
+}
+
+/*keys placed by the tiers over a hot store in high cyclic memory and a cold one in main flash.
+  The workload writes one key until it is promoted, then ages it until it is demoted*/
+#define TIER_KEYS           4
+#define TIER_MOVING_KEY     1
+
+static hcStore_t tierHot;
+static hcStore_t tierCold;
+static hcTier_t tier;
+static uint32_t tierAcked[TIER_KEYS];               // newest generation of each key the tiers acknowledged
+static uint32_t tierAttempt;                        // generation of the write in progress
+
+static bool tierMount(hcStore_t* hot, hcStore_t* cold, hcTier_t* tiers)
+{
+    if (hcStore_mount(hot, 2, HIGH_CYCLIC_PAGE_OFFSET, STORE_SECTORS) ||
+        hcStore_mountMain(cold, 1, STORE_MAIN_SECTOR, STORE_SECTORS))
+    {
+        return true;
+    }
+    hcTier_init(tiers, hot, cold);
+    return false;
+}
+
+static void tierSetup(void* context)
+{
+    highCyclic_setArea(8, 8);
+    tierMount(&tierHot, &tierCold, &tier);
+    for (uint32_t key = 0; key < TIER_KEYS; key++)
+    {
+        storeValue_t value = {key, ~key};
+        hcTier_write(&tier, 1 + key, &value, sizeof(value));
+    }
+}
+
+static void tierWorkload(void* context)
+{
+    for (uint32_t key = 0; key < TIER_KEYS; key++)
+    {
+        tierAcked[key] = key;
+    }
+    tierAttempt = tierAcked[TIER_MOVING_KEY - 1];
+    tierMount(&tierHot, &tierCold, &tier);
+
+    // the last of these writes moves the key to the hot store
+    for (uint32_t i = 1; i <= HCTIER_HOT_WRITES; i++)
+    {
+        storeValue_t value = {TIER_KEYS * i, ~(TIER_KEYS * i)};
+        tierAttempt = value.generation;
+        if (!hcTier_write(&tier, TIER_MOVING_KEY, &value, sizeof(value)))
+        {
+            tierAcked[TIER_MOVING_KEY - 1] = value.generation;
+        }
+    }
+
+    // the first period still counts the writes, the last one moves the key back
+    for (uint32_t period = 0; period <= HCTIER_COLD_PERIODS; period++)
+    {
+        hcTier_age(&tier);
+    }
+}
+
+/**
+ * @brief after restart every key has to hold its newest acknowledged value or the one being
+ *        written, in either store, and the moving key has to take a further write
+ */
+static bool tierCheck(void* context)
+{
+    hcStore_t hot;
+    hcStore_t cold;
+    hcTier_t tiers;
+    storeValue_t value;
+    if (tierMount(&hot, &cold, &tiers))
+    {
+        return false;
+    }
+    for (uint32_t key = 0; key < TIER_KEYS; key++)
+    {
+        if (hcTier_read(&tiers, 1 + key, &value, sizeof(value)) || value.inverse != ~value.generation ||
+            (value.generation != tierAcked[key] && value.generation != tierAttempt))
+        {
+            return false;
+        }
+    }
+
+    value = (storeValue_t) {0xC0FFEE, ~0xC0FFEEU};
+    return !hcTier_write(&tiers, TIER_MOVING_KEY, &value, sizeof(value)) &&
+           !hcTier_read(&tiers, TIER_MOVING_KEY, &value, sizeof(value)) && value.generation == 0xC0FFEE;
+}
+
+/*a counter in a ring of sectors 126 and 127 counted by one across a sector switch, every fourth
+  add refused once and repeated*/
+#define COUNTER_SECTOR      (HIGH_CYCLIC_PAGE_OFFSET + 6)
+#define COUNTER_LEFT        8           // increments of the first sector left to the workload
+#define COUNTER_ADDS        24
+
+static uint64_t counterAcked;                       // value after the last add that succeeded
+
+static void counterSetup(void* context)
+{
+    hcCounter_t counter;
+    highCyclic_setArea(8, 8);
+    hcCounter_open(&counter, 2, COUNTER_SECTOR, 2);
+    for (uint32_t i = 0; i < HCCOUNTER_INCREMENTS - COUNTER_LEFT; i++)
+    {
+        hcCounter_add(&counter, 1);
+    }
+}
+
+static void counterWorkload(void* context)
+{
+    hcCounter_t counter;
+    hcCounter_open(&counter, 2, COUNTER_SECTOR, 2);
+    counterAcked = hcCounter_get(&counter);
+    for (uint32_t i = 0; i < COUNTER_ADDS; i++)
+    {
+        refuseFlash(i % 4 == 1);
+        bool failed = hcCounter_add(&counter, 1);
+        refuseFlash(false);
+        if (failed && hcCounter_add(&counter, 1))
+        {
+            return;
+        }
+        counterAcked = hcCounter_get(&counter);
+    }
+}
+
+/**
+ * @brief after restart the counter has to hold the acknowledged value or one more, never less,
+ *        and count on from there
+ */
+static bool counterCheck(void* context)
+{
+    hcCounter_t counter;
+    if (hcCounter_open(&counter, 2, COUNTER_SECTOR, 2))
+    {
+        return false;
+    }
+    uint64_t value = hcCounter_get(&counter);
+    if (value != counterAcked && value != counterAcked + 1)
+    {
+        return false;
+    }
+
+    if (hcCounter_add(&counter, 1))
+    {
+        return false;
+    }
+    flashEmu_powerCycle();
+    return !hcCounter_open(&counter, 2, COUNTER_SECTOR, 2) && hcCounter_get(&counter) == value + 1;
+}
+
+/*a RAM region of five blocks checkpointed into a store of four sectors, each save changing two
+  blocks and every third save refused once and repeated*/
+#define CHECKPOINT_SECTOR   (HIGH_CYCLIC_PAGE_OFFSET + 4)
+#define CHECKPOINT_BLOCKS   5
+#define CHECKPOINT_SAVES    12
+
+static uint8_t checkpointRegion[CHECKPOINT_BLOCKS * HCCHECKPOINT_BLOCK_SIZE];
+static uint32_t checkpointAcked;                    // generation of the last save that succeeded
+
+/**
+ * @brief fill a region with the state of a generation: each block holds the generation that changed it last
+ */
+static void checkpointState(const uint32_t generation, uint8_t* region)
+{
+    for (uint32_t block = 0; block < CHECKPOINT_BLOCKS; block++)
+    {
+        uint32_t changed = generation;
+        while (changed > 0 && changed % CHECKPOINT_BLOCKS != block && (changed + 2) % CHECKPOINT_BLOCKS != block)
+        {
+            changed--;
+        }
+        memset(region + block * HCCHECKPOINT_BLOCK_SIZE, (int) (changed * 16 + block), HCCHECKPOINT_BLOCK_SIZE);
+    }
+}
+
+static bool checkpointOpen(hcStore_t* target, hcCheckpoint_t* checkpoint)
+{
+    return hcStore_mount(target, 2, CHECKPOINT_SECTOR, 4) ||
+           hcCheckpoint_open(checkpoint, target, checkpointRegion, sizeof(checkpointRegion));
+}
+
+static void checkpointSetup(void* context)
+{
+    hcCheckpoint_t checkpoint;
+    highCyclic_setArea(8, 8);
+    checkpointOpen(&store, &checkpoint);
+    checkpointState(0, checkpointRegion);
+    hcCheckpoint_save(&checkpoint, NULL);
+}
+
+static void checkpointWorkload(void* context)
+{
+    hcCheckpoint_t checkpoint;
+    checkpointAcked = 0;
+    checkpointOpen(&store, &checkpoint);
+    for (uint32_t generation = 1; generation <= CHECKPOINT_SAVES; generation++)
+    {
+        checkpointState(generation, checkpointRegion);
+        refuseFlash(generation % 3 == 2);
+        bool failed = hcCheckpoint_save(&checkpoint, NULL);
+        refuseFlash(false);
+        if (failed && hcCheckpoint_save(&checkpoint, NULL))
+        {
+            return;
+        }
+        checkpointAcked = generation;
+    }
+}
+
+/**
+ * @brief after restart the restored region has to be the state of the acknowledged save or of the
+ *        one in progress, never a mix, and a further save has to be restored after a restart
+ */
+static bool checkpointCheck(void* context)
+{
+    static uint8_t expected[sizeof(checkpointRegion)];
+    hcCheckpoint_t checkpoint;
+    memset(checkpointRegion, 0, sizeof(checkpointRegion));
+    if (checkpointOpen(&store, &checkpoint) || hcCheckpoint_restore(&checkpoint))
+    {
+        return false;
+    }
+    checkpointState(checkpointAcked, expected);
+    bool old = memcmp(checkpointRegion, expected, sizeof(expected)) == 0;
+    checkpointState(checkpointAcked + 1, expected);
+    if (!old && (checkpointAcked == CHECKPOINT_SAVES || memcmp(checkpointRegion, expected, sizeof(expected)) != 0))
+    {
+        return false;
+    }
+
+    checkpointState(CHECKPOINT_SAVES + 1, checkpointRegion);
+    checkpointState(CHECKPOINT_SAVES + 1, expected);
+    if (hcCheckpoint_save(&checkpoint, NULL))
+    {
+        return false;
+    }
+    flashEmu_powerCycle();
+    memset(checkpointRegion, 0, sizeof(checkpointRegion));
+    return !checkpointOpen(&store, &checkpoint) && !hcCheckpoint_restore(&checkpoint) &&
+           memcmp(checkpointRegion, expected, sizeof(expected)) == 0;
+}
+
+/*a few keys mirrored into stores of four sectors in both banks, every sixth write refused*/
+#define MIRROR_SECTOR       (HIGH_CYCLIC_PAGE_OFFSET + 4)
+#define MIRROR_KEYS         3
+#define MIRROR_WRITES       30
+
+static uint32_t mirrorAcked[MIRROR_KEYS];           // newest generation of each key the mirror acknowledged
+static uint32_t mirrorAttempt;                      // generation of the write in progress
+
+static bool mirrorMount(hcMirror_t* mirror, hcStore_t* copies)
+{
+    return hcStore_mount(&copies[0], 1, MIRROR_SECTOR, 4) || hcStore_mount(&copies[1], 2, MIRROR_SECTOR, 4) ||
+           hcMirror_init(mirror, &copies[0], &copies[1]);
+}
+
+static bool mirrorWrite(hcMirror_t* mirror, const uint32_t generation)
+{
+    storeValue_t value = {generation, ~generation};
+    return hcMirror_write(mirror, 1 + generation % MIRROR_KEYS, &value, sizeof(value));
+}
+
+static void mirrorSetup(void* context)
+{
+    hcStore_t copies[2];
+    hcMirror_t mirror;
+    highCyclic_setArea(8, 8);
+    mirrorMount(&mirror, copies);
+    for (uint32_t generation = 0; generation < MIRROR_KEYS; generation++)
+    {
+        mirrorWrite(&mirror, generation);
+    }
+}
+
+static void mirrorWorkload(void* context)
+{
+    hcStore_t copies[2];
+    hcMirror_t mirror;
+    for (uint32_t key = 0; key < MIRROR_KEYS; key++)
+    {
+        mirrorAcked[key] = key;
+    }
+    mirrorMount(&mirror, copies);
+    for (uint32_t generation = MIRROR_KEYS; generation < MIRROR_KEYS + MIRROR_WRITES; generation++)
+    {
+        mirrorAttempt = generation;
+        refuseFlash(generation % 6 == 1);
+        bool failed = mirrorWrite(&mirror, generation);
+        refuseFlash(false);
+        if (!failed)
+        {
+            mirrorAcked[generation % MIRROR_KEYS] = generation;
+        }
+    }
+}
+
+/**
+ * @brief after restart and a scrub both copies of every key have to be equal and hold the newest
+ *        acknowledged value or the one being written
+ */
+static bool mirrorCheck(void* context)
+{
+    hcStore_t copies[2];
+    hcMirror_t mirror;
+    if (mirrorMount(&mirror, copies) || hcMirror_scrub(&mirror))
+    {
+        return false;
+    }
+    for (uint32_t key = 0; key < MIRROR_KEYS; key++)
+    {
+        storeValue_t value[2];
+        if (hcStore_read(&copies[0], 1 + key, &value[0], sizeof(value[0])) ||
+            hcStore_read(&copies[1], 1 + key, &value[1], sizeof(value[1])) ||
+            memcmp(&value[0], &value[1], sizeof(value[0])) != 0 || value[0].inverse != ~value[0].generation)
+        {
+            return false;
+        }
+        if (value[0].generation != mirrorAcked[key] &&
+            !(value[0].generation == mirrorAttempt && mirrorAttempt % MIRROR_KEYS == key))
+        {
+            return false;
+        }
+    }
+
+    // a value whose length changed while only the first copy took it is current, reading it with
+    // the old length must not roll it back from the second copy
+    storeValue_t longer = {0x40, ~0x40U};
+    uint16_t length;
+    uint32_t failures = mirror.counters.failures[0];
+    if (hcMirror_write(&mirror, 0x40, &longer, sizeof(longer)) || hcStore_write(&copies[0], 0x40, &longer, 4) ||
+        !hcMirror_read(&mirror, 0x40, &longer, sizeof(longer)) ||
+        hcStore_find(&copies[0], 0x40, &length) == NULL || length != 4 || mirror.counters.failures[0] != failures)
+    {
+        return false;
+    }
+
+    if (mirrorWrite(&mirror, 0xC0))
+    {
+        return false;
+    }
+    flashEmu_powerCycle();
+    storeValue_t value;
+    return !mirrorMount(&mirror, copies) && !hcMirror_read(&mirror, 1 + 0xC0 % MIRROR_KEYS, &value, sizeof(value)) &&
+           value.generation == 0xC0;
+}
+
+/*a commit log of entries {sequence, ~sequence} in the block device block of bank 2 sector 126,
+  synced after every entry and every fifth sync refused once and repeated*/
+#define BD_BLOCK            (FLASH_GEOM_HC_SECTORS_PER_BANK + 6)
+#define BD_ENTRIES          40
+
+static uint32_t bdAcked;                            // entries programmed and synced
+
+static void bdSetup(void* context)
+{
+    hcBd_t bd;
+    highCyclic_setArea(8, 8);
+    hcBd_open(&bd, BD_BLOCK, 1);
+    hcBd_erase(&bd, 0);
+}
+
+static void bdWorkload(void* context)
+{
+    hcBd_t bd;
+    bdAcked = 0;
+    hcBd_open(&bd, BD_BLOCK, 1);
+    for (uint32_t i = 0; i < BD_ENTRIES; i++)
+    {
+        uint16_t entry[2] = {(uint16_t) i, (uint16_t) ~i};
+        if (hcBd_prog(&bd, 0, i * sizeof(entry), entry, sizeof(entry)))
+        {
+            return;
+        }
+        refuseFlash(i % 5 == 2);
+        bool failed = hcBd_sync(&bd);
+        refuseFlash(false);
+        if (failed && hcBd_sync(&bd))
+        {
+            return;
+        }
+        bdAcked = i + 1;
+    }
+}
+
+/**
+ * @brief after restart the whole block has to be readable with every synced entry intact, and
+ *        the first entry that reads as erased has to take a new entry
+ */
+static bool bdCheck(void* context)
+{
+    hcBd_t bd;
+    uint16_t entries[BD_ENTRIES + 1][2];
+    if (hcBd_open(&bd, BD_BLOCK, 1) || hcBd_read(&bd, 0, 0, entries, sizeof(entries)))
+    {
+        return false;
+    }
+    uint32_t next = bdAcked;
+    for (uint32_t i = 0; i < bdAcked; i++)
+    {
+        if (entries[i][0] != i || entries[i][1] != (uint16_t) ~i)
+        {
+            return false;
+        }
+    }
+    // a torn entry never reads as erased, the filesystem would program it again
+    while (next <= BD_ENTRIES && (entries[next][0] != 0xFFFF || entries[next][1] != 0xFFFF))
+    {
+        next++;
+    }
+
+    uint16_t entry[2] = {0xC0, (uint16_t) ~0xC0};
+    if (next > BD_ENTRIES || hcBd_prog(&bd, 0, next * sizeof(entry), entry, sizeof(entry)) || hcBd_sync(&bd))
+    {
+        return false;
+    }
+    flashEmu_powerCycle();
+    return !hcBd_open(&bd, BD_BLOCK, 1) && !hcBd_read(&bd, 0, next * sizeof(entry), entries, sizeof(entry)) &&
+           entries[0][0] == 0xC0;
+}
+
+/*records of 24 bytes appended to two main flash sectors of bank 1 by write combining, each one
+  flushed so it takes two quad-words. Every fifth append is refused and retried*/
+#define WC_SECTOR           110
+#define WC_RECORDS          20
+#define WC_RECORD_WORDS     6
+#define WC_RECORD_STRIDE    32
+
+static uint32_t wcAcked;                            // records appended and flushed
+
+static void wcRecord(const uint32_t index, uint32_t* record)
+{
+    for (uint32_t i = 0; i < WC_RECORD_WORDS; i++)
+    {
+        record[i] = index * 0x01010101UL + i;
+    }
+}
+
+static bool wcOpen(flashWc_t* wc)
+{
+    return flashWc_open(wc, (void*) FLASH_GEOM_SECTOR_ADDRESS(1, WC_SECTOR), 2 * FLASH_PAGE_SIZE);
+}
+
+static void wcSetup(void* context)
+{
+    flash_erase(1, WC_SECTOR);
+    flash_erase(1, WC_SECTOR + 1);
+}
+
+static void wcWorkload(void* context)
+{
+    flashWc_t wc;
+    uint32_t record[WC_RECORD_WORDS];
+    wcAcked = 0;
+    wcOpen(&wc);
+    for (uint32_t i = 0; i < WC_RECORDS; i++)
+    {
+        // one byte off the word alignment, so the record goes through the RAM quad-word
+        uint8_t bytes[sizeof(record) + 1];
+        wcRecord(i, record);
+        memcpy(bytes + 1, record, sizeof(record));
+
+        uint32_t tail = flashWc_tail(&wc);
+        refuseFlash(i % 5 == 2);
+        bool failed = flashWc_append(&wc, bytes + 1, sizeof(record));
+        refuseFlash(false);
+        if (failed)
+        {
+            // appended up to the tail, the rest follows once the flash is free
+            uint32_t appended = flashWc_tail(&wc) - tail;
+            if (flashWc_append(&wc, bytes + 1 + appended, sizeof(record) - appended))
+            {
+                return;
+            }
+        }
+        if (flashWc_flush(&wc))
+        {
+            return;
+        }
+        wcAcked = i + 1;
+    }
+}
+
+/**
+ * @brief after restart every flushed record has to be intact, and the writer has to reopen
+ *        behind them and append a record that survives a further restart
+ */
+static bool wcCheck(void* context)
+{
+    flashWc_t wc;
+    uint32_t record[WC_RECORD_WORDS];
+    uint32_t first = FLASH_GEOM_SECTOR_ADDRESS(1, WC_SECTOR);
+    for (uint32_t i = 0; i < wcAcked; i++)
+    {
+        wcRecord(i, record);
+        if (!flashEmu_isReadable((const void*) (first + i * WC_RECORD_STRIDE), sizeof(record)) ||
+            memcmp((const void*) (first + i * WC_RECORD_STRIDE), record, sizeof(record)) != 0)
+        {
+            return false;
+        }
+    }
+    if (wcOpen(&wc) || flashWc_tail(&wc) < first + wcAcked * WC_RECORD_STRIDE ||
+        flashWc_tail(&wc) > first + (wcAcked + 1) * WC_RECORD_STRIDE)
+    {
+        return false;
+    }
+
+    uint32_t tail = flashWc_tail(&wc);
+    wcRecord(0xC0, record);
+    if (flashWc_append(&wc, record, sizeof(record)) || flashWc_flush(&wc))
+    {
+        return false;
+    }
+    flashEmu_powerCycle();
+    return !wcOpen(&wc) && flashWc_tail(&wc) == tail + WC_RECORD_STRIDE &&
+           memcmp((const void*) tail, record, sizeof(record)) == 0;
+}
+
+/*samples of a ramp recorded into sectors 124 and 125, flushed every 25 samples and every seventh
+  append refused once and appended again*/
+#define SERIES_SECTOR       (HIGH_CYCLIC_PAGE_OFFSET + 4)
+#define SERIES_SAMPLES      100
+#define SERIES_FLUSH        25
+
+static uint32_t seriesAcked;                        // samples appended and flushed
+
+static int16_t seriesValue(const uint32_t index)
+{
+    return (int16_t) (index * index / 4 - 300);
+}
+
+static bool seriesOpen(hcSeries_t* series)
+{
+    return hcSeries_open(series, 2, SERIES_SECTOR, 2, 1);
+}
+
+static void seriesSetup(void* context)
+{
+    highCyclic_setArea(8, 8);
+    flash_erase(2, SERIES_SECTOR);
+    flash_erase(2, SERIES_SECTOR + 1);
+}
+
+static void seriesWorkload(void* context)
+{
+    hcSeries_t series;
+    seriesAcked = 0;
+    seriesOpen(&series);
+    for (uint32_t i = 0; i < SERIES_SAMPLES; i++)
+    {
+        refuseFlash(i % 7 == 3);
+        bool failed = hcSeries_append(&series, i + 1, seriesValue(i));
+        refuseFlash(false);
+        if (failed && hcSeries_append(&series, i + 1, seriesValue(i)))
+        {
+            return;
+        }
+        if ((i + 1) % SERIES_FLUSH == 0)
+        {
+            if (hcSeries_flush(&series))
+            {
+                return;
+            }
+            seriesAcked = i + 1;
+        }
+    }
+}
+
+/**
+ * @brief after restart the series has to return every flushed sample and only samples of the
+ *        ramp, in order, and continue behind the newest one
+ */
+static bool seriesCheck(void* context)
+{
+    hcSeries_t series;
+    hcSeries_sample_t samples[SERIES_SAMPLES + 1];
+    uint32_t count;
+    if (seriesOpen(&series) || hcSeries_query(&series, 0, 0xFFFFFFFFUL, samples, SERIES_SAMPLES + 1, &count) ||
+        count < seriesAcked || count > SERIES_SAMPLES)
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (samples[i].timestamp != i + 1 || samples[i].value != seriesValue(i))
+        {
+            return false;
+        }
+    }
+
+    if (hcSeries_append(&series, count + 1, seriesValue(count)) || hcSeries_flush(&series))
+    {
+        return false;
+    }
+    flashEmu_powerCycle();
+    return !seriesOpen(&series) && !hcSeries_query(&series, count + 1, count + 1, samples, 1, &count) &&
+           count == 1 && samples[0].value == seriesValue(samples[0].timestamp - 1);
+}
+
+typedef struct
+{
+    powerLoss_scenario_t scenario;
+    bool expectViolations;              // the scenario demonstrates an unsafe scheme
+} demo_t;
+
+static const demo_t demos[] = {
+    {{"TEST2 erase/rewrite", test2Setup, test2Workload, test2Check, NULL}, true},
+    {{"slot update", slotSetup, slotWorkload, slotCheck, NULL}, false},
+    {{"slot refused", slotRefusedSetup, slotRefusedWorkload, slotRefusedCheck, NULL}, false},
+    {{"store append", storeSetup, storeWorkload, storeCheck, (void*) &storeSwitch}, false},
+    {{"store reclaim", storeSetup, storeWorkload, storeCheck, (void*) &storeReclaim}, false},
+    {{"store main flash", storeSetup, storeWorkload, storeCheck, (void*) &storeMain}, false},
+    {{"store resize", resizeSetup, resizeWorkload, resizeCheck, NULL}, false},
+    {{"tier move", tierSetup, tierWorkload, tierCheck, NULL}, false},
+    {{"series", seriesSetup, seriesWorkload, seriesCheck, NULL}, false},
+    {{"counter", counterSetup, counterWorkload, counterCheck, NULL}, false},
+    {{"mirror", mirrorSetup, mirrorWorkload, mirrorCheck, NULL}, false},
+    {{"checkpoint", checkpointSetup, checkpointWorkload, checkpointCheck, NULL}, false},
+    {{"block device", bdSetup, bdWorkload, bdCheck, NULL}, false},
+    {{"write combining", wcSetup, wcWorkload, wcCheck, NULL}, false},
+};
+
+/**
+ * @brief run every scenario, or those whose name contains the first argument
+ *
+ * @return 0 if every scenario behaved as expected, 1 otherwise
+ */
+int main(int argc, char** argv)
+{
+    if (flashEmu_init())
+    {
+        return 1;
+    }
+
+    int failed = 0;
+    for (uint32_t i = 0; i < sizeof(demos) / sizeof(demos[0]); i++)
+    {
+        const powerLoss_scenario_t* scenario = &demos[i].scenario;
+        if (argc > 1 && strstr(scenario->name, argv[1]) == NULL)
+        {
+            continue;
+        }
+
+        powerLoss_result_t result;
+        bool violated = powerLoss_run(scenario, &result);
+        powerLoss_print(scenario, &result);
+        if (violated != demos[i].expectViolations || result.missedPoints != 0)
+        {
+            failed = 1;
+        }
+    }
+    return failed;
+}
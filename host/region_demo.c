@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include "flash_region.h"
+
+/*a high cyclic and a main flash region, their accesses are checked at compile time*/
+FLASH_REGION(HC_CONFIG, 2, FLASH_KIND_HIGH_CYCLIC, 120, 121);
+FLASH_REGION(MAIN_LOG, 1, FLASH_KIND_MAIN, 100, 101);
+
+static const uint32_t logEntry[4] = {0x01234567, 0x89ABCDEF, 0x76543210, 0xFEDCBA98};
+
+static uint32_t failures;
+
+static void expect(const char* what, const bool ok)
+{
+    printf("%-48s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok)
+    {
+        failures++;
+    }
+}
+
+/**
+ * @brief run the region accesses of the README against the emulated flash
+ *
+ * @return 0 if every access behaved as expected, 1 otherwise
+ */
+int main(void)
+{
+    if (flashEmu_init())
+    {
+        return 1;
+    }
+    highCyclic_setArea(8, 8);
+
+    expect("check high cyclic region", !FLASH_REGION_CHECK(HC_CONFIG));
+    expect("check main flash region", !FLASH_REGION_CHECK(MAIN_LOG));
+
+    // an erased high cyclic sector is known to be erased, probing it reads no cell
+    expect("erase high cyclic sector", !FLASH_REGION_ERASE(HC_CONFIG, 120));
+    uint32_t blank = (HC_CONFIG_START - HIGH_CYCLIC_START_BANK1) / 2 / 32;
+    expect("erased sector marked blank", highCyclic_blankMap[blank] == 0xFFFFFFFFUL);
+
+    expect("program half-word", !FLASH_REGION_WRITE16(HC_CONFIG, 0x0004, 0x89AB));
+    expect("read half-word", FLASH_REGION_READ16(HC_CONFIG, 0x0004) == 0x89AB);
+
+    // a failed program must not block the following ones
+    expect("program half-word twice fails", FLASH_REGION_WRITE16(HC_CONFIG, 0x0004, 0x1234));
+    expect("error flags cleared", (FLASH->NSSR & FLASH_ERROR_FLAGS) == 0);
+    expect("program next half-word", !FLASH_REGION_WRITE16(HC_CONFIG, 0x0006, 0x1234));
+
+    // another operation holding the flash unlocked, e.g. a DMA-fed write
+    FLASH->NSCR &= ~FLASH_CR_LOCK;
+    expect("program refused while unlocked", FLASH_REGION_WRITE16(HC_CONFIG, 0x0008, 0x5678));
+    expect("erase refused while unlocked", FLASH_REGION_ERASE(HC_CONFIG, 121));
+    FLASH->NSCR |= FLASH_CR_LOCK;
+    expect("refused cell untouched", flashEmu_getCell((const void*) (HC_CONFIG_START + 0x0008)) == FLASH_EMU_CELL_ERASED);
+
+    expect("erase main flash sector", !FLASH_REGION_ERASE(MAIN_LOG, 100));
+    expect("program quad-word", !FLASH_REGION_WRITE128(MAIN_LOG, 0x0010, logEntry));
+    const uint32_t* entry = (const uint32_t*) (MAIN_LOG_START + 0x0010);
+    expect("read quad-word", entry[0] == logEntry[0] && entry[3] == logEntry[3]);
+
+    return failures != 0;
+}
@@ -0,0 +1,166 @@
+#include <math.h>
+#include <stdio.h>
+#include "hc_series.h"
+
+/*a slowly changing signal with a little noise, recorded into the eight high cyclic sectors of bank 2*/
+#define SERIES_SECTORS      8
+#define SERIES_PERIOD       10
+#define SERIES_SAMPLES      8000
+#define SERIES_GAP          5000        // sample behind a pause of the recording, starts a new block
+
+static hcSeries_t series;
+static uint32_t failures;
+
+static void expect(const char* what, const bool ok)
+{
+    printf("%-48s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok)
+    {
+        failures++;
+    }
+}
+
+/**
+ * @brief have erases and programs refused, as while another operation holds the flash unlocked
+ */
+static void refuseFlash(const bool refuse)
+{
+    if (refuse)
+    {
+        FLASH->NSCR &= ~FLASH_CR_LOCK;
+    }
+    else
+    {
+        FLASH->NSCR |= FLASH_CR_LOCK;
+    }
+}
+
+static uint32_t timestampOf(const uint32_t index)
+{
+    return 1000 + index * SERIES_PERIOD + (index >= SERIES_GAP ? 7 * SERIES_PERIOD : 0);
+}
+
+static int16_t valueOf(const uint32_t index)
+{
+    // a fixed pseudo random noise of -2 .. 2 on a slow sine
+    uint32_t noise = (index * 2654435761UL) >> 29;
+    return (int16_t) (2000.0 * sin(index / 300.0) + (int32_t) (noise % 5) - 2);
+}
+
+static bool openSeries(void)
+{
+    return hcSeries_open(&series, 2, HIGH_CYCLIC_PAGE_OFFSET, SERIES_SECTORS, SERIES_PERIOD);
+}
+
+/**
+ * @brief count the programmed stream half-words and the used blocks of the series
+ */
+static void streamUsage(uint32_t* words, uint32_t* blocks)
+{
+    *words = 0;
+    *blocks = 0;
+    for (uint32_t block = 0; block < series.blocks; block++)
+    {
+        uint32_t address = FLASH_GEOM_HC_SECTOR_ADDRESS(2, HIGH_CYCLIC_PAGE_OFFSET + block / HCSERIES_BLOCKS_PER_SECTOR) +
+                           (block % HCSERIES_BLOCKS_PER_SECTOR) * HCSERIES_BLOCK_SIZE;
+        flash_probeResult_t probe;
+        if (highCyclic_probe((const void*) address, HCSERIES_BLOCK_SIZE, NULL, &probe) || probe.erased == HCSERIES_BLOCK_SIZE / 2)
+        {
+            continue;
+        }
+        (void) highCyclic_probe((const void*) (address + sizeof(hcSeries_blockHeader_t)), HCSERIES_STREAM_WORDS * 2, NULL, &probe);
+        *words += probe.valid;
+        (*blocks)++;
+    }
+}
+
+/**
+ * @brief decode all samples in chunks and compare them with the signal
+ *
+ * @return amount of samples that are missing, extra or differ
+ */
+static uint32_t mismatches(const uint32_t expected)
+{
+    hcSeries_sample_t samples[64];
+    uint32_t found = 0;
+    uint32_t wrong = 0;
+    uint32_t from = 0;
+    uint32_t count;
+    while (!hcSeries_query(&series, from, 0xFFFFFFFFUL, samples, 64, &count) && count != 0)
+    {
+        for (uint32_t i = 0; i < count; i++, found++)
+        {
+            if (found >= expected || samples[i].timestamp != timestampOf(found) || samples[i].value != valueOf(found))
+            {
+                wrong++;
+            }
+        }
+        from = samples[count - 1].timestamp + 1;
+    }
+    return wrong + (found < expected ? expected - found : 0);
+}
+
+/**
+ * @brief record a signal, read it back across a restart and report the bits per sample
+ *
+ * @return 0 if every check passed, 1 otherwise
+ */
+int main(void)
+{
+    if (flashEmu_init())
+    {
+        return 1;
+    }
+    highCyclic_setArea(8, 8);
+    for (uint32_t sector = 0; sector < SERIES_SECTORS; sector++)
+    {
+        flash_erase(2, HIGH_CYCLIC_PAGE_OFFSET + sector);
+    }
+
+    expect("open an empty series", !openSeries());
+    bool appended = true;
+    for (uint32_t i = 0; i < SERIES_SAMPLES; i++)
+    {
+        appended = appended && !hcSeries_append(&series, timestampOf(i), valueOf(i));
+    }
+    expect("append 8000 samples", appended);
+    expect("flush", !hcSeries_flush(&series));
+
+    flashEmu_powerCycle();
+    expect("reopen", !openSeries());
+    uint32_t wrong = mismatches(SERIES_SAMPLES);
+    printf("round trip of %u samples, %u mismatches\n", SERIES_SAMPLES, (unsigned) wrong);
+    expect("every sample decodes to its value", wrong == 0);
+
+    uint32_t words;
+    uint32_t blocks;
+    streamUsage(&words, &blocks);
+    printf("%u stream half-words in %u blocks: %.2f bits per sample, %.2f with block overhead\n",
+           (unsigned) words, (unsigned) blocks, 16.0 * words / SERIES_SAMPLES,
+           8.0 * blocks * HCSERIES_BLOCK_SIZE / SERIES_SAMPLES);
+    expect("fewer than 16 bits per sample", words < SERIES_SAMPLES);
+
+    // a refused append leaves the series unchanged, the sample is appended again later
+    uint32_t i = SERIES_SAMPLES;
+    bool refused = false;
+    for (; i < SERIES_SAMPLES + 40; i++)
+    {
+        refuseFlash(i % 4 == 0);
+        refused = hcSeries_append(&series, timestampOf(i), valueOf(i)) && flash_refused();
+        refuseFlash(false);
+        if (refused && hcSeries_append(&series, timestampOf(i), valueOf(i)))
+        {
+            break;
+        }
+    }
+    expect("refused appends retried", i == SERIES_SAMPLES + 40);
+    refuseFlash(true);
+    expect("flush refused while the flash is held", hcSeries_flush(&series) && series.active != HCSERIES_NONE);
+    refuseFlash(false);
+    expect("retried flush", !hcSeries_flush(&series));
+
+    flashEmu_powerCycle();
+    expect("reopen after the refusals", !openSeries());
+    expect("every sample decodes once and in order", mismatches(SERIES_SAMPLES + 40) == 0);
+    return failures != 0;
+}
@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include "hc_tier.h"
+
+/*a hot store in four high cyclic sectors of bank 2 and a cold one in four main flash sectors of bank 1*/
+#define TIER_SECTORS        4
+#define TIER_MAIN_SECTOR    100
+#define TIER_KEY            7
+
+static hcStore_t hot;
+static hcStore_t cold;
+static hcTier_t tier;
+
+static uint32_t failures;
+
+static void expect(const char* what, const bool ok)
+{
+    printf("%-48s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok)
+    {
+        failures++;
+    }
+}
+
+static bool mount(void)
+{
+    if (hcStore_mount(&hot, 2, HIGH_CYCLIC_PAGE_OFFSET, TIER_SECTORS) ||
+        hcStore_mountMain(&cold, 1, TIER_MAIN_SECTOR, TIER_SECTORS))
+    {
+        return true;
+    }
+    hcTier_init(&tier, &hot, &cold);
+    return false;
+}
+
+static bool holds(const uint32_t expected)
+{
+    uint32_t value;
+    return !hcTier_read(&tier, TIER_KEY, &value, sizeof(value)) && value == expected;
+}
+
+/**
+ * @brief move a key between the tiers by writing and aging it, across restarts and an interrupted move
+ *
+ * @return 0 if the tiers behaved as expected, 1 otherwise
+ */
+int main(void)
+{
+    if (flashEmu_init())
+    {
+        return 1;
+    }
+    highCyclic_setArea(8, 8);
+    expect("mount both stores", !mount());
+
+    uint32_t value = 0;
+    for (uint32_t i = 1; i < HCTIER_HOT_WRITES; i++)
+    {
+        value = i;
+        (void) hcTier_write(&tier, TIER_KEY, &value, sizeof(value));
+    }
+    expect("new key starts cold", !hcTier_isHot(&tier, TIER_KEY) && holds(value));
+
+    value = HCTIER_HOT_WRITES;
+    expect("write within the period", !hcTier_write(&tier, TIER_KEY, &value, sizeof(value)));
+    expect("promoted after HCTIER_HOT_WRITES writes", hcTier_isHot(&tier, TIER_KEY) && holds(value));
+    uint16_t length = 1;
+    expect("emptied in the cold store", hcStore_find(&cold, TIER_KEY, &length) != NULL && length == 0);
+
+    // the statistics are lost on a restart, the hot store still holds the key
+    flashEmu_powerCycle();
+    expect("remount both stores", !mount());
+    expect("still hot after a restart", hcTier_isHot(&tier, TIER_KEY) && holds(value));
+
+    for (uint32_t period = 1; period < HCTIER_COLD_PERIODS; period++)
+    {
+        (void) hcTier_age(&tier);
+    }
+    expect("hot until HCTIER_COLD_PERIODS idle periods", hcTier_isHot(&tier, TIER_KEY));
+    expect("age the last period", !hcTier_age(&tier));
+    expect("demoted and value kept", !hcTier_isHot(&tier, TIER_KEY) && holds(value));
+
+    // a move cut by a power loss after writing the destination: the key is in both stores
+    value = 100;
+    expect("write the hot copy of an interrupted move", !hcStore_write(&hot, TIER_KEY, &value, sizeof(value)));
+    flashEmu_powerCycle();
+    expect("remount with the key in both stores", !mount());
+    expect("hot copy wins", hcTier_isHot(&tier, TIER_KEY) && holds(100));
+    value = 101;
+    expect("write goes to the hot store", !hcTier_write(&tier, TIER_KEY, &value, sizeof(value)) && holds(101) &&
+                                           hcTier_find(&tier, TIER_KEY, NULL) == hcStore_find(&hot, TIER_KEY, NULL));
+    for (uint32_t period = 0; period <= HCTIER_COLD_PERIODS; period++)
+    {
+        (void) hcTier_age(&tier);
+    }
+    expect("demoted again with the newer value", !hcTier_isHot(&tier, TIER_KEY) && holds(101));
+
+    return failures != 0;
+}
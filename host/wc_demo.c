@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <string.h>
+#include "flash_wc.h"
+
+/*a trace of byte granular events in two main flash sectors of bank 1*/
+#define WC_SECTOR           100
+#define WC_SIZE             (2 * FLASH_PAGE_SIZE)
+
+static uint32_t failures;
+
+static void expect(const char* what, const bool ok)
+{
+    printf("%-48s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok)
+    {
+        failures++;
+    }
+}
+
+/**
+ * @brief have erases and programs refused, as while another operation holds the flash unlocked
+ */
+static void refuseFlash(const bool refuse)
+{
+    if (refuse)
+    {
+        FLASH->NSCR &= ~FLASH_CR_LOCK;
+    }
+    else
+    {
+        FLASH->NSCR |= FLASH_CR_LOCK;
+    }
+}
+
+/**
+ * @brief append, flush and resume a trace across restarts, and retry appends that were refused
+ *
+ * @return 0 if every check passed, 1 otherwise
+ */
+int main(void)
+{
+    if (flashEmu_init())
+    {
+        return 1;
+    }
+    uint8_t* first = (uint8_t*) FLASH_GEOM_SECTOR_ADDRESS(1, WC_SECTOR);
+    flash_erase(1, WC_SECTOR);
+    flash_erase(1, WC_SECTOR + 1);
+
+    uint8_t events[100];
+    for (uint32_t i = 0; i < sizeof(events); i++)
+    {
+        events[i] = (uint8_t) (i * 13 + 1);
+    }
+
+    flashWc_t wc;
+    expect("open an erased region at its start", !flashWc_open(&wc, first, WC_SIZE) && flashWc_tail(&wc) == (uint32_t) first);
+    expect("append 37 bytes, 5 stay collected in RAM", !flashWc_append(&wc, events, 37) && wc.fill == 5);
+    uint8_t buffer[100];
+    expect("read back programmed and collected bytes",
+           !flashWc_read(&wc, first, buffer, 37) && memcmp(buffer, events, 37) == 0);
+    expect("flush pads the collected quad-word", !flashWc_flush(&wc) && flashWc_tail(&wc) == (uint32_t) first + 48);
+
+    // the appended bytes and the padding survive, the writer continues behind them
+    flashEmu_powerCycle();
+    expect("reopen resumes behind the flushed quad-word", !flashWc_open(&wc, first, WC_SIZE) && flashWc_tail(&wc) == (uint32_t) first + 48);
+    expect("the flushed bytes survived the restart", memcmp(first, events, 37) == 0 && first[37] == 0xFF);
+
+    // unflushed bytes are lost by a restart, their quad-word stays erased and is appended to again
+    expect("append 10 bytes without flushing", !flashWc_append(&wc, events + 37, 10));
+    flashEmu_powerCycle();
+    expect("reopen after losing the collected bytes", !flashWc_open(&wc, first, WC_SIZE) && flashWc_tail(&wc) == (uint32_t) first + 48);
+
+    // a refused append stops in front of the quad-word it could not program, the rest follows later
+    expect("append 10 bytes", !flashWc_append(&wc, events + 37, 10));
+    uint32_t tail = flashWc_tail(&wc);
+    refuseFlash(true);
+    expect("append refused while the flash is held", flashWc_append(&wc, events + 47, 30) && flash_refused());
+    refuseFlash(false);
+    expect("the refused append left the tail unchanged", flashWc_tail(&wc) == tail);
+    expect("retried append", !flashWc_append(&wc, events + 47, 30) && flashWc_tail(&wc) == tail + 30);
+    refuseFlash(true);
+    expect("flush refused while the flash is held", flashWc_flush(&wc) && flash_refused() && wc.fill != 0);
+    refuseFlash(false);
+    expect("retried flush", !flashWc_flush(&wc));
+    expect("the bytes are appended once and in order", memcmp(first + 48, events + 37, 40) == 0);
+
+    flashEmu_powerCycle();
+    expect("reopen resumes behind the retried bytes", !flashWc_open(&wc, first, WC_SIZE) && flashWc_tail(&wc) == (uint32_t) first + 96);
+
+    // whole quad-words of aligned data go to the flash directly
+    refuseFlash(true);
+    expect("aligned append refused", flashWc_append(&wc, events, 64) && flashWc_tail(&wc) == (uint32_t) first + 96);
+    refuseFlash(false);
+    expect("aligned append retried", !flashWc_append(&wc, events, 64) && flashWc_tail(&wc) == (uint32_t) first + 160);
+    expect("aligned quad-words programmed", memcmp(first + 96, events, 64) == 0);
+
+    expect("append beyond the region fails", flashWc_append(&wc, events, WC_SIZE));
+    return failures != 0;
+}
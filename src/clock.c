@@ -0,0 +1,161 @@
+#include "clock.h"
+#include "flash_ll.h"
+
+#define RETURN_TRUE_IF_TRUE(cond) if(cond) {return true;}
+
+#define CLOCK_HSI_HZ            64000000UL
+#define CLOCK_SW_HSI            0
+#define CLOCK_SW_PLL1           3
+#define CLOCK_PLL1_SRC_HSI      1
+#define CLOCK_PLL1_RGE_2_4MHZ   1
+
+// per voltage scale: highest SYSCLK at 0 wait states, every wait state adds the same range again,
+// and the rated maximum of SYSCLK
+static const struct
+{
+    uint16_t zeroWaitMHz;
+    uint16_t maxMHz;
+} clock_flashTable[] =
+{
+    [CLOCK_VOS3] = {20, 100},
+    [CLOCK_VOS2] = {30, 150},
+    [CLOCK_VOS1] = {34, 200},
+    [CLOCK_VOS0] = {42, 250},
+};
+
+static uint32_t clock_sysclkHz = CLOCK_HSI_HZ / 2;
+
+/**
+ * @brief frequency of hsi_ck after the HSI divider
+ */
+static uint32_t clock_hsiHz(void)
+{
+    return CLOCK_HSI_HZ >> ((RCC->CR & RCC_CR_HSIDIV_Msk) >> RCC_CR_HSIDIV_Pos);
+}
+
+static clock_vos_t clock_activeVos(void)
+{
+    return (clock_vos_t) ((PWR->VOSSR & PWR_VOSSR_ACTVOS_Msk) >> PWR_VOSSR_ACTVOS_Pos);
+}
+
+static void clock_switch(const uint32_t source)
+{
+    RCC->CFGR1 = (RCC->CFGR1 & ~RCC_CFGR1_SW_Msk) | (source << RCC_CFGR1_SW_Pos);
+    while (((RCC->CFGR1 & RCC_CFGR1_SWS_Msk) >> RCC_CFGR1_SWS_Pos) != source) {}
+}
+
+/**
+ * @brief smallest flash read latency and programming delay for a clock and voltage scale
+ *
+ * @param sysclkHz the fastest SYSCLK the timing has to cover
+ * @param vos voltage scale in effect
+ * @param timing receives the timing
+ * @return false    OK
+ * @return true     Error: the frequency exceeds the rating of the voltage scale
+ */
+bool clock_flashTiming(const uint32_t sysclkHz, const clock_vos_t vos, clock_flashTiming_t* timing)
+{
+    RETURN_TRUE_IF_TRUE(vos > CLOCK_VOS0)
+    RETURN_TRUE_IF_TRUE(sysclkHz > clock_flashTable[vos].maxMHz * 1000000UL)
+
+    const uint32_t stepHz = clock_flashTable[vos].zeroWaitMHz * 1000000UL;
+    const uint32_t latency = sysclkHz ? (sysclkHz - 1) / stepHz : 0;
+
+    // the programming delay steps up every second wait state
+    timing->latency = latency;
+    timing->wrHighFreq = latency / 2;
+    return false;
+}
+
+/**
+ * @brief program FLASH->ACR for a clock and voltage scale, with prefetch on
+ *
+ * @param sysclkHz the fastest SYSCLK until the next call
+ * @param vos voltage scale in effect
+ * @return false    OK
+ * @return true     Error: the frequency is not rated or the ACR did not take the value
+ */
+bool clock_setFlashTiming(const uint32_t sysclkHz, const clock_vos_t vos)
+{
+    clock_flashTiming_t timing;
+    RETURN_TRUE_IF_TRUE(clock_flashTiming(sysclkHz, vos, &timing))
+
+    // WRHIGHFREQ must not change during an erase or a program
+    FLASH_WAIT_BSY();
+
+    const uint32_t acr = (FLASH->ACR & ~(FLASH_ACR_LATENCY_Msk | FLASH_ACR_WRHIGHFREQ_Msk))
+                       | (timing.latency << FLASH_ACR_LATENCY_Pos)
+                       | (timing.wrHighFreq << FLASH_ACR_WRHIGHFREQ_Pos)
+                       | FLASH_ACR_PRFTEN;
+    FLASH->ACR = acr;
+
+    // the new latency is in effect once it reads back
+    RETURN_TRUE_IF_TRUE(FLASH->ACR != acr)
+    return false;
+}
+
+/**
+ * @brief run SYSCLK from PLL1 at the rated maximum, in VOS0, with matching flash timing
+ *
+ * @return false    OK
+ * @return true     Error: the flash timing could not be set, SYSCLK is left on HSI and VOS0 may
+ *                  already be in effect
+ */
+bool clock_init(void)
+{
+    // PLL1 cannot be reconfigured while it drives SYSCLK
+    RETURN_TRUE_IF_TRUE(clock_useHsi())
+
+    // raise the voltage scale first, a higher scale never needs more wait states
+    PWR->VOSCR = (PWR->VOSCR & ~PWR_VOSCR_VOS_Msk) | (CLOCK_VOS0 << PWR_VOSCR_VOS_Pos);
+    while (!(PWR->VOSSR & PWR_VOSSR_VOSRDY)) {}
+
+    // flash timing for the new clock, the current one is slower
+    RETURN_TRUE_IF_TRUE(clock_setFlashTiming(CLOCK_SYSCLK_MAX_HZ, CLOCK_VOS0))
+
+    // hsi_ck / M = 2 MHz reference, * N = 500 MHz in the wide VCO range, / P = 250 MHz
+    RCC->PLL1CFGR = (CLOCK_PLL1_SRC_HSI << RCC_PLL1CFGR_PLL1SRC_Pos)
+                  | (CLOCK_PLL1_RGE_2_4MHZ << RCC_PLL1CFGR_PLL1RGE_Pos)
+                  | ((clock_hsiHz() / CLOCK_PLL1_REF_HZ) << RCC_PLL1CFGR_PLL1M_Pos)
+                  | RCC_PLL1CFGR_PLL1PEN;
+    RCC->PLL1DIVR = ((CLOCK_PLL1_N - 1) << RCC_PLL1DIVR_PLL1N_Pos)
+                  | ((CLOCK_PLL1_P - 1) << RCC_PLL1DIVR_PLL1P_Pos);
+    RCC->CR |= RCC_CR_PLL1ON;
+    while (!(RCC->CR & RCC_CR_PLL1RDY)) {}
+
+    // AHB and APB run undivided, all are rated for the full SYSCLK in VOS0
+    RCC->CFGR2 &= ~(RCC_CFGR2_HPRE_Msk | RCC_CFGR2_PPRE1_Msk | RCC_CFGR2_PPRE2_Msk | RCC_CFGR2_PPRE3_Msk);
+
+    clock_switch(CLOCK_SW_PLL1);
+    clock_sysclkHz = CLOCK_SYSCLK_MAX_HZ;
+    return false;
+}
+
+/**
+ * @brief run SYSCLK from HSI, stop PLL1 and lower the flash timing to match
+ *
+ * @return false    OK
+ * @return true     Error: the flash timing could not be set
+ */
+bool clock_useHsi(void)
+{
+    if (((RCC->CFGR1 & RCC_CFGR1_SWS_Msk) >> RCC_CFGR1_SWS_Pos) != CLOCK_SW_HSI)
+    {
+        clock_switch(CLOCK_SW_HSI);
+    }
+    clock_sysclkHz = clock_hsiHz();
+
+    RCC->CR &= ~RCC_CR_PLL1ON;
+    while (RCC->CR & RCC_CR_PLL1RDY) {}
+
+    // lower the latency only after the clock went down
+    return clock_setFlashTiming(clock_sysclkHz, clock_activeVos());
+}
+
+/**
+ * @brief current SYSCLK frequency
+ */
+uint32_t clock_getSysclk(void)
+{
+    return clock_sysclkHz;
+}
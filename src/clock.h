@@ -0,0 +1,46 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+/**
+ * @file clock.h
+ * @brief system clock and the flash read timing that goes with it
+ *
+ * After reset the core runs from HSI at 32 MHz in voltage scale VOS3, with the reset flash timing
+ * and prefetch off. clock_init() raises the voltage scale to VOS0 and runs SYSCLK from PLL1 at
+ * the rated maximum of 250 MHz, fed by HSI, so no crystal is needed.
+ *
+ * FLASH->ACR LATENCY and WRHIGHFREQ have to cover the fastest clock of a transition and the
+ * voltage scale in effect. Going up, they are raised before the switch; going down, they are
+ * lowered after it. Both are only changed while the flash is idle.
+ */
+#include "flash.h"
+
+// rated maximum of SYSCLK in VOS0
+#define CLOCK_SYSCLK_MAX_HZ     250000000UL
+
+// PLL1 reference clock, divided down from hsi_ck by PLL1M
+#define CLOCK_PLL1_REF_HZ       2000000UL
+#define CLOCK_PLL1_N            250
+#define CLOCK_PLL1_P            2
+
+// voltage scales as encoded in PWR->VOSCR VOS, VOS0 runs fastest
+typedef enum
+{
+    CLOCK_VOS3 = 0,
+    CLOCK_VOS2,
+    CLOCK_VOS1,
+    CLOCK_VOS0,
+} clock_vos_t;
+
+typedef struct
+{
+    uint8_t latency;            // FLASH->ACR LATENCY, read wait states
+    uint8_t wrHighFreq;         // FLASH->ACR WRHIGHFREQ, programming delay
+} clock_flashTiming_t;
+
+extern bool clock_init(void);
+extern bool clock_useHsi(void);
+extern uint32_t clock_getSysclk(void);
+extern bool clock_flashTiming(const uint32_t sysclkHz, const clock_vos_t vos, clock_flashTiming_t* timing);
+extern bool clock_setFlashTiming(const uint32_t sysclkHz, const clock_vos_t vos);
+
+#endif // CLOCK_H
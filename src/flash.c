@@ -1,19 +1,18 @@
 
+#include <stddef.h>
 #include "flash.h"
+#include "flash_ll.h"
+#include "flash_dma.h"
+#include "flash_ecc.h"
+#include "flash_ob.h"
 #define CHECK_HDP
 #define CHECK_WRP
 #define WRITE_CRITICAL_SECTION
 
-#define FLASH_KEY1              (0x45670123UL)
-#define FLASH_KEY2              (0xCDEF89ABUL)
-#define FLASH_OPT_KEY1          (0x08192A3BUL)
-#define FLASH_OPT_KEY2          (0x4C5D6E7FUL)
-
-#define FLASH_ERROR_FLAGS       (FLASH_SR_OPTCHANGEERR | FLASH_SR_INCERR | FLASH_SR_STRBERR | FLASH_SR_PGSERR | FLASH_SR_WRPERR)
-#define FLASH_OP_INCOMPLETE     (FLASH_SR_BSY | FLASH_SR_DBNE | FLASH_SR_WBNE)
-
 #define RETURN_TRUE_IF_TRUE(cond) if(cond) {return true;}
 
+uint32_t highCyclic_blankMap[HIGH_CYCLIC_BLANK_MAP_WORDS];
+
 #ifdef CHECK_WRP
 /**
  * @brief Checks if WRP applies to the supplied sector range
@@ -95,6 +94,22 @@ static bool checkHDP(const uint32_t startSector, const uint32_t endSector, const
 }
 #endif
 
+/**
+ * @brief get the amount of sectors currently configured as high cyclic memory in a bank
+ * 
+ * @param bank the bank, 1 or 2
+ * @return amount of sectors, 0 if high cyclic memory is disabled
+ */
+uint32_t highCyclic_getSectorCount(const uint32_t bank)
+{
+    uint32_t eDataReg = (bank == 1) ? FLASH->EDATA1R_CUR : FLASH->EDATA2R_CUR;
+    if ((eDataReg & FLASH_EDATAR_EDATA_EN) == 0)
+    {
+        return 0;
+    }
+    return 1 + ((eDataReg & FLASH_EDATAR_EDATA_STRT_Msk) >> FLASH_EDATAR_EDATA_STRT_Pos);
+}
+
 /**
  * @brief get the corresponding bank number (1/2) for an address range in high cyclic memory
  * 
@@ -104,23 +119,17 @@ static bool checkHDP(const uint32_t startSector, const uint32_t endSector, const
  */
 static uint32_t highCyclic_getBank(const void* address, const uint32_t size)
 {
-    uint32_t sectorCount1 = 0;
-    if (FLASH->EDATA1R_CUR & FLASH_EDATAR_EDATA_EN)
-    {
-        sectorCount1 = 1 + ((FLASH->EDATA1R_CUR & FLASH_EDATAR_EDATA_STRT_Msk) >> FLASH_EDATAR_EDATA_STRT_Pos);
-    }
-    uint32_t sectorCount2 = 0;
-    if (FLASH->EDATA2R_CUR & FLASH_EDATAR_EDATA_EN)
-    {
-        sectorCount2 = 1 + ((FLASH->EDATA2R_CUR & FLASH_EDATAR_EDATA_STRT_Msk) >> FLASH_EDATAR_EDATA_STRT_Pos);
-    }
+    uint32_t sectorCount1 = highCyclic_getSectorCount(1);
+    uint32_t sectorCount2 = highCyclic_getSectorCount(2);
 
-    if ((uint32_t) address >= (HIGH_CYCLIC_END_BANK1 - HIGH_CYCLIC_SECTOR_SIZE * sectorCount1) &&
+    if (sectorCount1 > 0 &&
+            (uint32_t) address >= FLASH_GEOM_HC_AREA_START(1, sectorCount1) &&
             ((uint32_t) address + size - 1 <= HIGH_CYCLIC_END_BANK1))
     {
         return 1;
     }
-    else if ((uint32_t) address >= (HIGH_CYCLIC_END_BANK2 - HIGH_CYCLIC_SECTOR_SIZE * sectorCount2) &&
+    else if (sectorCount2 > 0 &&
+            (uint32_t) address >= FLASH_GEOM_HC_AREA_START(2, sectorCount2) &&
             ((uint32_t) address + size - 1 <= HIGH_CYCLIC_END_BANK2))
     {
         return 2;
@@ -160,84 +169,31 @@ static uint32_t flash_getBank(const void* address, const uint32_t size)
     }
 }
 
-/**
- * @brief unlock the Flash for modification by unlocking NSKEYR
- */
-static void unlockFlash()
-{
-    FLASH->NSKEYR = FLASH_KEY1;
-    FLASH->NSKEYR = FLASH_KEY2;
-}
+// the last erase or program was refused before it touched the flash, see flash_refused()
+static bool refused;
 
 /**
- * @brief unlock the Flash for modification of option bytes by unlocking OPTKEYR
+ * @brief wait for a DMA-fed write to finish, then check that the flash is free for an own operation
+ * @note the DMA write finishes in the GPDMA interrupt, do not erase or program from interrupts of
+ *       a higher priority while one may be running
+ *
+ * @return false    OK, the flash is locked and idle
+ * @return true     Error: another operation holds the flash or left an error flag, see flash_refused()
  */
-static void unlockFlashOptionBytes()
+static bool flash_claim(void)
 {
-    FLASH->OPTKEYR = FLASH_OPT_KEY1;
-    FLASH->OPTKEYR = FLASH_OPT_KEY2;
+    (void) flashDma_writeWait();
+    refused = !flash_isIdle();
+    return refused;
 }
 
 /**
- * @brief set the area of which pages should be treated as high cyclic
- * 
- * @param reg the EDATAR for the corresponding bank to set the area for
- * @param sectorCount the amount of sectors to use. 0 deactivates high cyclic memory
+ * @brief unlock the Flash for modification by unlocking NSKEYR
  */
-static void highCyclic_setArea_internal(const uint32_t bank, const uint32_t sectorCount)
+static void unlockFlash()
 {
-    volatile uint32_t *eDataRegCur;
-    volatile uint32_t *eDataRegProg;
-    if (bank == 1)
-    {
-        eDataRegCur = &(FLASH->EDATA1R_CUR);
-        eDataRegProg = &(FLASH->EDATA1R_PRG);
-    }
-    else if (bank == 2)
-    {
-        eDataRegCur = &(FLASH->EDATA2R_CUR);
-        eDataRegProg = &(FLASH->EDATA2R_PRG);
-    }
-    else
-    {
-        return;
-    }
-
-    uint32_t configuration;
-    if (sectorCount > 0)
-    {
-        configuration = FLASH_EDATAR_EDATA_EN | (((sectorCount - 1) & 0x7) << FLASH_EDATAR_EDATA_STRT_Pos);
-    }
-    else
-    {
-        configuration = (0 << FLASH_EDATAR_EDATA_EN_Pos) | (0 << FLASH_EDATAR_EDATA_STRT_Pos);
-    }
-
-    // check if configuration is already present
-    if (*eDataRegCur == configuration)
-    {
-        return;
-    }
-
-    // check error flags and BSY, DBNE, WBNE
-    RETURN_TRUE_IF_TRUE((FLASH->NSSR & (FLASH_ERROR_FLAGS | FLASH_OP_INCOMPLETE)) != 0)
-
-    // unlock flash option bytes
-    unlockFlashOptionBytes();
-    
-
-    // write configuration data into programming register
-    *eDataRegProg = configuration;
-
-    // start flashing
-    FLASH->OPTCR |= FLASH_OPTCR_OPTSTART;
-
-    // wait for bsy clear
-    while (FLASH->NSSR & FLASH_SR_BSY) {};
-
-    // lock flash again
-    FLASH->OPTCR = FLASH_OPTCR_OPTLOCK;
-
+    FLASH->NSKEYR = FLASH_KEY1;
+    FLASH->NSKEYR = FLASH_KEY2;
 }
 
 /**
@@ -249,6 +205,8 @@ static void highCyclic_setArea_internal(const uint32_t bank, const uint32_t sect
  */
 static bool flashErase(const uint32_t bank, const uint32_t page)
 {
+    refused = false;
+
     // error if page number is invalid
     RETURN_TRUE_IF_TRUE(!(bank == 1 || bank == 2))
     RETURN_TRUE_IF_TRUE(page >= FLASH_PAGES_PER_BANK)
@@ -263,9 +221,8 @@ static bool flashErase(const uint32_t bank, const uint32_t page)
     RETURN_TRUE_IF_TRUE(checkWRP(page, page, bank))
 #endif
 
-    // any flash error in status-register?
-    // also check BSY, DBNE, WBNE
-    RETURN_TRUE_IF_TRUE((FLASH->NSSR & (FLASH_ERROR_FLAGS | FLASH_OP_INCOMPLETE)) != 0)
+    // any flash error in status-register? also check BSY, DBNE, WBNE and a DMA-fed write in progress
+    RETURN_TRUE_IF_TRUE(flash_claim())
 
     // unlock NSCR if not yet unlocked
     unlockFlash();
@@ -274,18 +231,20 @@ static bool flashErase(const uint32_t bank, const uint32_t page)
         for (;;) {}
     }
 
+    // a partial erase leaves the high cyclic cells undefined
+    highCyclic_forgetSector(bank, page);
+
     // set bksel, ser and snb in NSCR
-    uint32_t nscrMsk = FLASH_CR_OPTCHANGEERRIE | FLASH_CR_INCERRIE | FLASH_CR_STRBERRIE | FLASH_CR_PGSERRIE | FLASH_CR_WRPERRIE | FLASH_CR_EOPIE;
-    FLASH->NSCR = (FLASH->NSCR & nscrMsk) | (page << FLASH_CR_SNB_Pos) | ((bank-1) << FLASH_CR_BKSEL_Pos) | FLASH_CR_SER;
+    FLASH->NSCR = (FLASH->NSCR & FLASH_CR_INTERRUPTS) | (page << FLASH_CR_SNB_Pos) | ((bank-1) << FLASH_CR_BKSEL_Pos) | FLASH_CR_SER;
     
     // wait for bsy clear
-    while (FLASH->NSSR & FLASH_SR_BSY) {};
+    FLASH_WAIT_BSY();
 
     // set strt in nscr
     FLASH->NSCR |= FLASH_CR_START;
 
     // wait for bsy clear
-    while (FLASH->NSSR & FLASH_SR_BSY) {};
+    FLASH_WAIT_BSY();
 
     // clear ser
     FLASH->NSCR &= ~FLASH_CR_SER_Msk;
@@ -293,26 +252,35 @@ static bool flashErase(const uint32_t bank, const uint32_t page)
     // lock flash again
     FLASH->NSCR = FLASH_CR_LOCK;
 
+    // cached main flash content is outdated
+    flashCache_invalidate();
+
     // check for errors again
-    RETURN_TRUE_IF_TRUE((FLASH->NSSR & FLASH_ERROR_FLAGS) != 0)
+    RETURN_TRUE_IF_TRUE(flash_takeErrors())
+
+    // every cell of an erased high cyclic sector is virgin
+    if (page >= FLASH_PAGES_PER_BANK - highCyclic_getSectorCount(bank))
+    {
+        highCyclic_markSectorBlank(bank, page);
+    }
 
     return false;
 }
 
 /**
- * @brief write 128 Bit quad-words into main flash
- * @warning WRITE_CRITICAL_SECTION deaktivates all interrupts for the critical write section. define as required.
+ * @brief check a main flash range and enter quad-word programming mode
  * @note CHECK_HDP defines if the addresses should be checked for HDP locks
  * @note CHECK_WRP defines if the addresses should be checked for WRP locks
  *
  * @param address   pointer to target address in flash
- * @param data      pointer to data
  * @param size      amount of bytes to write, has to be multiple of 16
- * @return true     OK
- * @return false    Error
+ * @return false    OK, the flash is unlocked with PG set
+ * @return true     Error, nothing was changed
  */
-static bool flashWrite128 (uint32_t *address, const uint32_t *data, const uint32_t size)
+bool flash_program128Begin(const uint32_t *address, const uint32_t size)
 {
+    refused = false;
+
     // Address 128 Bit aligned?
     RETURN_TRUE_IF_TRUE(((uint32_t)address & 0x0000000f) != 0)
     // size multiple of 128 Bit?
@@ -324,9 +292,8 @@ static bool flashWrite128 (uint32_t *address, const uint32_t *data, const uint32
     
     // calculate sector if HDP or WRP should be checked
 #if defined(CHECK_HDP) || defined(CHECK_WRP)
-    uint32_t bankStart = (bank == 1) ? FLASH_START_BANK1 : FLASH_START_BANK2;
-    uint32_t startSector = (((uint32_t) address) - bankStart) / FLASH_PAGES_PER_BANK;
-    uint32_t endSector = (((uint32_t) address) + (size - 1) - bankStart) / FLASH_PAGES_PER_BANK;
+    uint32_t startSector = FLASH_GEOM_SECTOR_OF(bank, (uint32_t) address);
+    uint32_t endSector = FLASH_GEOM_SECTOR_OF(bank, (uint32_t) address + (size - 1));
 #ifdef CHECK_HDP
         RETURN_TRUE_IF_TRUE(checkHDP(startSector, endSector, bank))
 #endif
@@ -335,13 +302,59 @@ static bool flashWrite128 (uint32_t *address, const uint32_t *data, const uint32
 #endif
 #endif
 
-    // Any Flash Error in Status-Register and not Busy?
-    RETURN_TRUE_IF_TRUE((FLASH->NSSR & (FLASH_ERROR_FLAGS | FLASH_OP_INCOMPLETE)) != 0)
+    // Any Flash Error in Status-Register and not Busy? A DMA-fed write in progress is waited for
+    RETURN_TRUE_IF_TRUE(flash_claim())
 
     unlockFlash();
 
-    uint32_t nscrMsk = FLASH_CR_OPTCHANGEERRIE | FLASH_CR_INCERRIE | FLASH_CR_STRBERRIE | FLASH_CR_PGSERRIE | FLASH_CR_WRPERRIE | FLASH_CR_EOPIE;
-    FLASH->NSCR = (FLASH->NSCR & nscrMsk) | FLASH_CR_PG;
+    FLASH->NSCR = (FLASH->NSCR & FLASH_CR_INTERRUPTS) | FLASH_CR_PG;
+
+    return false;
+}
+
+/**
+ * @brief wait for the last quad-word, leave programming mode and lock the flash
+ *
+ * @return false    OK
+ * @return true     Error, a program failed or a quad-word was left incomplete in the write buffer
+ */
+bool flash_program128End(void)
+{
+    // wait for bsy clear
+    FLASH_WAIT_BSY();
+
+    // an incomplete quad-word is dropped, not padded by a forced write
+    bool incomplete = (FLASH->NSSR & FLASH_SR_WBNE) != 0;
+
+    // clear ser
+    FLASH->NSCR &= ~FLASH_CR_PG;
+
+    // lock flash again
+    FLASH->NSCR = FLASH_CR_LOCK;
+
+    // cached main flash content is outdated
+    flashCache_invalidate();
+
+    // check for errors again
+    RETURN_TRUE_IF_TRUE(incomplete)
+    RETURN_TRUE_IF_TRUE(flash_takeErrors())
+
+    return false;
+}
+
+/**
+ * @brief write 128 Bit quad-words into main flash
+ * @warning WRITE_CRITICAL_SECTION deaktivates all interrupts for the critical write section. define as required.
+ *
+ * @param address   pointer to target address in flash
+ * @param data      pointer to data
+ * @param size      amount of bytes to write, has to be multiple of 16
+ * @return true     OK
+ * @return false    Error
+ */
+static bool flashWrite128 (uint32_t *address, const uint32_t *data, const uint32_t size)
+{
+    RETURN_TRUE_IF_TRUE(flash_program128Begin(address, size))
 
     // Write Data Section
 #ifdef WRITE_CRITICAL_SECTION
@@ -353,13 +366,13 @@ static bool flashWrite128 (uint32_t *address, const uint32_t *data, const uint32
     for (uint32_t i = 0; i < size; i += 16)
     {
         // program quad-word
-        *address++ = *data++;             // program first 32 bit
-        *address++ = *data++;             // program second 32 bit
-        *address++ = *data++;             // program third 32 bit
-        *address++ = *data++;             // program fourth 32 bit
+        FLASH_PROGRAM32(address++, *data++);  // program first 32 bit
+        FLASH_PROGRAM32(address++, *data++);  // program second 32 bit
+        FLASH_PROGRAM32(address++, *data++);  // program third 32 bit
+        FLASH_PROGRAM32(address++, *data++);  // program fourth 32 bit
 
         // wait for bsy clear
-        while (FLASH->NSSR & FLASH_SR_BSY) {};
+        FLASH_WAIT_BSY();
     }
     
 #ifdef WRITE_CRITICAL_SECTION
@@ -368,20 +381,7 @@ static bool flashWrite128 (uint32_t *address, const uint32_t *data, const uint32
 #endif
 
     // cleanup after write and check errors
-
-    // wait for bsy clear
-    while (FLASH->NSSR & FLASH_SR_BSY) {};
-
-    // clear ser
-    FLASH->NSCR &= ~FLASH_CR_PG;
-
-    // lock flash again
-    FLASH->NSCR = FLASH_CR_LOCK;
-
-    // check for errors again
-    RETURN_TRUE_IF_TRUE((FLASH->NSSR & FLASH_ERROR_FLAGS) != 0)
-
-    return false;
+    return flash_program128End();
 }
 
 /**
@@ -398,6 +398,8 @@ static bool flashWrite128 (uint32_t *address, const uint32_t *data, const uint32
  */
 static bool highCyclic_write16(uint16_t *address, const uint16_t *data, const uint32_t size)
 {
+    refused = false;
+
     // Address 128 Bit aligned?
     RETURN_TRUE_IF_TRUE(((uint32_t)address & 0x00000001) != 0)
     // size multiple of 16 Bit?
@@ -409,9 +411,8 @@ static bool highCyclic_write16(uint16_t *address, const uint16_t *data, const ui
 
     // calculate sector if HDP or WRP should be checked
 #if defined(CHECK_HDP) || defined(CHECK_WRP)
-    uint32_t highCyclicBankStart = (bank == 1) ? HIGH_CYCLIC_START_BANK1 : HIGH_CYCLIC_START_BANK2;
-    uint32_t startSector = HIGH_CYCLIC_PAGE_OFFSET + (((uint32_t) address) - highCyclicBankStart) / HIGH_CYCLIC_SECTOR_SIZE;
-    uint32_t endSector = HIGH_CYCLIC_PAGE_OFFSET + (((uint32_t) address) + (size - 1) - highCyclicBankStart) / HIGH_CYCLIC_SECTOR_SIZE;
+    uint32_t startSector = FLASH_GEOM_HC_SECTOR_OF(bank, (uint32_t) address);
+    uint32_t endSector = FLASH_GEOM_HC_SECTOR_OF(bank, (uint32_t) address + (size - 1));
 #ifdef CHECK_HDP
     RETURN_TRUE_IF_TRUE(checkHDP(startSector, endSector, bank))
 #endif
@@ -420,13 +421,12 @@ static bool highCyclic_write16(uint16_t *address, const uint16_t *data, const ui
 #endif
 #endif
 
-    // Any Flash Error in Status-Register and not Busy?
-    RETURN_TRUE_IF_TRUE((FLASH->NSSR & (FLASH_ERROR_FLAGS | FLASH_OP_INCOMPLETE)) != 0)
+    // Any Flash Error in Status-Register and not Busy? A DMA-fed write in progress is waited for
+    RETURN_TRUE_IF_TRUE(flash_claim())
 
     unlockFlash();
 
-    uint32_t nscrMsk = FLASH_CR_OPTCHANGEERRIE | FLASH_CR_INCERRIE | FLASH_CR_STRBERRIE | FLASH_CR_PGSERRIE | FLASH_CR_WRPERRIE | FLASH_CR_EOPIE;
-    FLASH->NSCR = (FLASH->NSCR & nscrMsk) | FLASH_CR_PG;
+    FLASH->NSCR = (FLASH->NSCR & FLASH_CR_INTERRUPTS) | FLASH_CR_PG;
 
 #ifdef WRITE_CRITICAL_SECTION
     // Enter critical section: Disable interrupts to avoid any interruption during the loop
@@ -437,7 +437,8 @@ static bool highCyclic_write16(uint16_t *address, const uint16_t *data, const ui
     // program 
     for (uint32_t i = 0; i < size; i += 2)
     {
-        *address++ = *data++;
+        highCyclic_forgetBlank(address);
+        FLASH_PROGRAM16(address++, *data++);
     }
     
 #ifdef WRITE_CRITICAL_SECTION
@@ -446,7 +447,7 @@ static bool highCyclic_write16(uint16_t *address, const uint16_t *data, const ui
 #endif
 
     // wait for bsy clear
-    while (FLASH->NSSR & FLASH_SR_BSY) {};
+    FLASH_WAIT_BSY();
 
     // clear ser
     FLASH->NSCR &= ~FLASH_CR_PG;
@@ -455,7 +456,7 @@ static bool highCyclic_write16(uint16_t *address, const uint16_t *data, const ui
     FLASH->NSCR = FLASH_CR_LOCK;
 
     // check for errors again
-    RETURN_TRUE_IF_TRUE((FLASH->NSSR & FLASH_ERROR_FLAGS) != 0)
+    RETURN_TRUE_IF_TRUE(flash_takeErrors())
 
     return false;
 }
@@ -468,8 +469,12 @@ static bool highCyclic_write16(uint16_t *address, const uint16_t *data, const ui
  */
 void __attribute__((used)) highCyclic_setArea(const uint32_t sectorCountBank1, const uint32_t sectorCountBank2)
 {
-    highCyclic_setArea_internal(1, sectorCountBank1);
-    highCyclic_setArea_internal(2, sectorCountBank2);
+    // both banks in one option byte programming cycle, nothing is programmed if both are set already
+    flashOb_transaction_t transaction;
+    flashOb_begin(&transaction);
+    (void) flashOb_stageHighCyclic(&transaction, 1, sectorCountBank1);
+    (void) flashOb_stageHighCyclic(&transaction, 2, sectorCountBank2);
+    (void) flashOb_commit(&transaction, NULL);
 }
 
 // ----------------------------------------------------------------------------
@@ -480,10 +485,12 @@ void __attribute__((used)) highCyclic_setArea(const uint32_t sectorCountBank1, c
  * 
  * @param bank Bank 1 or 2
  * @param page page number
+ * @return false    OK
+ * @return true     Error
  */
-void flash_erase(const uint8_t bank, const uint8_t page)
+bool flash_erase(const uint8_t bank, const uint8_t page)
 {
-    flashErase(bank, page);
+    return flashErase(bank, page);
 }
 /**
  * @brief external function to write half-words to a flash
@@ -512,3 +519,196 @@ void flash_write16(uint16_t* address, const uint16_t data, const uint32_t size)
         }
     }
 }
+
+/**
+ * @brief external function to write a buffer to high cyclic memory or main flash
+ * 
+ * @param address target address, half-word aligned in high cyclic memory, quad-word aligned in main flash
+ * @param data the data, aligned like the target address
+ * @param size amount of bytes to write, multiple of 2 in high cyclic memory, multiple of 16 in main flash
+ * @return false    OK
+ * @return true     Error
+ */
+bool flash_write(void* address, const void* data, const uint32_t size)
+{
+    uint32_t bank = highCyclic_getBank(address, size);
+    if ((bank == 1) || (bank == 2))
+    {
+        return highCyclic_write16((uint16_t*) address, (const uint16_t*) data, size);
+    }
+    return flashWrite128((uint32_t*) address, (const uint32_t*) data, size);
+}
+
+/**
+ * @brief tell a refused operation from a failed one, after flash_erase() or flash_write() returned an error
+ *
+ * An operation is refused if another one holds the flash unlocked or left an error flag pending,
+ * e.g. a compile-time region access interrupted by the caller. It fails before any cell is touched,
+ * so the same cells can be programmed again later. A DMA-fed write in progress is waited for
+ * instead of refusing.
+ *
+ * @return true     the last erase or program was refused, no cell was touched
+ * @return false    it succeeded, or it failed after it started: the cells in range may be programmed or torn
+ */
+bool flash_refused(void)
+{
+    return refused;
+}
+
+/**
+ * @brief classify one high cyclic half-word, reading it only if it is not known to be erased
+ * 
+ * @param address address of the half-word
+ * @return state of the half-word
+ */
+static flash_cell_t highCyclic_probe16(const uint16_t* address)
+{
+    uint32_t index = ((uint32_t) address - HIGH_CYCLIC_START_BANK1) / 2;
+    uint16_t data;
+
+    if (highCyclic_blankMap[index / 32] & (1UL << (index % 32)))
+    {
+        return FLASH_CELL_ERASED;
+    }
+    if (!flashEcc_read16(address, &data))
+    {
+        return FLASH_CELL_VALID;
+    }
+
+    // a virgin cell fails ECC with data and ECC bits all set
+    if (data == 0xFFFF)
+    {
+        highCyclic_blankMap[index / 32] |= (1UL << (index % 32));
+        return FLASH_CELL_ERASED;
+    }
+    return FLASH_CELL_CORRUPT;
+}
+
+/**
+ * @brief classify one main flash quad-word, erased main flash reads back as 0xFF without ECC fault
+ * 
+ * @param address address of the quad-word
+ * @return state of the quad-word
+ */
+static flash_cell_t flash_probe128(const uint32_t* address)
+{
+    uint32_t data[4];
+    if (flashEcc_read128(address, data))
+    {
+        return FLASH_CELL_CORRUPT;
+    }
+    if ((data[0] & data[1] & data[2] & data[3]) == 0xFFFFFFFFUL)
+    {
+        return FLASH_CELL_ERASED;
+    }
+    return FLASH_CELL_VALID;
+}
+
+/**
+ * @brief classify the cells of a range without an unhandled ECC fault
+ * 
+ * High cyclic memory is classified by half-words. Virgin cells fail ECC there, each one costs a
+ * guarded read and its NMI once, afterwards it is known to be erased until it is programmed.
+ * A whole sector is known to be erased after it was erased by the driver, so scanning the free
+ * part of a store is cheap. Main flash is classified by quad-words.
+ * 
+ * A torn half-word that happens to read back as 0xFFFF is classified as erased; programming it
+ * fails, so writers have to check the result of the program operation.
+ * 
+ * @param address first address, half-word aligned in high cyclic memory, quad-word aligned in main flash
+ * @param size amount of bytes, multiple of 2 in high cyclic memory, multiple of 16 in main flash
+ * @param states receives one flash_cell_t per cell, may be NULL
+ * @param result receives the summary of the range, may be NULL
+ * @return false    OK
+ * @return true     Error: range invalid or not aligned
+ */
+bool highCyclic_probe(const void* address, const uint32_t size, uint8_t* states, flash_probeResult_t* result)
+{
+    bool highCyclic = highCyclic_getBank(address, size) != 0;
+    uint32_t granule = highCyclic ? 2 : 16;
+    flash_probeResult_t summary = {0, 0, 0, (uint32_t) address};
+
+    RETURN_TRUE_IF_TRUE(size == 0)
+    RETURN_TRUE_IF_TRUE(!highCyclic && flash_getBank(address, size) == 0)
+    RETURN_TRUE_IF_TRUE((((uint32_t) address | size) & (granule - 1)) != 0)
+
+    for (uint32_t offset = 0; offset < size; offset += granule)
+    {
+        uint32_t cellAddress = (uint32_t) address + offset;
+        uint32_t index = (cellAddress - HIGH_CYCLIC_START_BANK1) / 2;
+
+        // skip 32 half-words known to be erased at once
+        if (highCyclic && (index % 32) == 0 && size - offset >= 64 && highCyclic_blankMap[index / 32] == 0xFFFFFFFFUL)
+        {
+            if (states != NULL)
+            {
+                for (uint32_t i = 0; i < 32; i++)
+                {
+                    states[offset / 2 + i] = FLASH_CELL_ERASED;
+                }
+            }
+            summary.erased += 32;
+            offset += 62;
+            continue;
+        }
+
+        flash_cell_t state = highCyclic ? highCyclic_probe16((const uint16_t*) cellAddress) :
+                                          flash_probe128((const uint32_t*) cellAddress);
+        if (states != NULL)
+        {
+            states[offset / granule] = state;
+        }
+        if (state == FLASH_CELL_ERASED)
+        {
+            summary.erased++;
+        }
+        else
+        {
+            summary.valid += (state == FLASH_CELL_VALID);
+            summary.corrupt += (state == FLASH_CELL_CORRUPT);
+            summary.end = cellAddress + granule;
+        }
+    }
+
+    if (result != NULL)
+    {
+        *result = summary;
+    }
+    return false;
+}
+
+/**
+ * @brief external function to check a sector range once before it is accessed without runtime checks
+ * @note used by the compile-time regions of flash_region.h
+ * 
+ * @param bank Bank 1 or 2
+ * @param highCyclic true if the range is accessed as high cyclic memory
+ * @param sectorFirst first sector of the range
+ * @param sectorLast last sector of the range
+ * @return false    OK
+ * @return true     Error: range invalid, HDP/WRP protected or not configured for the kind of access
+ */
+bool flash_checkRegion(const uint8_t bank, const bool highCyclic, const uint8_t sectorFirst, const uint8_t sectorLast)
+{
+    RETURN_TRUE_IF_TRUE(!(bank == 1 || bank == 2))
+    RETURN_TRUE_IF_TRUE(sectorFirst > sectorLast || sectorLast >= FLASH_PAGES_PER_BANK)
+#ifdef CHECK_HDP
+    RETURN_TRUE_IF_TRUE(checkHDP(sectorFirst, sectorLast, bank))
+#endif
+#ifdef CHECK_WRP
+    RETURN_TRUE_IF_TRUE(checkWRP(sectorFirst, sectorLast, bank))
+#endif
+
+    uint32_t firstHighCyclicSector = FLASH_PAGES_PER_BANK - highCyclic_getSectorCount(bank);
+    if (highCyclic)
+    {
+        // every sector of the range has to be high cyclic memory
+        RETURN_TRUE_IF_TRUE(sectorFirst < firstHighCyclicSector)
+    }
+    else
+    {
+        // sectors configured as high cyclic memory are not accessible as main flash
+        RETURN_TRUE_IF_TRUE(sectorLast >= firstHighCyclicSector)
+    }
+    return false;
+}
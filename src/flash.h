@@ -2,30 +2,63 @@
 #ifndef FLASH_H
 #define FLASH_H
 #include "stm32h563.h"
+#ifdef FLASH_EMULATION
+#include "flash_emu.h"
+#endif
 
-#define FLASH_PAGE_SIZE         FLASH_SECTOR_SIZE
-#define FLASH_PAGES_PER_BANK    128
+#include "flash_geometry.h"
+
+#define FLASH_PAGE_SIZE         FLASH_GEOM_SECTOR_SIZE
+#define FLASH_PAGES_PER_BANK    FLASH_GEOM_SECTORS_PER_BANK
 
 // static bank size, since original define is probably evaluated at runtime
-#define FLASH_BANK_SIZE_STATIC  (FLASH_PAGES_PER_BANK * FLASH_PAGE_SIZE)
-#define FLASH_START_BANK1       (0x08000000)
+#define FLASH_BANK_SIZE_STATIC  FLASH_GEOM_BANK_SIZE
+#define FLASH_START_BANK1       FLASH_GEOM_START_BANK1
 #define FLASH_END_BANK1         (FLASH_START_BANK1 + FLASH_BANK_SIZE_STATIC - 1)
-#define FLASH_START_BANK2       (0x08100000)
+#define FLASH_START_BANK2       FLASH_GEOM_START_BANK2
 #define FLASH_END_BANK2         (FLASH_START_BANK2 + FLASH_BANK_SIZE_STATIC - 1)
 
 #define FLASH_PAGE_OFFSET_BANK2 FLASH_PAGES_PER_BANK
 
 /*the offset between high cyclic sector numbers and corresponding normal flash numbers*/
-#define HIGH_CYCLIC_PAGE_OFFSET 120
+#define HIGH_CYCLIC_PAGE_OFFSET FLASH_GEOM_HC_FIRST_SECTOR
+
+#define HIGH_CYCLIC_START_BANK1 FLASH_GEOM_HC_START_BANK1
+#define HIGH_CYCLIC_START_BANK2 FLASH_GEOM_HC_START_BANK2
+#define HIGH_CYCLIC_SECTOR_SIZE FLASH_GEOM_HC_SECTOR_SIZE
+#define HIGH_CYCLIC_END_BANK1   FLASH_GEOM_HC_BANK_END(1)
+#define HIGH_CYCLIC_END_BANK2   FLASH_GEOM_HC_BANK_END(2)
+
+// the geometry has to match the device header
+_Static_assert(FLASH_GEOM_SECTOR_SIZE == FLASH_SECTOR_SIZE, "sector size differs from the device header");
+_Static_assert(2 * FLASH_GEOM_BANK_SIZE == FLASH_SIZE_DEFAULT, "flash size differs from the device header");
+_Static_assert(2 * FLASH_GEOM_HC_BANK_SIZE == FLASH_EDATA_SIZE, "high cyclic size differs from the device header");
+_Static_assert(FLASH_GEOM_HC_SECTORS_PER_BANK == 1 + (FLASH_EDATAR_EDATA_STRT_Msk >> FLASH_EDATAR_EDATA_STRT_Pos),
+               "high cyclic sector count differs from the EDATA_STRT field");
+
+// state of a high cyclic half-word or a main flash quad-word, as found by highCyclic_probe()
+typedef enum
+{
+    FLASH_CELL_ERASED = 0,      // erased, never programmed
+    FLASH_CELL_VALID,           // programmed, reads back with valid or corrected ECC
+    FLASH_CELL_CORRUPT,         // fails ECC: torn write, partial erase or worn out
+} flash_cell_t;
 
-#define HIGH_CYCLIC_START_BANK1 0x09000000UL
-#define HIGH_CYCLIC_START_BANK2 0x0900C000UL
-#define HIGH_CYCLIC_SECTOR_SIZE 0x00001800UL
-#define HIGH_CYCLIC_END_BANK1   (HIGH_CYCLIC_START_BANK1 + 8*HIGH_CYCLIC_SECTOR_SIZE - 1)
-#define HIGH_CYCLIC_END_BANK2   (HIGH_CYCLIC_START_BANK2 + 8*HIGH_CYCLIC_SECTOR_SIZE - 1)
+typedef struct
+{
+    uint32_t erased;            // amount of erased cells
+    uint32_t valid;             // amount of valid cells
+    uint32_t corrupt;           // amount of corrupt cells
+    uint32_t end;               // address behind the last cell that is not erased, the first address if all are erased
+} flash_probeResult_t;
 
-extern void flash_erase(const uint8_t bank, const uint8_t page);
+extern bool flash_erase(const uint8_t bank, const uint8_t page);
 extern void flash_write16(uint16_t* address, const uint16_t data, const uint32_t size);
+extern bool flash_write(void* address, const void* data, const uint32_t size);
+extern bool flash_refused(void);
 extern void highCyclic_setArea(const uint32_t sectorCountBank1, const uint32_t sectorCountBank2);
+extern uint32_t highCyclic_getSectorCount(const uint32_t bank);
+extern bool highCyclic_probe(const void* address, const uint32_t size, uint8_t* states, flash_probeResult_t* result);
+extern bool flash_checkRegion(const uint8_t bank, const bool highCyclic, const uint8_t sectorFirst, const uint8_t sectorLast);
 
 #endif // FLASH_H
\ No newline at end of file
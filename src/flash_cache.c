@@ -0,0 +1,41 @@
+#include "flash_cache.h"
+#include "flash_ll.h"
+
+/**
+ * @brief make main flash cacheable, keep the high cyclic area uncached and enable the ICACHE
+ */
+void flashCache_enable(void)
+{
+    ARM_MPU_Disable();
+
+    // write-through, read-allocate: flash is written by program operations, never by stores
+    ARM_MPU_SetMemAttr(FLASH_CACHE_MPU_ATTR_CACHEABLE,
+                       ARM_MPU_ATTR(ARM_MPU_ATTR_MEMORY_(1, 0, 1, 0), ARM_MPU_ATTR_MEMORY_(1, 0, 1, 0)));
+    ARM_MPU_SetMemAttr(FLASH_CACHE_MPU_ATTR_UNCACHED,
+                       ARM_MPU_ATTR(ARM_MPU_ATTR_NON_CACHEABLE, ARM_MPU_ATTR_NON_CACHEABLE));
+
+    ARM_MPU_SetRegion(FLASH_CACHE_MPU_REGION_MAIN,
+                      ARM_MPU_RBAR(FLASH_START_BANK1, ARM_MPU_SH_NON, 0, 1, 0),
+                      ARM_MPU_RLAR(FLASH_END_BANK2, FLASH_CACHE_MPU_ATTR_CACHEABLE));
+    ARM_MPU_SetRegion(FLASH_CACHE_MPU_REGION_HIGH_CYCLIC,
+                      ARM_MPU_RBAR(HIGH_CYCLIC_START_BANK1, ARM_MPU_SH_NON, 0, 1, 1),
+                      ARM_MPU_RLAR(HIGH_CYCLIC_END_BANK2, FLASH_CACHE_MPU_ATTR_UNCACHED));
+
+    // everything else keeps the default memory map
+    ARM_MPU_Enable(MPU_CTRL_PRIVDEFENA_Msk);
+
+    // the ICACHE starts with an invalidation, wait for it before enabling
+    while (ICACHE->SR & ICACHE_SR_BUSYF) {}
+    ICACHE->FCR = ICACHE_FCR_CBSYENDF;
+    ICACHE->CR |= ICACHE_CR_EN;
+}
+
+/**
+ * @brief disable the ICACHE, flash reads go to the flash interface again
+ */
+void flashCache_disable(void)
+{
+    ICACHE->CR &= ~ICACHE_CR_EN;
+    while (ICACHE->SR & ICACHE_SR_BUSYF) {}
+    ICACHE->FCR = ICACHE_FCR_CBSYENDF;
+}
@@ -0,0 +1,29 @@
+#ifndef FLASH_CACHE_H
+#define FLASH_CACHE_H
+/**
+ * @file flash_cache.h
+ * @brief instruction cache for reads of the internal flash
+ *
+ * On the STM32H5 the ICACHE serves all cacheable accesses to the internal flash through the code
+ * bus, data reads of tables included. DCACHE1 only sits in front of the external memory
+ * interfaces, so it has no part in internal flash coherency.
+ *
+ * Main flash is made cacheable by the MPU. The high cyclic area stays non-cacheable: a line fill
+ * reads 16 bytes at once, so reading a programmed half-word next to a virgin one would fault and
+ * probing would report the wrong cell.
+ *
+ * The ICACHE only invalidates as a whole. The driver invalidates it after every main flash erase
+ * or program, writes to the high cyclic area need no maintenance.
+ */
+#include "flash.h"
+
+// MPU regions and attribute indices used for the flash
+#define FLASH_CACHE_MPU_REGION_MAIN         0
+#define FLASH_CACHE_MPU_REGION_HIGH_CYCLIC  1
+#define FLASH_CACHE_MPU_ATTR_CACHEABLE      0
+#define FLASH_CACHE_MPU_ATTR_UNCACHED       1
+
+extern void flashCache_enable(void);
+extern void flashCache_disable(void);
+
+#endif // FLASH_CACHE_H
@@ -0,0 +1,410 @@
+#include "flash.h"
+#include "flash_crc.h"
+#include "flash_dma.h"
+#include "flash_ecc.h"
+
+#define RETURN_TRUE_IF_TRUE(cond) if(cond) {return true;}
+
+#define FLASH_CRC16_POLY            0x1021U
+#define FLASH_CRC32_POLY            0x04C11DB7UL
+#define FLASH_CRC32_POLY_REFLECTED  0xEDB88320UL
+
+// CR POLYSIZE and REV_IN values
+#define FLASH_CRC_POLYSIZE_32       0
+#define FLASH_CRC_POLYSIZE_16       1
+#define FLASH_CRC_REV_IN_BYTE       1
+#define FLASH_CRC_REV_IN_WORD       3
+
+#define FLASH_CRC_DMA_ERRORS        (DMA_CSR_DTEF | DMA_CSR_ULEF | DMA_CSR_USEF)
+#define FLASH_CRC_DMA_FLAGS         (DMA_CFCR_TCF | DMA_CFCR_HTF | DMA_CFCR_DTEF | DMA_CFCR_ULEF | \
+                                     DMA_CFCR_USEF | DMA_CFCR_SUSPF | DMA_CFCR_TOF)
+
+// bytes read back per step of a verification, a multiple of a quad-word kept small for the stack
+#define FLASH_CRC_VERIFY_CHUNK      64
+
+/**
+ * @brief CRC-16/CCITT-FALSE in software, continued from crc
+ *
+ * @param crc CRC of the preceding data, FLASH_CRC16_INIT to start
+ * @param data the data
+ * @param size amount of bytes
+ * @return the CRC
+ */
+uint16_t flashCrc_crc16Software(uint16_t crc, const void* data, const uint32_t size)
+{
+    const uint8_t* bytes = (const uint8_t*) data;
+    for (uint32_t i = 0; i < size; i++)
+    {
+        crc ^= (uint16_t) (bytes[i] << 8);
+        for (uint32_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t) ((crc << 1) ^ FLASH_CRC16_POLY) : (uint16_t) (crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief CRC-32/ISO-HDLC in software, continued from crc
+ *
+ * @param crc CRC of the preceding data, FLASH_CRC32_INIT to start
+ * @param data the data
+ * @param size amount of bytes
+ * @return the CRC
+ */
+uint32_t flashCrc_crc32Software(uint32_t crc, const void* data, const uint32_t size)
+{
+    const uint8_t* bytes = (const uint8_t*) data;
+    crc = ~crc;
+    for (uint32_t i = 0; i < size; i++)
+    {
+        crc ^= bytes[i];
+        for (uint32_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 1) ? ((crc >> 1) ^ FLASH_CRC32_POLY_REFLECTED) : (crc >> 1);
+        }
+    }
+    return ~crc;
+}
+
+#ifndef FLASH_EMULATION
+static volatile bool unitBusy;
+
+/**
+ * @brief claim the CRC unit
+ *
+ * @return true if claimed, false if it is in use
+ */
+static bool flashCrc_claim(void)
+{
+    uint32_t primaskBit = __get_PRIMASK();
+    __disable_irq();
+    bool claimed = !unitBusy;
+    unitBusy = true;
+    __set_PRIMASK(primaskBit);
+
+    if (claimed)
+    {
+        RCC->AHB1ENR |= RCC_AHB1ENR_CRCEN;
+        (void) RCC->AHB1ENR;
+    }
+    return claimed;
+}
+
+/**
+ * @brief feed single bytes to the CRC unit
+ */
+static void flashCrc_feedBytes(const uint8_t* bytes, uint32_t size)
+{
+    for (; size != 0; size--)
+    {
+        *(volatile uint8_t*) &CRC->DR = *bytes++;
+    }
+}
+
+/**
+ * @brief switch the input reversal of a reflected CRC between single bytes and whole words
+ */
+static void flashCrc_reverseIn(const uint32_t mode)
+{
+    CRC->CR = (CRC->CR & ~(CRC_CR_REV_IN_Msk | CRC_CR_RESET)) | (mode << CRC_CR_REV_IN_Pos);
+}
+
+/**
+ * @brief feed bytes to the CRC unit in their memory order, whole words at once
+ *
+ * The unit shifts a word in from its most significant bit. For the unreflected CRC-16 words are
+ * byte swapped first. The reflected CRC-32 reverses the bits of every word instead, which also
+ * puts its first byte in front, so its words go in as they are; that is what a DMA feed needs.
+ *
+ * @param bytes the data
+ * @param size amount of bytes
+ * @param reflected the unit is set up for CRC-32, reversing the input by bytes
+ */
+static void flashCrc_feed(const uint8_t* bytes, uint32_t size, const bool reflected)
+{
+    uint32_t head = (4U - ((uint32_t) bytes & 3)) & 3;
+    head = (head < size) ? head : size;
+    flashCrc_feedBytes(bytes, head);
+    bytes += head;
+    size -= head;
+
+    if (reflected)
+    {
+        flashCrc_reverseIn(FLASH_CRC_REV_IN_WORD);
+    }
+    for (; size >= 4; size -= 4, bytes += 4)
+    {
+        CRC->DR = reflected ? *(const uint32_t*) bytes : __REV(*(const uint32_t*) bytes);
+    }
+    if (reflected)
+    {
+        flashCrc_reverseIn(FLASH_CRC_REV_IN_BYTE);
+    }
+    flashCrc_feedBytes(bytes, size);
+}
+
+/**
+ * @brief set the CRC unit up for CRC-32/ISO-HDLC, continued from crc
+ */
+static void flashCrc_setup32(const uint32_t crc)
+{
+    // the unit computes unreflected: input bytes and the result are bit reversed, the
+    // initial value is the reflected register bit reversed
+    CRC->POL = FLASH_CRC32_POLY;
+    CRC->INIT = __RBIT(~crc);
+    CRC->CR = (FLASH_CRC_POLYSIZE_32 << CRC_CR_POLYSIZE_Pos) | (FLASH_CRC_REV_IN_BYTE << CRC_CR_REV_IN_Pos)
+            | CRC_CR_REV_OUT | CRC_CR_RESET;
+}
+#endif
+
+// a DMA-fed CRC-32, the words are fed by GPDMA1 channel 2, leading and trailing bytes by the CPU
+static struct
+{
+    volatile bool busy;                 // started and not finished yet
+    volatile bool error;                // the transfer failed
+    bool unit;                          // fed to the CRC unit, otherwise computed at the start
+    const uint8_t* source;              // next block
+    uint32_t remaining;                 // word bytes after the current block
+    const uint8_t* tail;                // trailing bytes, fed by the CPU
+    uint32_t tailSize;
+    uint32_t crc;                       // the result if computed at the start
+} dmaFeed;
+
+/**
+ * @brief CRC-16/CCITT-FALSE, continued from crc
+ *
+ * @param crc CRC of the preceding data, FLASH_CRC16_INIT to start
+ * @param data the data
+ * @param size amount of bytes
+ * @return the CRC
+ */
+uint16_t flashCrc_crc16(uint16_t crc, const void* data, const uint32_t size)
+{
+#ifndef FLASH_EMULATION
+    if (flashCrc_claim())
+    {
+        CRC->POL = FLASH_CRC16_POLY;
+        CRC->INIT = crc;
+        CRC->CR = (FLASH_CRC_POLYSIZE_16 << CRC_CR_POLYSIZE_Pos) | CRC_CR_RESET;
+        flashCrc_feed((const uint8_t*) data, size, false);
+        crc = (uint16_t) CRC->DR;
+        unitBusy = false;
+        return crc;
+    }
+#endif
+    return flashCrc_crc16Software(crc, data, size);
+}
+
+/**
+ * @brief CRC-32/ISO-HDLC, continued from crc
+ *
+ * @param crc CRC of the preceding data, FLASH_CRC32_INIT to start
+ * @param data the data
+ * @param size amount of bytes
+ * @return the CRC
+ */
+uint32_t flashCrc_crc32(uint32_t crc, const void* data, const uint32_t size)
+{
+#ifndef FLASH_EMULATION
+    if (flashCrc_claim())
+    {
+        flashCrc_setup32(crc);
+        flashCrc_feed((const uint8_t*) data, size, true);
+        crc = ~CRC->DR;
+        unitBusy = false;
+        return crc;
+    }
+#endif
+    return flashCrc_crc32Software(crc, data, size);
+}
+
+#ifndef FLASH_EMULATION
+/**
+ * @brief program GPDMA1 channel 2 for the next block of words and start it
+ */
+static void flashCrc_startBlock(void)
+{
+    uint32_t block = dmaFeed.remaining < FLASH_DMA_BLOCK_MAX ? dmaFeed.remaining : FLASH_DMA_BLOCK_MAX;
+
+    // words from memory on port 1, incrementing, in bursts of 8; all into the data register on port 0
+    GPDMA1_Channel2->CFCR = FLASH_CRC_DMA_FLAGS;
+    GPDMA1_Channel2->CTR1 = (2U << DMA_CTR1_SDW_LOG2_Pos) | DMA_CTR1_SINC | (7U << DMA_CTR1_SBL_1_Pos) | DMA_CTR1_SAP
+                          | (2U << DMA_CTR1_DDW_LOG2_Pos);
+    GPDMA1_Channel2->CTR2 = DMA_CTR2_SWREQ;
+    GPDMA1_Channel2->CBR1 = block;
+    GPDMA1_Channel2->CSAR = (uint32_t) dmaFeed.source;
+    GPDMA1_Channel2->CDAR = (uint32_t) &CRC->DR;
+    GPDMA1_Channel2->CLLR = 0;
+    GPDMA1_Channel2->CCR = DMA_CCR_TCIE | DMA_CCR_DTEIE | DMA_CCR_ULEIE | DMA_CCR_USEIE | DMA_CCR_EN;
+
+    dmaFeed.source += block;
+    dmaFeed.remaining -= block;
+}
+
+/**
+ * @brief GPDMA1 channel 2 interrupt, the channel of flashCrc_crc32Dma()
+ */
+void GPDMA1_Channel2_IRQHandler(void)
+{
+    uint32_t status = GPDMA1_Channel2->CSR;
+    GPDMA1_Channel2->CFCR = FLASH_CRC_DMA_FLAGS;
+
+    if (status & FLASH_CRC_DMA_ERRORS)
+    {
+        // the channel stops on an error, reset it for the next transfer
+        GPDMA1_Channel2->CCR = DMA_CCR_RESET;
+        dmaFeed.error = true;
+        dmaFeed.busy = false;
+    }
+    else if (status & DMA_CSR_TCF)
+    {
+        if (dmaFeed.remaining != 0)
+        {
+            flashCrc_startBlock();
+        }
+        else
+        {
+            dmaFeed.busy = false;
+        }
+    }
+}
+#endif
+
+/**
+ * @brief start a CRC-32/ISO-HDLC, continued from crc, fed to the CRC unit by GPDMA1 channel 2
+ *
+ * The CPU is free until flashCrc_crc32Wait(). Meanwhile the unit is claimed, other CRC calls
+ * compute in software. Sizes below FLASH_CRC_DMA_MIN_SIZE, a unit in use and host builds compute
+ * the CRC right away instead.
+ *
+ * @param crc CRC of the preceding data, FLASH_CRC32_INIT to start
+ * @param data the data in SRAM or main flash, unchanged until flashCrc_crc32Wait() returned
+ * @param size amount of bytes
+ * @return false    OK, the CRC was started
+ * @return true     Error: a DMA-fed CRC is still in progress or the data is in the high cyclic area
+ */
+bool flashCrc_crc32Dma(const uint32_t crc, const void* data, const uint32_t size)
+{
+    uint32_t first = (uint32_t) data;
+    RETURN_TRUE_IF_TRUE(dmaFeed.busy)
+    RETURN_TRUE_IF_TRUE(size != 0 && first + size - 1 >= HIGH_CYCLIC_START_BANK1 && first <= HIGH_CYCLIC_END_BANK2)
+
+    dmaFeed.busy = true;
+    dmaFeed.error = false;
+    dmaFeed.unit = false;
+
+#ifndef FLASH_EMULATION
+    if (size >= FLASH_CRC_DMA_MIN_SIZE && flashCrc_claim())
+    {
+        // bytes in front of the first whole word by the CPU
+        uint32_t head = (4U - (first & 3)) & 3;
+        uint32_t words = (size - head) & ~3UL;
+        flashCrc_setup32(crc);
+        flashCrc_feedBytes((const uint8_t*) data, head);
+        flashCrc_reverseIn(FLASH_CRC_REV_IN_WORD);
+
+        dmaFeed.unit = true;
+        dmaFeed.source = (const uint8_t*) data + head;
+        dmaFeed.remaining = words;
+        dmaFeed.tail = dmaFeed.source + words;
+        dmaFeed.tailSize = size - head - words;
+
+        RCC->AHB1ENR |= RCC_AHB1ENR_GPDMA1EN;
+        (void) RCC->AHB1ENR;
+        NVIC_EnableIRQ(GPDMA1_Channel2_IRQn);
+        flashCrc_startBlock();
+        return false;
+    }
+#endif
+
+    dmaFeed.crc = flashCrc_crc32(crc, data, size);
+    dmaFeed.busy = false;
+    return false;
+}
+
+/**
+ * @brief wait for the CRC started by flashCrc_crc32Dma()
+ *
+ * @param crc receives the CRC
+ * @return false    OK
+ * @return true     Error: the transfer failed, e.g. on an uncorrectable ECC error of the data
+ */
+bool flashCrc_crc32Wait(uint32_t* crc)
+{
+    while (dmaFeed.busy) {}
+
+#ifndef FLASH_EMULATION
+    if (dmaFeed.unit)
+    {
+        dmaFeed.unit = false;
+        flashCrc_reverseIn(FLASH_CRC_REV_IN_BYTE);
+        flashCrc_feedBytes(dmaFeed.tail, dmaFeed.tailSize);
+        dmaFeed.crc = ~CRC->DR;
+        unitBusy = false;
+    }
+#endif
+    *crc = dmaFeed.crc;
+    return dmaFeed.error;
+}
+
+/**
+ * @brief check a programmed range against the CRC-32 of the data written there
+ *
+ * High cyclic half-words and main flash quad-words are read through guarded reads, a cell that
+ * fails ECC fails the verification.
+ *
+ * @param address first address, half-word aligned in high cyclic memory, quad-word aligned in main flash
+ * @param size amount of bytes, multiple of 2 in high cyclic memory, multiple of 16 in main flash
+ * @param crc CRC-32 of the data
+ * @return false    OK, the range holds the data
+ * @return true     Error: the range differs, fails ECC or is not aligned
+ */
+bool flashCrc_verify(const void* address, const uint32_t size, const uint32_t crc)
+{
+    uint32_t first = (uint32_t) address;
+    bool highCyclic = first >= HIGH_CYCLIC_START_BANK1 && first <= HIGH_CYCLIC_END_BANK2;
+    RETURN_TRUE_IF_TRUE((first | size) & (highCyclic ? 1 : 15))
+
+    uint32_t chunk[FLASH_CRC_VERIFY_CHUNK / 4];
+    uint32_t actual = FLASH_CRC32_INIT;
+    uint32_t offset = 0;
+    while (offset < size)
+    {
+        uint32_t step = (size - offset < FLASH_CRC_VERIFY_CHUNK) ? size - offset : FLASH_CRC_VERIFY_CHUNK;
+
+        for (uint32_t i = 0; i < step; i += highCyclic ? 2 : 16)
+        {
+            if (highCyclic)
+            {
+                RETURN_TRUE_IF_TRUE(flashEcc_read16((const uint16_t*) (first + offset + i), (uint16_t*) chunk + i / 2))
+            }
+            else
+            {
+                RETURN_TRUE_IF_TRUE(flashEcc_read128((const uint32_t*) (first + offset + i), chunk + i / 4))
+            }
+        }
+
+        actual = flashCrc_crc32(actual, chunk, step);
+        offset += step;
+    }
+
+    RETURN_TRUE_IF_TRUE(actual != crc)
+    return false;
+}
+
+/**
+ * @brief write to high cyclic memory or main flash like flash_write() and verify the result
+ *
+ * @param address target address, half-word aligned in high cyclic memory, quad-word aligned in main flash
+ * @param data the data, aligned like the target address
+ * @param size amount of bytes to write, multiple of 2 in high cyclic memory, multiple of 16 in main flash
+ * @return false    OK, the data was written and reads back unchanged
+ * @return true     Error: the write failed or the range does not hold the data
+ */
+bool flashCrc_writeVerified(void* address, const void* data, const uint32_t size)
+{
+    uint32_t crc = flashCrc_crc32(FLASH_CRC32_INIT, data, size);
+    RETURN_TRUE_IF_TRUE(flash_write(address, data, size))
+    return flashCrc_verify(address, size, crc);
+}
@@ -0,0 +1,45 @@
+#ifndef FLASH_CRC_H
+#define FLASH_CRC_H
+/**
+ * @file flash_crc.h
+ * @brief checksums on the CRC unit and verification of programmed flash
+ *
+ * CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF, not reflected) checks the records
+ * of the high cyclic store. CRC-32/ISO-HDLC (polynomial 0x04C11DB7, reflected, as zlib's crc32())
+ * checks larger data and programmed ranges.
+ *
+ * Both run on the CRC unit, which takes a word per cycle. The unit is claimed for the duration
+ * of a call; a call finding it in use, e.g. from an interrupt, computes in software instead. The
+ * host build always uses the software implementation. Results are bit-identical either way.
+ *
+ * flashCrc_crc32Dma() lets GPDMA1 channel 2 feed the words of a larger buffer to the unit while
+ * the CPU does something else, flashCrc_crc32Wait() then takes the result. Only CRC-32 is fed by
+ * DMA: the unit reverses its input bits by word, which puts the first byte of a word in front, so
+ * the words go in as they are stored. CRC-16 is not reflected and would need every word byte
+ * swapped, which the channel cannot do.
+ *
+ * flashCrc_writeVerified() checksums the data, programs it with flash_write() and reads the
+ * range back through guarded reads, so a failed program is reported instead of faulting later.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FLASH_CRC16_INIT        0xFFFF
+#define FLASH_CRC32_INIT        0
+
+// DMA-fed CRCs below this size are computed by the CPU, setting up the channel would take longer
+#ifndef FLASH_CRC_DMA_MIN_SIZE
+#define FLASH_CRC_DMA_MIN_SIZE  256
+#endif
+
+extern uint16_t flashCrc_crc16(uint16_t crc, const void* data, const uint32_t size);
+extern uint32_t flashCrc_crc32(uint32_t crc, const void* data, const uint32_t size);
+extern uint16_t flashCrc_crc16Software(uint16_t crc, const void* data, const uint32_t size);
+extern uint32_t flashCrc_crc32Software(uint32_t crc, const void* data, const uint32_t size);
+extern bool flashCrc_crc32Dma(const uint32_t crc, const void* data, const uint32_t size);
+extern bool flashCrc_crc32Wait(uint32_t* crc);
+
+extern bool flashCrc_verify(const void* address, const uint32_t size, const uint32_t crc);
+extern bool flashCrc_writeVerified(void* address, const void* data, const uint32_t size);
+
+#endif // FLASH_CRC_H
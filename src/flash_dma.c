@@ -0,0 +1,296 @@
+#include <string.h>
+#include "flash_dma.h"
+#include "flash_ecc.h"
+#include "flash_ll.h"
+
+#define RETURN_TRUE_IF_TRUE(cond) if(cond) {return true;}
+
+#define FLASH_DMA_ERRORS        (DMA_CSR_DTEF | DMA_CSR_ULEF | DMA_CSR_USEF)
+#define FLASH_DMA_FLAGS         (DMA_CFCR_TCF | DMA_CFCR_HTF | DMA_CFCR_DTEF | DMA_CFCR_ULEF | \
+                                 DMA_CFCR_USEF | DMA_CFCR_SUSPF | DMA_CFCR_TOF)
+
+// a block has to be a multiple of the widest beat and of a quad-word
+_Static_assert((FLASH_DMA_BLOCK_MAX & 15) == 0, "block size not quad-word aligned");
+
+// a read or a write, split into blocks of at most FLASH_DMA_BLOCK_MAX bytes
+typedef struct
+{
+    volatile bool busy;                 // started and not finished yet
+    volatile bool error;                // the last transfer failed
+    bool program;                       // writes to main flash, framed by quad-word programming mode
+    uint8_t* destination;               // next block
+    const uint8_t* source;
+    uint32_t remaining;                 // bytes after the current block
+    uint32_t widthLog2;                 // beat width
+    flashDma_callback_t callback;
+    void* context;
+} flashDma_transfer_t;
+
+static flashDma_transfer_t readTransfer;
+static flashDma_transfer_t writeTransfer = {.program = true};
+
+static bool flashDma_isHighCyclic(const uint32_t address, const uint32_t size)
+{
+    return (address >= HIGH_CYCLIC_START_BANK1 && address + size - 1 <= HIGH_CYCLIC_END_BANK2);
+}
+
+static bool flashDma_isMain(const uint32_t address, const uint32_t size)
+{
+    return (address >= FLASH_START_BANK1 && address + size - 1 <= FLASH_END_BANK2);
+}
+
+static void flashDma_finish(flashDma_transfer_t* transfer, const bool error)
+{
+    transfer->error = error;
+    transfer->busy = false;
+    if (transfer->callback != NULL)
+    {
+        transfer->callback(error, transfer->context);
+    }
+}
+
+/**
+ * @brief copy by the CPU, high cyclic cells through guarded reads
+ *
+ * @return false    OK
+ * @return true     Error: a half-word failed ECC
+ */
+static bool flashDma_copy(uint8_t* buffer, const uint8_t* address, const uint32_t size)
+{
+    if (!flashDma_isHighCyclic((uint32_t) address, size))
+    {
+        memcpy(buffer, address, size);
+        return false;
+    }
+
+    bool error = false;
+    for (uint32_t offset = 0; offset < size; offset += 2)
+    {
+        uint16_t data;
+        error |= flashEcc_read16((const uint16_t*) (address + offset), &data);
+        memcpy(buffer + offset, &data, 2);
+    }
+    return error;
+}
+
+#ifndef FLASH_EMULATION
+/**
+ * @brief program a channel for the next block of a transfer and start it
+ */
+static void flashDma_startBlock(DMA_Channel_TypeDef* channel, flashDma_transfer_t* transfer)
+{
+    uint32_t block = transfer->remaining < FLASH_DMA_BLOCK_MAX ? transfer->remaining : FLASH_DMA_BLOCK_MAX;
+
+    // memory to memory on port 1, incrementing both sides. Word beats go in bursts: 8 words for
+    // reads, one quad-word for writes, which fills the write buffer of the flash at once
+    uint32_t burst = (transfer->widthLog2 != 2) ? 0 : (transfer->program ? 3 : 7);
+    channel->CFCR = FLASH_DMA_FLAGS;
+    channel->CTR1 = (transfer->widthLog2 << DMA_CTR1_SDW_LOG2_Pos) | DMA_CTR1_SINC | (burst << DMA_CTR1_SBL_1_Pos)
+                  | DMA_CTR1_SAP
+                  | (transfer->widthLog2 << DMA_CTR1_DDW_LOG2_Pos) | DMA_CTR1_DINC | (burst << DMA_CTR1_DBL_1_Pos)
+                  | DMA_CTR1_DAP;
+    channel->CTR2 = DMA_CTR2_SWREQ;
+    channel->CBR1 = block;
+    channel->CSAR = (uint32_t) transfer->source;
+    channel->CDAR = (uint32_t) transfer->destination;
+    channel->CLLR = 0;
+    channel->CCR = DMA_CCR_TCIE | DMA_CCR_DTEIE | DMA_CCR_ULEIE | DMA_CCR_USEIE | DMA_CCR_EN;
+
+    transfer->source += block;
+    transfer->destination += block;
+    transfer->remaining -= block;
+}
+
+/**
+ * @brief start a transfer on its channel
+ */
+static void flashDma_start(DMA_Channel_TypeDef* channel, const IRQn_Type irq, flashDma_transfer_t* transfer)
+{
+    RCC->AHB1ENR |= RCC_AHB1ENR_GPDMA1EN;
+    (void) RCC->AHB1ENR;
+    NVIC_EnableIRQ(irq);
+    flashDma_startBlock(channel, transfer);
+}
+
+/**
+ * @brief common part of the channel interrupts, starts the next block or finishes the transfer
+ */
+static void flashDma_irq(DMA_Channel_TypeDef* channel, flashDma_transfer_t* transfer)
+{
+    uint32_t status = channel->CSR;
+    channel->CFCR = FLASH_DMA_FLAGS;
+
+    if (status & FLASH_DMA_ERRORS)
+    {
+        // the channel stops on an error, reset it for the next transfer
+        channel->CCR = DMA_CCR_RESET;
+        if (transfer->program)
+        {
+            (void) flash_program128End();
+        }
+        flashDma_finish(transfer, true);
+    }
+    else if (status & DMA_CSR_TCF)
+    {
+        if (transfer->remaining != 0)
+        {
+            flashDma_startBlock(channel, transfer);
+        }
+        else
+        {
+            // the last quad-word may still be programming, that takes one program time at most
+            flashDma_finish(transfer, transfer->program ? flash_program128End() : false);
+        }
+    }
+}
+
+/**
+ * @brief GPDMA1 channel 0 interrupt, the channel of flashDma_read()
+ */
+void GPDMA1_Channel0_IRQHandler(void)
+{
+    flashDma_irq(GPDMA1_Channel0, &readTransfer);
+}
+
+/**
+ * @brief GPDMA1 channel 1 interrupt, the channel of flashDma_write()
+ */
+void GPDMA1_Channel1_IRQHandler(void)
+{
+    flashDma_irq(GPDMA1_Channel1, &writeTransfer);
+}
+#endif
+
+/**
+ * @brief read a flash region into SRAM, by GPDMA1 channel 0 or for small sizes by the CPU
+ *
+ * @param buffer destination in SRAM
+ * @param address first address in main flash or in the high cyclic area, half-word aligned for the latter
+ * @param size amount of bytes, even for the high cyclic area
+ * @param callback called when the read finished, may be NULL
+ * @param context passed to the callback
+ * @return false    OK, the read was started or, for small sizes, is done
+ * @return true     Error: a read is still in progress or the region is invalid, the callback is not called
+ */
+bool flashDma_read(void* buffer, const void* address, const uint32_t size,
+                   flashDma_callback_t callback, void* context)
+{
+    RETURN_TRUE_IF_TRUE(readTransfer.busy)
+    RETURN_TRUE_IF_TRUE(size == 0)
+
+    uint32_t first = (uint32_t) address;
+    bool highCyclic = flashDma_isHighCyclic(first, size);
+    RETURN_TRUE_IF_TRUE(!highCyclic && !flashDma_isMain(first, size))
+    RETURN_TRUE_IF_TRUE(highCyclic && ((first | size) & 1))
+
+    readTransfer.busy = true;
+    readTransfer.callback = callback;
+    readTransfer.context = context;
+
+#ifndef FLASH_EMULATION
+    // the widest beat all of source, destination and size are aligned to
+    uint32_t alignment = first | (uint32_t) buffer | size;
+    readTransfer.widthLog2 = (alignment & 3) == 0 ? 2 : ((alignment & 1) == 0 ? 1 : 0);
+
+    // byte reads of the high cyclic area are not possible, those are copied by the CPU
+    if (size >= FLASH_DMA_MIN_SIZE && !(highCyclic && readTransfer.widthLog2 == 0))
+    {
+        readTransfer.source = (const uint8_t*) address;
+        readTransfer.destination = (uint8_t*) buffer;
+        readTransfer.remaining = size;
+        flashDma_start(GPDMA1_Channel0, GPDMA1_Channel0_IRQn, &readTransfer);
+        return false;
+    }
+#endif
+
+    flashDma_finish(&readTransfer, flashDma_copy((uint8_t*) buffer, (const uint8_t*) address, size));
+    return false;
+}
+
+/**
+ * @brief a read is in progress
+ */
+bool flashDma_busy(void)
+{
+    return readTransfer.busy;
+}
+
+/**
+ * @brief wait for the read in progress
+ *
+ * @return false    OK, the last read got all data
+ * @return true     Error: the last read failed
+ */
+bool flashDma_wait(void)
+{
+    while (readTransfer.busy) {}
+    return readTransfer.error;
+}
+
+/**
+ * @brief program quad-words into main flash, fed from SRAM by GPDMA1 channel 1
+ *
+ * The flash stays unlocked in programming mode until the write has finished, other erase and
+ * program operations of the driver wait for it meanwhile. The data must stay unchanged until then.
+ *
+ * @param address target address in main flash, quad-word aligned
+ * @param data the data staged in SRAM, word aligned
+ * @param size amount of bytes, multiple of 16
+ * @param callback called when the write finished, may be NULL
+ * @param context passed to the callback
+ * @return false    OK, the write was started
+ * @return true     Error: a write is still in progress, the range is invalid or protected, the callback is not called
+ */
+bool flashDma_write(uint32_t* address, const uint32_t* data, const uint32_t size,
+                    flashDma_callback_t callback, void* context)
+{
+    RETURN_TRUE_IF_TRUE(writeTransfer.busy)
+    RETURN_TRUE_IF_TRUE(size == 0)
+    RETURN_TRUE_IF_TRUE(((uint32_t) data & 3) != 0)
+    RETURN_TRUE_IF_TRUE(flashDma_isMain((uint32_t) data, 1) || flashDma_isHighCyclic((uint32_t) data, 1))
+    RETURN_TRUE_IF_TRUE(flash_program128Begin(address, size))
+
+    writeTransfer.busy = true;
+    writeTransfer.callback = callback;
+    writeTransfer.context = context;
+
+#ifndef FLASH_EMULATION
+    writeTransfer.source = (const uint8_t*) data;
+    writeTransfer.destination = (uint8_t*) address;
+    writeTransfer.remaining = size;
+    writeTransfer.widthLog2 = 2;
+    flashDma_start(GPDMA1_Channel1, GPDMA1_Channel1_IRQn, &writeTransfer);
+#else
+    // no GPDMA on the host, the CPU feeds the write buffer and the write is done on return
+    for (uint32_t i = 0; i < size / 4; i++)
+    {
+        FLASH_PROGRAM32(address + i, data[i]);
+        if ((i & 3) == 3)
+        {
+            FLASH_WAIT_BSY();
+        }
+    }
+    flashDma_finish(&writeTransfer, flash_program128End());
+#endif
+    return false;
+}
+
+/**
+ * @brief a write is in progress
+ */
+bool flashDma_writeBusy(void)
+{
+    return writeTransfer.busy;
+}
+
+/**
+ * @brief wait for the write in progress
+ *
+ * @return false    OK, all quad-words were programmed
+ * @return true     Error: the last write failed
+ */
+bool flashDma_writeWait(void)
+{
+    while (writeTransfer.busy) {}
+    return writeTransfer.error;
+}
@@ -0,0 +1,52 @@
+#ifndef FLASH_DMA_H
+#define FLASH_DMA_H
+/**
+ * @file flash_dma.h
+ * @brief asynchronous bulk reads of main flash and the high cyclic area, DMA-fed main flash programming
+ *
+ * flashDma_read() streams a flash region into a buffer through GPDMA1 channel 0 and returns at
+ * once. The callback runs from the channel interrupt when the last byte has arrived or the
+ * transfer failed. Reads below FLASH_DMA_MIN_SIZE are copied by the CPU instead, the callback
+ * then runs before flashDma_read() returns.
+ *
+ * The DMA reads the flash directly, not through the ICACHE, so it always sees the current contents.
+ * A double ECC fault on a DMA read raises the NMI like any other read, which counts it, and ends
+ * the transfer with a data transfer error. High cyclic regions are read in half-words or words
+ * and must be half-word aligned.
+ *
+ * flashDma_write() programs main flash from data staged in SRAM through GPDMA1 channel 1. The
+ * channel writes one quad-word per burst into the write buffer of the flash; programming starts
+ * when the buffer is full, and the flash holds the bus on the next burst until the write buffer
+ * is free again. So quad-words are programmed back to back without the CPU. The channel interrupt
+ * waits for the last one, locks the flash and calls back.
+ *
+ * The host build has no GPDMA. Every read and write is done by the CPU there, and the callback
+ * runs before the call returns.
+ */
+#include "flash.h"
+
+// reads below this size are copied by the CPU, setting up the channel would take longer
+#ifndef FLASH_DMA_MIN_SIZE
+#define FLASH_DMA_MIN_SIZE      256
+#endif
+
+// bytes per block of the channel, longer transfers are split into several blocks
+#define FLASH_DMA_BLOCK_MAX     0xFFF0
+
+/**
+ * @brief called when a read or a write has finished
+ * @param error false if all data arrived, true on a transfer error, an uncorrectable ECC error or a program error
+ * @param context the context given to flashDma_read() or flashDma_write()
+ */
+typedef void (*flashDma_callback_t)(const bool error, void* context);
+
+extern bool flashDma_read(void* buffer, const void* address, const uint32_t size,
+                          flashDma_callback_t callback, void* context);
+extern bool flashDma_busy(void);
+extern bool flashDma_wait(void);
+extern bool flashDma_write(uint32_t* address, const uint32_t* data, const uint32_t size,
+                           flashDma_callback_t callback, void* context);
+extern bool flashDma_writeBusy(void);
+extern bool flashDma_writeWait(void);
+
+#endif // FLASH_DMA_H
@@ -0,0 +1,248 @@
+#include "flash_ecc.h"
+#include "flash_ll.h"
+
+#define RETURN_TRUE_IF_TRUE(cond) if(cond) {return true;}
+
+// a guarded read is in progress, the NMI reports its fault instead of counting it
+static volatile bool guardActive;
+static volatile bool guardFault;
+static volatile uint16_t guardData;
+
+static volatile uint32_t faultCount;
+static volatile flashEcc_fault_t lastFault;
+
+// corrected errors per sector of both banks, high cyclic sectors count for their flash sector
+#define SECTOR_INDEX(bank, sector)  (((bank) - 1) * FLASH_PAGES_PER_BANK + (sector))
+static volatile uint16_t corrections[2 * FLASH_PAGES_PER_BANK];
+static volatile uint32_t refreshPending[2 * FLASH_PAGES_PER_BANK / 32];
+static uint16_t refreshThreshold;
+
+/**
+ * @brief NMI handler, overrides nmi_h of the startup code
+ *
+ * A double ECC fault is cleared and returns to the faulting read, whose data is undefined.
+ * Any other NMI source stops here like before, preserving the state for the debugger.
+ */
+void NMI_Handler(void)
+{
+    uint32_t eccInfo = FLASH->ECCDETR;
+    if ((eccInfo & FLASH_ECCR_ECCD) == 0)
+    {
+        for (;;) {}
+    }
+
+    if (guardActive)
+    {
+        guardFault = true;
+        guardData = FLASH->ECCDR & FLASH_ECCDR_FAIL_DATA;
+    }
+    else
+    {
+        faultCount++;
+        lastFault.address = flashEcc_faultAddress(eccInfo);
+        lastFault.eccInfo = eccInfo;
+        lastFault.data = FLASH->ECCDR & FLASH_ECCDR_FAIL_DATA;
+    }
+
+    FLASH_ECC_CLEAR(FLASH->ECCDETR, FLASH_ECCR_ECCD);
+    __DSB();
+}
+
+/**
+ * @brief flash interrupt, counts corrected ECC errors per sector
+ */
+void FLASH_IRQHandler(void)
+{
+    uint32_t eccInfo = FLASH->ECCCORR;
+    if ((eccInfo & FLASH_ECCR_ECCC) == 0)
+    {
+        return;
+    }
+
+    uint32_t address = flashEcc_faultAddress(eccInfo);
+    if (address != 0)
+    {
+        uint32_t bank = (eccInfo & FLASH_ECCR_BK_ECC) ? 2 : 1;
+        uint32_t sector = (eccInfo & FLASH_ECCR_DATA_ECC) ? FLASH_GEOM_HC_SECTOR_OF(bank, address) :
+                                                            FLASH_GEOM_SECTOR_OF(bank, address);
+        uint32_t index = SECTOR_INDEX(bank, sector);
+        if (corrections[index] < UINT16_MAX)
+        {
+            corrections[index]++;
+        }
+        if (corrections[index] >= refreshThreshold)
+        {
+            refreshPending[index / 32] |= (1UL << (index % 32));
+        }
+    }
+
+    FLASH_ECC_CLEAR(FLASH->ECCCORR, FLASH_ECCR_ECCC);
+    __DSB();
+}
+
+/**
+ * @brief get the address of an ECC error from FLASH->ECCCORR or FLASH->ECCDETR
+ *
+ * ADDR_ECC is the index of the failing cell within its bank: the half-word index in the high
+ * cyclic area (DATA_ECC set), the quad-word index in main flash.
+ *
+ * @param eccInfo content of ECCCORR or ECCDETR
+ * @return first address of the failing half-word or quad-word, 0 for OTP, system flash or option byte keys
+ */
+uint32_t flashEcc_faultAddress(const uint32_t eccInfo)
+{
+    uint32_t bank = (eccInfo & FLASH_ECCR_BK_ECC) ? 2 : 1;
+    uint32_t index = (eccInfo & FLASH_ECCR_ADDR_ECC_Msk) >> FLASH_ECCR_ADDR_ECC_Pos;
+
+    if (eccInfo & (FLASH_ECCR_OBK_ECC | FLASH_ECCR_SYSF_ECC | FLASH_ECCR_OTP_ECC))
+    {
+        return 0;
+    }
+    if (eccInfo & FLASH_ECCR_DATA_ECC)
+    {
+        return FLASH_GEOM_HC_BANK_START(bank) + index * 2;
+    }
+    return FLASH_GEOM_BANK_START(bank) + index * 16;
+}
+
+/**
+ * @brief read a half-word which may fail ECC, e.g. a possibly virgin high cyclic cell
+ *
+ * @param address address of the half-word
+ * @param data receives the half-word, on error the failing data from FLASH->ECCDR
+ * @return false    OK
+ * @return true     Error: double ECC fault
+ */
+bool flashEcc_read16(const uint16_t* address, uint16_t* data)
+{
+    guardFault = false;
+    guardActive = true;
+    __DSB();
+    *data = FLASH_READ16(address);
+    // the NMI is taken once the read completed, before the flag is checked
+    __DSB();
+    __ISB();
+    guardActive = false;
+    if (guardFault)
+    {
+        *data = guardData;
+    }
+    return guardFault;
+}
+
+/**
+ * @brief read a main flash quad-word which may fail ECC, e.g. after an interrupted program
+ *
+ * @param address address of the quad-word, 16 byte aligned
+ * @param data receives the four words, undefined on error
+ * @return false    OK
+ * @return true     Error: double ECC fault
+ */
+bool flashEcc_read128(const uint32_t* address, uint32_t* data)
+{
+    RETURN_TRUE_IF_TRUE(((uint32_t) address & 0xF) != 0)
+
+    guardFault = false;
+    guardActive = true;
+    __DSB();
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        data[i] = FLASH_READ32(&address[i]);
+    }
+    __DSB();
+    __ISB();
+    guardActive = false;
+    return guardFault;
+}
+
+/**
+ * @brief get the amount of double ECC faults outside of guarded reads since reset
+ */
+uint32_t flashEcc_getFaultCount(void)
+{
+    return faultCount;
+}
+
+/**
+ * @brief get the last double ECC fault outside of guarded reads
+ *
+ * @param fault receives the fault
+ * @return false    OK
+ * @return true     Error: no fault occurred
+ */
+bool flashEcc_getLastFault(flashEcc_fault_t* fault)
+{
+    RETURN_TRUE_IF_TRUE(faultCount == 0)
+    fault->address = lastFault.address;
+    fault->eccInfo = lastFault.eccInfo;
+    fault->data = lastFault.data;
+    return false;
+}
+
+/**
+ * @brief count corrected ECC errors per sector in the flash interrupt
+ *
+ * @param threshold corrected errors after which a sector is due for a refresh, at least 1
+ */
+void flashEcc_enableCorrectionMonitor(const uint16_t threshold)
+{
+    refreshThreshold = (threshold > 0) ? threshold : 1;
+    FLASH_ECC_CLEAR(FLASH->ECCCORR, FLASH_ECCR_ECCC);
+    FLASH->ECCCORR |= FLASH_ECCR_ECCIE;
+    NVIC_EnableIRQ(FLASH_IRQn);
+}
+
+/**
+ * @brief get the amount of corrected ECC errors of a sector since its last refresh
+ *
+ * @param bank Bank 1 or 2
+ * @param sector the sector number, 120 to 127 for high cyclic memory
+ * @return amount of corrected errors, saturating
+ */
+uint16_t flashEcc_getCorrections(const uint32_t bank, const uint32_t sector)
+{
+    if (!(bank == 1 || bank == 2) || sector >= FLASH_PAGES_PER_BANK)
+    {
+        return 0;
+    }
+    return corrections[SECTOR_INDEX(bank, sector)];
+}
+
+/**
+ * @brief check if a sector reached the correction threshold and has to be refreshed
+ *
+ * @param bank Bank 1 or 2
+ * @param sector the sector number
+ * @return true if the sector is due for a refresh
+ */
+bool flashEcc_refreshDue(const uint32_t bank, const uint32_t sector)
+{
+    if (!(bank == 1 || bank == 2) || sector >= FLASH_PAGES_PER_BANK)
+    {
+        return false;
+    }
+    uint32_t index = SECTOR_INDEX(bank, sector);
+    return (refreshPending[index / 32] & (1UL << (index % 32))) != 0;
+}
+
+/**
+ * @brief restart counting for a sector after its owner refreshed it
+ *
+ * @param bank Bank 1 or 2
+ * @param sector the sector number
+ */
+void flashEcc_refreshDone(const uint32_t bank, const uint32_t sector)
+{
+    if (!(bank == 1 || bank == 2) || sector >= FLASH_PAGES_PER_BANK)
+    {
+        return;
+    }
+    uint32_t index = SECTOR_INDEX(bank, sector);
+
+    // the flash interrupt updates the same words
+    uint32_t primaskBit = __get_PRIMASK();
+    __disable_irq();
+    corrections[index] = 0;
+    refreshPending[index / 32] &= ~(1UL << (index % 32));
+    __set_PRIMASK(primaskBit);
+}
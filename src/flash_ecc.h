@@ -0,0 +1,39 @@
+#ifndef FLASH_ECC_H
+#define FLASH_ECC_H
+/**
+ * @file flash_ecc.h
+ * @brief recoverable double ECC faults of the flash
+ *
+ * A read of a virgin high cyclic cell, of a torn write or of a worn out cell fails ECC. The flash
+ * interface then raises the NMI, the read itself completes with undefined data. The NMI handler
+ * captures the failing address from FLASH->ECCDETR, clears the flag and returns.
+ *
+ * Reads that may hit a failing cell go through flashEcc_read16() / flashEcc_read128(), which report
+ * the fault to the caller. A fault of any other read is counted and kept as the last fault.
+ *
+ * Single bit errors are corrected on read and reported in FLASH->ECCCORR. With the correction
+ * monitor enabled, the flash interrupt counts them per sector. A sector whose count reaches the
+ * threshold is due for a refresh: its owner rewrites the live contents elsewhere and erases it
+ * before the next bit flips and the error becomes uncorrectable.
+ */
+#include "flash.h"
+
+typedef struct
+{
+    uint32_t address;           // first address of the failing half-word or quad-word, 0 if outside of the user flash
+    uint32_t eccInfo;           // FLASH->ECCDETR at the time of the fault
+    uint16_t data;              // FLASH->ECCDR, the failing data
+} flashEcc_fault_t;
+
+extern bool flashEcc_read16(const uint16_t* address, uint16_t* data);
+extern bool flashEcc_read128(const uint32_t* address, uint32_t* data);
+extern uint32_t flashEcc_faultAddress(const uint32_t eccInfo);
+extern uint32_t flashEcc_getFaultCount(void);
+extern bool flashEcc_getLastFault(flashEcc_fault_t* fault);
+
+extern void flashEcc_enableCorrectionMonitor(const uint16_t threshold);
+extern uint16_t flashEcc_getCorrections(const uint32_t bank, const uint32_t sector);
+extern bool flashEcc_refreshDue(const uint32_t bank, const uint32_t sector);
+extern void flashEcc_refreshDone(const uint32_t bank, const uint32_t sector);
+
+#endif // FLASH_ECC_H
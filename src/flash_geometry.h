@@ -0,0 +1,69 @@
+#ifndef FLASH_GEOMETRY_H
+#define FLASH_GEOMETRY_H
+/**
+ * @file flash_geometry.h
+ * @brief the one description of the flash layout of the STM32H563 (2 MB)
+ *
+ * Included by C code and by the linker script stm32h56x_2M_boot.ld.S, which is run through the
+ * preprocessor as assembler-with-cpp. Only plain constants and arithmetic are allowed outside of
+ * the __ASSEMBLER__ guard, so the values stay usable in MEMORY regions.
+ *
+ * Each bank consists of 128 sectors of 8 KB. The last up to 8 sectors of a bank can be turned into
+ * high cyclic memory (EDATA), which holds 6 KB per sector and is mapped contiguously to its own
+ * address range. Sector 120 + k of a bank is mapped to high cyclic sector k of that bank.
+ */
+
+#ifdef __ASSEMBLER__
+#define FLASH_GEOM_U(x)                     x
+#else
+#define FLASH_GEOM_U(x)                     x##UL
+#endif
+
+#define FLASH_GEOM_SECTORS_PER_BANK         FLASH_GEOM_U(128)
+#define FLASH_GEOM_SECTOR_SIZE              FLASH_GEOM_U(0x2000)
+#define FLASH_GEOM_BANK_SIZE                (FLASH_GEOM_SECTORS_PER_BANK * FLASH_GEOM_SECTOR_SIZE)
+#define FLASH_GEOM_START_BANK1              FLASH_GEOM_U(0x08000000)
+#define FLASH_GEOM_START_BANK2              (FLASH_GEOM_START_BANK1 + FLASH_GEOM_BANK_SIZE)
+
+#define FLASH_GEOM_HC_SECTORS_PER_BANK      FLASH_GEOM_U(8)
+#define FLASH_GEOM_HC_FIRST_SECTOR          (FLASH_GEOM_SECTORS_PER_BANK - FLASH_GEOM_HC_SECTORS_PER_BANK)
+#define FLASH_GEOM_HC_SECTOR_SIZE           FLASH_GEOM_U(0x1800)
+#define FLASH_GEOM_HC_BANK_SIZE             (FLASH_GEOM_HC_SECTORS_PER_BANK * FLASH_GEOM_HC_SECTOR_SIZE)
+#define FLASH_GEOM_HC_START_BANK1           FLASH_GEOM_U(0x09000000)
+#define FLASH_GEOM_HC_START_BANK2           (FLASH_GEOM_HC_START_BANK1 + FLASH_GEOM_HC_BANK_SIZE)
+
+// main flash of a bank that stays main flash even with the complete high cyclic area enabled
+#define FLASH_GEOM_CODE_SIZE_PER_BANK       (FLASH_GEOM_HC_FIRST_SECTOR * FLASH_GEOM_SECTOR_SIZE)
+
+#ifndef __ASSEMBLER__
+/*
+ * address and sector conversions, constant expressions for constant arguments
+ */
+#define FLASH_GEOM_BANK_START(bank)                 ((bank) == 1 ? FLASH_GEOM_START_BANK1 : FLASH_GEOM_START_BANK2)
+#define FLASH_GEOM_SECTOR_ADDRESS(bank, sector)     (FLASH_GEOM_BANK_START(bank) + (sector) * FLASH_GEOM_SECTOR_SIZE)
+#define FLASH_GEOM_SECTOR_OF(bank, address)         (((address) - FLASH_GEOM_BANK_START(bank)) / FLASH_GEOM_SECTOR_SIZE)
+
+#define FLASH_GEOM_HC_BANK_START(bank)              ((bank) == 1 ? FLASH_GEOM_HC_START_BANK1 : FLASH_GEOM_HC_START_BANK2)
+#define FLASH_GEOM_HC_BANK_END(bank)                (FLASH_GEOM_HC_BANK_START(bank) + FLASH_GEOM_HC_BANK_SIZE - 1)
+#define FLASH_GEOM_HC_SECTOR_ADDRESS(bank, sector) \
+    (FLASH_GEOM_HC_BANK_START(bank) + ((sector) - FLASH_GEOM_HC_FIRST_SECTOR) * FLASH_GEOM_HC_SECTOR_SIZE)
+#define FLASH_GEOM_HC_SECTOR_OF(bank, address) \
+    (FLASH_GEOM_HC_FIRST_SECTOR + ((address) - FLASH_GEOM_HC_BANK_START(bank)) / FLASH_GEOM_HC_SECTOR_SIZE)
+// first address of the high cyclic area of a bank when sectorCount sectors are enabled
+#define FLASH_GEOM_HC_AREA_START(bank, sectorCount) \
+    (FLASH_GEOM_HC_BANK_START(bank) + (FLASH_GEOM_HC_SECTORS_PER_BANK - (sectorCount)) * FLASH_GEOM_HC_SECTOR_SIZE)
+
+_Static_assert(FLASH_GEOM_START_BANK2 == 0x08100000UL, "bank 2 has to start behind bank 1");
+_Static_assert(FLASH_GEOM_HC_FIRST_SECTOR == 120, "high cyclic memory maps to the last 8 sectors of a bank");
+_Static_assert(FLASH_GEOM_HC_SECTOR_SIZE * 4 == FLASH_GEOM_SECTOR_SIZE * 3, "high cyclic sectors hold 6 KB of 8 KB");
+_Static_assert(FLASH_GEOM_HC_START_BANK2 == 0x0900C000UL, "bank 2 high cyclic memory starts behind bank 1");
+_Static_assert(FLASH_GEOM_SECTOR_OF(1, FLASH_GEOM_START_BANK1 + FLASH_GEOM_SECTOR_SIZE) == 1, "sector math");
+_Static_assert(FLASH_GEOM_SECTOR_OF(2, FLASH_GEOM_START_BANK2 + FLASH_GEOM_BANK_SIZE - 1) == 127, "sector math");
+_Static_assert(FLASH_GEOM_HC_SECTOR_OF(2, FLASH_GEOM_HC_START_BANK2) == 120, "high cyclic sector math");
+_Static_assert(FLASH_GEOM_HC_SECTOR_OF(1, FLASH_GEOM_HC_BANK_END(1)) == 127, "high cyclic sector math");
+_Static_assert(FLASH_GEOM_HC_SECTOR_ADDRESS(2, 121) == 0x0900D800UL, "high cyclic sector math");
+_Static_assert(FLASH_GEOM_HC_AREA_START(1, 8) == FLASH_GEOM_HC_START_BANK1, "high cyclic area math");
+_Static_assert(FLASH_GEOM_HC_AREA_START(1, 1) == FLASH_GEOM_HC_SECTOR_ADDRESS(1, 127), "high cyclic area math");
+#endif
+
+#endif // FLASH_GEOMETRY_H
@@ -0,0 +1,120 @@
+#ifndef FLASH_LL_H
+#define FLASH_LL_H
+/**
+ * @file flash_ll.h
+ * @brief register level definitions shared by the flash driver and the compile-time regions
+ */
+#include "flash.h"
+
+#define FLASH_KEY1              (0x45670123UL)
+#define FLASH_KEY2              (0xCDEF89ABUL)
+#define FLASH_OPT_KEY1          (0x08192A3BUL)
+#define FLASH_OPT_KEY2          (0x4C5D6E7FUL)
+
+#define FLASH_ERROR_FLAGS       (FLASH_SR_OPTCHANGEERR | FLASH_SR_INCERR | FLASH_SR_STRBERR | FLASH_SR_PGSERR | FLASH_SR_WRPERR)
+#define FLASH_OP_INCOMPLETE     (FLASH_SR_BSY | FLASH_SR_DBNE | FLASH_SR_WBNE)
+#define FLASH_CR_INTERRUPTS     (FLASH_CR_OPTCHANGEERRIE | FLASH_CR_INCERRIE | FLASH_CR_STRBERRIE | FLASH_CR_PGSERRIE | \
+                                 FLASH_CR_WRPERRIE | FLASH_CR_EOPIE)
+
+// hardware access primitives, the flash emulator of the host build provides its own
+#ifndef FLASH_EMULATION
+#define FLASH_WAIT_BSY()                while (FLASH->NSSR & FLASH_SR_BSY) {}
+#define FLASH_PROGRAM16(address, data)  (*(address) = (data))
+#define FLASH_PROGRAM32(address, data)  (*(address) = (data))
+#define FLASH_READ16(address)           (*(const volatile uint16_t*) (address))
+#define FLASH_READ32(address)           (*(const volatile uint32_t*) (address))
+#define FLASH_ECC_CLEAR(reg, flag)      ((reg) |= (flag))
+#define FLASH_ERRORS_CLEAR(flags)       (FLASH->NSCCR = (flags))
+#endif
+
+// half-words of the high cyclic area known to be erased, one bit each, see highCyclic_probe()
+#define HIGH_CYCLIC_BLANK_MAP_WORDS (FLASH_EDATA_SIZE / 2 / 32)
+extern uint32_t highCyclic_blankMap[HIGH_CYCLIC_BLANK_MAP_WORDS];
+
+// quad-word programming of main flash, framing the writes of the CPU or of a DMA channel
+extern bool flash_program128Begin(const uint32_t* address, const uint32_t size);
+extern bool flash_program128End(void);
+
+/**
+ * @brief forget that a high cyclic half-word is erased, before it is programmed
+ *
+ * @param address address of the half-word
+ */
+static inline __attribute__((always_inline)) void highCyclic_forgetBlank(const uint16_t* address)
+{
+    uint32_t index = ((uint32_t) address - HIGH_CYCLIC_START_BANK1) / 2;
+    highCyclic_blankMap[index / 32] &= ~(1UL << (index % 32));
+}
+
+/**
+ * @brief forget the erased half-words of the high cyclic sector of a flash sector, before it is erased
+ *
+ * @param bank Bank 1 or 2
+ * @param sector the sector number, nothing to forget for sectors without high cyclic memory
+ */
+static inline __attribute__((always_inline)) void highCyclic_forgetSector(const uint32_t bank, const uint32_t sector)
+{
+    if (sector >= HIGH_CYCLIC_PAGE_OFFSET)
+    {
+        uint32_t first = (FLASH_GEOM_HC_SECTOR_ADDRESS(bank, sector) - HIGH_CYCLIC_START_BANK1) / 2 / 32;
+        for (uint32_t i = 0; i < HIGH_CYCLIC_SECTOR_SIZE / 2 / 32; i++)
+        {
+            highCyclic_blankMap[first + i] = 0;
+        }
+    }
+}
+
+/**
+ * @brief remember that every half-word of a high cyclic sector is erased, after it was erased
+ *
+ * @param bank Bank 1 or 2
+ * @param sector the sector number, configured as high cyclic memory
+ */
+static inline __attribute__((always_inline)) void highCyclic_markSectorBlank(const uint32_t bank, const uint32_t sector)
+{
+    uint32_t first = (FLASH_GEOM_HC_SECTOR_ADDRESS(bank, sector) - HIGH_CYCLIC_START_BANK1) / 2 / 32;
+    for (uint32_t i = 0; i < HIGH_CYCLIC_SECTOR_SIZE / 2 / 32; i++)
+    {
+        highCyclic_blankMap[first + i] = 0xFFFFFFFFUL;
+    }
+}
+
+/**
+ * @brief check that the flash is locked and no operation is in progress or left an error flag,
+ *        the precondition of every erase and program
+ *
+ * @return true if an erase or program may start
+ */
+static inline __attribute__((always_inline)) bool flash_isIdle(void)
+{
+    return (FLASH->NSSR & (FLASH_ERROR_FLAGS | FLASH_OP_INCOMPLETE)) == 0 && (FLASH->NSCR & FLASH_CR_LOCK) != 0;
+}
+
+/**
+ * @brief check the error flags at the end of an own operation and clear them, a failed program
+ *        or erase must not block the following ones until reset
+ *
+ * @return true if an error flag was set
+ */
+static inline __attribute__((always_inline)) bool flash_takeErrors(void)
+{
+    uint32_t errors = FLASH->NSSR & FLASH_ERROR_FLAGS;
+    FLASH_ERRORS_CLEAR(errors);
+    return errors != 0;
+}
+
+/**
+ * @brief invalidate the instruction cache after main flash changed, if it is enabled
+ * @note the high cyclic area is not cacheable, see flash_cache.h
+ */
+static inline __attribute__((always_inline)) void flashCache_invalidate(void)
+{
+    if (ICACHE->CR & ICACHE_CR_EN)
+    {
+        ICACHE->CR |= ICACHE_CR_CACHEINV;
+        while (ICACHE->SR & ICACHE_SR_BUSYF) {}
+        ICACHE->FCR = ICACHE_FCR_CBSYENDF;
+    }
+}
+
+#endif // FLASH_LL_H
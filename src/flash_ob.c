@@ -0,0 +1,162 @@
+#include <stddef.h>
+#include "flash_ob.h"
+#include "flash_ll.h"
+
+#define RETURN_TRUE_IF_TRUE(cond) if(cond) {return true;}
+
+#define FLASH_OB_EDATA_FIELDS   (FLASH_OB_FIELD(FLASH_OB_EDATA1) | FLASH_OB_FIELD(FLASH_OB_EDATA2))
+
+/**
+ * @brief the _CUR or _PRG register of a field
+ */
+static volatile uint32_t* flashOb_register(const flashOb_field_t field, const bool program)
+{
+    switch (field)
+    {
+        case FLASH_OB_EDATA1:   return program ? &FLASH->EDATA1R_PRG : &FLASH->EDATA1R_CUR;
+        case FLASH_OB_EDATA2:   return program ? &FLASH->EDATA2R_PRG : &FLASH->EDATA2R_CUR;
+        case FLASH_OB_WRP1:     return program ? &FLASH->WRP1R_PRG : &FLASH->WRP1R_CUR;
+        case FLASH_OB_WRP2:     return program ? &FLASH->WRP2R_PRG : &FLASH->WRP2R_CUR;
+        case FLASH_OB_HDP1:     return program ? &FLASH->HDP1R_PRG : &FLASH->HDP1R_CUR;
+        default:                return program ? &FLASH->HDP2R_PRG : &FLASH->HDP2R_CUR;
+    }
+}
+
+/**
+ * @brief start an empty transaction
+ */
+void flashOb_begin(flashOb_transaction_t* transaction)
+{
+    transaction->staged = 0;
+}
+
+/**
+ * @brief stage the register value of a field, replacing a value staged before
+ */
+void flashOb_stage(flashOb_transaction_t* transaction, const flashOb_field_t field, const uint32_t value)
+{
+    transaction->staged |= FLASH_OB_FIELD(field);
+    transaction->value[field] = value;
+}
+
+/**
+ * @brief stage the size of the high cyclic area of a bank
+ *
+ * @param bank the bank, 1 or 2
+ * @param sectorCount amount of sectors, 0 disables high cyclic memory
+ * @return false    OK
+ * @return true     Error: invalid bank or too many sectors
+ */
+bool flashOb_stageHighCyclic(flashOb_transaction_t* transaction, const uint32_t bank, const uint32_t sectorCount)
+{
+    RETURN_TRUE_IF_TRUE(bank != 1 && bank != 2)
+    RETURN_TRUE_IF_TRUE(sectorCount > FLASH_GEOM_HC_SECTORS_PER_BANK)
+
+    uint32_t configuration = 0;
+    if (sectorCount > 0)
+    {
+        configuration = FLASH_EDATAR_EDATA_EN | ((sectorCount - 1) << FLASH_EDATAR_EDATA_STRT_Pos);
+    }
+    flashOb_stage(transaction, (bank == 1) ? FLASH_OB_EDATA1 : FLASH_OB_EDATA2, configuration);
+    return false;
+}
+
+/**
+ * @brief the value of a field in effect
+ */
+uint32_t flashOb_current(const flashOb_field_t field)
+{
+    return *flashOb_register(field, false);
+}
+
+/**
+ * @brief program all staged fields that differ from their current value with a single OPTSTART
+ *
+ * @param transaction the staged fields
+ * @param changed receives the FLASH_OB_FIELD() bits of the fields whose value changed, may be NULL
+ * @return false    OK, every staged field holds its value
+ * @return true     Error: the flash is busy, an error flag was set or a staged field does not hold its value
+ *                  afterwards. The error flags are cleared again
+ */
+bool flashOb_commit(const flashOb_transaction_t* transaction, uint32_t* changed)
+{
+    uint32_t before[FLASH_OB_FIELDS];
+    uint32_t pending = 0;
+    for (uint32_t field = 0; field < FLASH_OB_FIELDS; field++)
+    {
+        before[field] = flashOb_current(field);
+        if ((transaction->staged & FLASH_OB_FIELD(field)) && before[field] != transaction->value[field])
+        {
+            pending |= FLASH_OB_FIELD(field);
+        }
+    }
+    if (changed != NULL)
+    {
+        *changed = 0;
+    }
+    if (pending == 0)
+    {
+        return false;
+    }
+
+    // check error flags and BSY, DBNE, WBNE
+    RETURN_TRUE_IF_TRUE((FLASH->NSSR & (FLASH_ERROR_FLAGS | FLASH_OP_INCOMPLETE)) != 0)
+    // unlocked: another operation, e.g. a DMA-fed write, is in progress
+    RETURN_TRUE_IF_TRUE((FLASH->NSCR & FLASH_CR_LOCK) == 0)
+
+    // sectors change between main flash and high cyclic memory, forget what was known to be erased
+    for (uint32_t bank = 1; bank <= 2; bank++)
+    {
+        if (pending & FLASH_OB_FIELD(bank == 1 ? FLASH_OB_EDATA1 : FLASH_OB_EDATA2))
+        {
+            for (uint32_t sector = HIGH_CYCLIC_PAGE_OFFSET; sector < FLASH_PAGES_PER_BANK; sector++)
+            {
+                highCyclic_forgetSector(bank, sector);
+            }
+        }
+    }
+
+    // unlock flash option bytes
+    FLASH->OPTKEYR = FLASH_OPT_KEY1;
+    FLASH->OPTKEYR = FLASH_OPT_KEY2;
+
+    // write configuration data into the programming registers, the others keep their current value
+    for (uint32_t field = 0; field < FLASH_OB_FIELDS; field++)
+    {
+        if (pending & FLASH_OB_FIELD(field))
+        {
+            *flashOb_register(field, true) = transaction->value[field];
+        }
+    }
+
+    // start flashing
+    FLASH->OPTCR |= FLASH_OPTCR_OPTSTART;
+
+    // wait for bsy clear
+    FLASH_WAIT_BSY();
+
+    // lock flash again
+    FLASH->OPTCR = FLASH_OPTCR_OPTLOCK;
+
+    // main flash sectors may have turned into high cyclic ones, drop their cached content
+    if (pending & FLASH_OB_EDATA_FIELDS)
+    {
+        flashCache_invalidate();
+    }
+
+    // clear the error flags, otherwise every following erase and program is refused
+    bool error = flash_takeErrors();
+    for (uint32_t field = 0; field < FLASH_OB_FIELDS; field++)
+    {
+        uint32_t current = flashOb_current(field);
+        if (changed != NULL && current != before[field])
+        {
+            *changed |= FLASH_OB_FIELD(field);
+        }
+        if ((pending & FLASH_OB_FIELD(field)) && current != transaction->value[field])
+        {
+            error = true;
+        }
+    }
+    return error;
+}
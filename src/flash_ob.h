@@ -0,0 +1,50 @@
+#ifndef FLASH_OB_H
+#define FLASH_OB_H
+/**
+ * @file flash_ob.h
+ * @brief option byte transactions
+ *
+ * Option bytes are programmed from all _PRG registers at once by OPTSTART, one erase and
+ * program cycle of the option byte area per start. A transaction stages the high cyclic area,
+ * write protection and hide protection of both banks and commits them together with a single
+ * OPTSTART. Fields that already hold their staged value are left alone, a transaction without
+ * changes does not start a cycle at all.
+ *
+ * flashOb_transaction_t transaction;
+ * flashOb_begin(&transaction);
+ * flashOb_stageHighCyclic(&transaction, 1, 8);
+ * flashOb_stageHighCyclic(&transaction, 2, 4);
+ * flashOb_commit(&transaction, &changed);
+ *
+ * After the cycle every staged field is read back from its _CUR register. The commit reports
+ * the fields whose _CUR register changed, and fails if any of them does not hold its staged value.
+ */
+#include "flash.h"
+
+typedef enum
+{
+    FLASH_OB_EDATA1 = 0,        // EDATA1R, high cyclic area of bank 1
+    FLASH_OB_EDATA2,            // EDATA2R, high cyclic area of bank 2
+    FLASH_OB_WRP1,              // WRP1R, write protected sector groups of bank 1, a 0 bit protects
+    FLASH_OB_WRP2,              // WRP2R, write protected sector groups of bank 2, a 0 bit protects
+    FLASH_OB_HDP1,              // HDP1R, hide protection area of bank 1
+    FLASH_OB_HDP2,              // HDP2R, hide protection area of bank 2
+    FLASH_OB_FIELDS
+} flashOb_field_t;
+
+// bit of a field in the staged and changed masks
+#define FLASH_OB_FIELD(field)   (1UL << (field))
+
+typedef struct
+{
+    uint32_t staged;                    // FLASH_OB_FIELD() bits of the staged fields
+    uint32_t value[FLASH_OB_FIELDS];    // staged register values
+} flashOb_transaction_t;
+
+extern void flashOb_begin(flashOb_transaction_t* transaction);
+extern void flashOb_stage(flashOb_transaction_t* transaction, const flashOb_field_t field, const uint32_t value);
+extern bool flashOb_stageHighCyclic(flashOb_transaction_t* transaction, const uint32_t bank, const uint32_t sectorCount);
+extern uint32_t flashOb_current(const flashOb_field_t field);
+extern bool flashOb_commit(const flashOb_transaction_t* transaction, uint32_t* changed);
+
+#endif // FLASH_OB_H
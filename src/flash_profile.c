@@ -0,0 +1,108 @@
+#include "flash_profile.h"
+#ifdef FLASH_EMULATION
+#include <stdio.h>
+#endif
+
+#define ICACHE_MONITORS         (ICACHE_CR_HITMEN | ICACHE_CR_MISSMEN)
+#define ICACHE_MONITORS_RESET   (ICACHE_CR_HITMRST | ICACHE_CR_MISSMRST)
+#define DCACHE_MONITORS         (DCACHE_CR_RHITMEN | DCACHE_CR_RMISSMEN | DCACHE_CR_WHITMEN | DCACHE_CR_WMISSMEN)
+#define DCACHE_MONITORS_RESET   (DCACHE_CR_RHITMRST | DCACHE_CR_RMISSMRST | DCACHE_CR_WHITMRST | DCACHE_CR_WMISSMRST)
+
+// core cycle counter, the host build has none
+#ifndef FLASH_EMULATION
+#define CYCLES()    (DWT->CYCCNT)
+#else
+#define CYCLES()    0U
+#endif
+
+// cycle counter at flashProfile_start(), the counter keeps running for other users such as hc_compress
+static uint32_t startCycles;
+
+/**
+ * @brief hits per 1000 accesses, FLASH_PROFILE_NONE without accesses
+ */
+static uint16_t permille(const uint32_t hits, const uint32_t misses)
+{
+    uint64_t accesses = (uint64_t) hits + misses;
+    if (accesses == 0)
+    {
+        return FLASH_PROFILE_NONE;
+    }
+    return (uint16_t) (((uint64_t) hits * 1000) / accesses);
+}
+
+/**
+ * @brief reset and enable the cache monitors and the cycle counter
+ */
+void flashProfile_start(void)
+{
+    // monitors are reset by setting and clearing their reset bits
+    ICACHE->CR |= ICACHE_MONITORS | ICACHE_MONITORS_RESET;
+    ICACHE->CR &= ~ICACHE_MONITORS_RESET;
+    DCACHE1->CR |= DCACHE_MONITORS | DCACHE_MONITORS_RESET;
+    DCACHE1->CR &= ~DCACHE_MONITORS_RESET;
+
+#ifndef FLASH_EMULATION
+    DCB->DEMCR |= DCB_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    startCycles = CYCLES();
+}
+
+/**
+ * @brief stop the monitors and take the counts since flashProfile_start()
+ *
+ * @param profile receives the counts
+ */
+void flashProfile_stop(flashProfile_t* profile)
+{
+    uint32_t cycles = CYCLES() - startCycles;
+
+    // freeze the monitors first, so reading them is not counted
+    ICACHE->CR &= ~ICACHE_MONITORS;
+    DCACHE1->CR &= ~DCACHE_MONITORS;
+
+    profile->cycles = cycles;
+    profile->icacheHits = ICACHE->HMONR;
+    profile->icacheMisses = ICACHE->MMONR;
+    profile->dcacheReadHits = DCACHE1->RHMONR;
+    profile->dcacheReadMisses = DCACHE1->RMMONR;
+    profile->dcacheWriteHits = DCACHE1->WHMONR;
+    profile->dcacheWriteMisses = DCACHE1->WMMONR;
+    profile->icacheHitPermille = permille(profile->icacheHits, profile->icacheMisses);
+    profile->dcacheReadHitPermille = permille(profile->dcacheReadHits, profile->dcacheReadMisses);
+}
+
+#ifdef FLASH_EMULATION
+/**
+ * @brief print a hit ratio behind a count, n/a for a cache without accesses
+ */
+static void printRatio(const char* name, const uint32_t count, const uint16_t ratio, const char* of)
+{
+    if (ratio == FLASH_PROFILE_NONE)
+    {
+        printf("%-20s %12u  (n/a)\n", name, count);
+    }
+    else
+    {
+        printf("%-20s %12u  (%u.%u %% of %s)\n", name, count, ratio / 10U, ratio % 10U, of);
+    }
+}
+
+/**
+ * @brief print a profile in the format of the emulator's wear report
+ * @note host builds only, the firmware has no output channel and keeps reading the struct with the debugger
+ *
+ * @param profile the counts of flashProfile_stop()
+ */
+void flashProfile_print(const flashProfile_t* profile)
+{
+    printf("cycles               %12u\n", profile->cycles);
+    printRatio("icache hits", profile->icacheHits, profile->icacheHitPermille, "accesses");
+    printf("icache misses        %12u\n", profile->icacheMisses);
+    printRatio("dcache read hits", profile->dcacheReadHits, profile->dcacheReadHitPermille, "reads");
+    printf("dcache read misses   %12u\n", profile->dcacheReadMisses);
+    printf("dcache write hits    %12u\n", profile->dcacheWriteHits);
+    printf("dcache write misses  %12u\n", profile->dcacheWriteMisses);
+}
+#endif
@@ -0,0 +1,48 @@
+#ifndef FLASH_PROFILE_H
+#define FLASH_PROFILE_H
+/**
+ * @file flash_profile.h
+ * @brief cache hit/miss and cycle counts of a code region reading flash
+ *
+ * FLASH_PROFILE(&profile, hcStore_read(&store, key, &value, sizeof(value)));
+ *
+ * The ICACHE monitors count the accesses to the internal flash (see flash_cache.h). The DCACHE1
+ * monitors only count while DCACHE1 serves external memory and stay 0 otherwise. The hit and
+ * miss monitors saturate: hits at 2^32 - 1, misses at 2^16 - 1.
+ * Like the other flash counters, a profile is a plain struct meant to be read with the debugger.
+ * Host builds print it with flashProfile_print() in the format of the emulator's wear report.
+ * The emulator has no caches and no cycle counter, there every count stays 0.
+ */
+#include "flash.h"
+
+// hit ratio of a cache without accesses
+#define FLASH_PROFILE_NONE      UINT16_MAX
+
+typedef struct
+{
+    uint32_t cycles;                    // core cycles of the region, difference of DWT->CYCCNT
+    uint32_t icacheHits;                // ICACHE->HMONR
+    uint32_t icacheMisses;              // ICACHE->MMONR
+    uint32_t dcacheReadHits;            // DCACHE1->RHMONR
+    uint32_t dcacheReadMisses;          // DCACHE1->RMMONR
+    uint32_t dcacheWriteHits;           // DCACHE1->WHMONR
+    uint32_t dcacheWriteMisses;         // DCACHE1->WMMONR
+    uint16_t icacheHitPermille;         // hits per 1000 accesses, FLASH_PROFILE_NONE without accesses
+    uint16_t dcacheReadHitPermille;     // hits per 1000 reads, FLASH_PROFILE_NONE without reads
+} flashProfile_t;
+
+#define FLASH_PROFILE(profile, statement) \
+    do \
+    { \
+        flashProfile_start(); \
+        statement; \
+        flashProfile_stop(profile); \
+    } while (0)
+
+extern void flashProfile_start(void);
+extern void flashProfile_stop(flashProfile_t* profile);
+#ifdef FLASH_EMULATION
+extern void flashProfile_print(const flashProfile_t* profile);
+#endif
+
+#endif // FLASH_PROFILE_H
@@ -0,0 +1,184 @@
+#ifndef FLASH_REGION_H
+#define FLASH_REGION_H
+/**
+ * @file flash_region.h
+ * @brief flash regions with bank, kind and sector range fixed at compile time
+ *
+ * FLASH_REGION(name, bank, kind, sectorFirst, sectorLast) declares the constants of a region:
+ * name_BANK, name_KIND, name_SECTOR_FIRST, name_SECTOR_LAST, name_START, name_SECTOR_SIZE,
+ * name_SIZE and name_GRANULE (program granularity in bytes). A bank or sector range that is not
+ * valid for the kind of memory does not compile.
+ *
+ * The access macros take constant offsets. Offsets outside of the region or not aligned to its
+ * program granularity, and writes of the wrong width, do not compile. Since no range is left to
+ * check at runtime, a write is only the register sequence: check idle, unlock, program, wait, lock.
+ *
+ * Protections and the high cyclic configuration are only known at runtime. Check them once with
+ * FLASH_REGION_CHECK() before the first access. The state of the flash is checked on every
+ * access: a write or erase fails without touching the flash while another operation, e.g. a
+ * DMA-fed write, holds it unlocked or an error flag is pending.
+ *
+ * FLASH_REGION(HC_CONFIG, 2, FLASH_KIND_HIGH_CYCLIC, 120, 121);
+ * FLASH_REGION_WRITE16(HC_CONFIG, 0x0004, 0x89AB);
+ * FLASH_REGION_WRITE16(HC_CONFIG, 0x3000, 0x89AB);   // does not compile, outside of the region
+ */
+#include "flash_ll.h"
+
+#define FLASH_KIND_MAIN         0   // main flash, programmed by 128 bit quad-words
+#define FLASH_KIND_HIGH_CYCLIC  1   // high cyclic memory, programmed by 16 bit half-words
+
+// compile-time assertion usable inside of expressions
+#define FLASH_STATIC_CHECK(cond, msg)   ((void) sizeof(struct { _Static_assert(cond, msg); int dummy; }))
+
+#define FLASH_REGION_SECTOR_SIZE(kind)  ((kind) == FLASH_KIND_HIGH_CYCLIC ? HIGH_CYCLIC_SECTOR_SIZE : FLASH_PAGE_SIZE)
+
+#define FLASH_REGION_SECTOR_ADDRESS(bank, kind, sector) \
+    ((kind) == FLASH_KIND_HIGH_CYCLIC ? FLASH_GEOM_HC_SECTOR_ADDRESS(bank, sector) : FLASH_GEOM_SECTOR_ADDRESS(bank, sector))
+
+#define FLASH_REGION(name, bank, kind, sectorFirst, sectorLast) \
+    _Static_assert((bank) == 1 || (bank) == 2, #name ": bank has to be 1 or 2"); \
+    _Static_assert((kind) == FLASH_KIND_MAIN || (kind) == FLASH_KIND_HIGH_CYCLIC, #name ": unknown kind of memory"); \
+    _Static_assert((sectorFirst) <= (sectorLast) && (sectorLast) < FLASH_PAGES_PER_BANK, #name ": invalid sector range"); \
+    _Static_assert((kind) == FLASH_KIND_MAIN || (sectorFirst) >= HIGH_CYCLIC_PAGE_OFFSET, \
+                   #name ": high cyclic memory only maps to the last sectors of a bank"); \
+    enum \
+    { \
+        name##_BANK = (bank), \
+        name##_KIND = (kind), \
+        name##_SECTOR_FIRST = (sectorFirst), \
+        name##_SECTOR_LAST = (sectorLast), \
+        name##_START = FLASH_REGION_SECTOR_ADDRESS(bank, kind, sectorFirst), \
+        name##_SECTOR_SIZE = FLASH_REGION_SECTOR_SIZE(kind), \
+        name##_SIZE = ((sectorLast) - (sectorFirst) + 1) * FLASH_REGION_SECTOR_SIZE(kind), \
+        name##_GRANULE = ((kind) == FLASH_KIND_HIGH_CYCLIC) ? 2 : 16 \
+    }
+
+#define FLASH_REGION_ADDRESS(region, offset) \
+    (FLASH_STATIC_CHECK((uint32_t) (offset) < region##_SIZE, "offset outside of " #region), \
+     FLASH_STATIC_CHECK(((offset) % region##_GRANULE) == 0, "offset not aligned to the program granularity of " #region), \
+     (uint32_t) region##_START + (uint32_t) (offset))
+
+#define FLASH_REGION_READ16(region, offset) \
+    (*(const volatile uint16_t*) FLASH_REGION_ADDRESS(region, offset))
+
+#define FLASH_REGION_WRITE16(region, offset, data) \
+    (FLASH_STATIC_CHECK(region##_KIND == FLASH_KIND_HIGH_CYCLIC, #region " is not programmed by half-words"), \
+     flashRegion_program16((uint16_t*) FLASH_REGION_ADDRESS(region, offset), (data)))
+
+#define FLASH_REGION_WRITE128(region, offset, data) \
+    (FLASH_STATIC_CHECK(region##_KIND == FLASH_KIND_MAIN, #region " is not programmed by quad-words"), \
+     flashRegion_program128((uint32_t*) FLASH_REGION_ADDRESS(region, offset), (data)))
+
+#define FLASH_REGION_ERASE(region, sector) \
+    (FLASH_STATIC_CHECK((sector) >= region##_SECTOR_FIRST && (sector) <= region##_SECTOR_LAST, "sector outside of " #region), \
+     flashRegion_erase(region##_BANK, region##_KIND == FLASH_KIND_HIGH_CYCLIC, (sector)))
+
+#define FLASH_REGION_CHECK(region) \
+    flash_checkRegion(region##_BANK, region##_KIND == FLASH_KIND_HIGH_CYCLIC, region##_SECTOR_FIRST, region##_SECTOR_LAST)
+
+/**
+ * @brief unlock the flash if it is idle, the runtime precondition of every access
+ *
+ * @return false    OK, the flash is unlocked
+ * @return true     Error: an operation is in progress or an error flag is pending, nothing was changed
+ */
+static inline __attribute__((always_inline)) bool flashRegion_unlock(void)
+{
+    if (!flash_isIdle())
+    {
+        return true;
+    }
+    FLASH->NSKEYR = FLASH_KEY1;
+    FLASH->NSKEYR = FLASH_KEY2;
+    return false;
+}
+
+/**
+ * @brief program one half-word of high cyclic memory, without range checks
+ * @note use FLASH_REGION_WRITE16()
+ *
+ * @param address target address
+ * @param data the half-word
+ * @return false    OK
+ * @return true     Error
+ */
+static inline __attribute__((always_inline)) bool flashRegion_program16(uint16_t* address, const uint16_t data)
+{
+    if (flashRegion_unlock())
+    {
+        return true;
+    }
+    FLASH->NSCR = (FLASH->NSCR & FLASH_CR_INTERRUPTS) | FLASH_CR_PG;
+    highCyclic_forgetBlank(address);
+    FLASH_PROGRAM16(address, data);
+    FLASH_WAIT_BSY();
+    FLASH->NSCR = FLASH_CR_LOCK;
+    return flash_takeErrors();
+}
+
+/**
+ * @brief program one quad-word of main flash, without range checks
+ * @note use FLASH_REGION_WRITE128()
+ *
+ * @param address target address
+ * @param data the four words of the quad-word
+ * @return false    OK
+ * @return true     Error
+ */
+static inline __attribute__((always_inline)) bool flashRegion_program128(uint32_t* address, const uint32_t* data)
+{
+    if (flashRegion_unlock())
+    {
+        return true;
+    }
+    FLASH->NSCR = (FLASH->NSCR & FLASH_CR_INTERRUPTS) | FLASH_CR_PG;
+
+    // the four words of a quad-word must not be interleaved with other flash writes
+    uint32_t primaskBit = __get_PRIMASK();
+    __disable_irq();
+    FLASH_PROGRAM32(&address[0], data[0]);
+    FLASH_PROGRAM32(&address[1], data[1]);
+    FLASH_PROGRAM32(&address[2], data[2]);
+    FLASH_PROGRAM32(&address[3], data[3]);
+    __set_PRIMASK(primaskBit);
+
+    FLASH_WAIT_BSY();
+    FLASH->NSCR = FLASH_CR_LOCK;
+    flashCache_invalidate();
+    return flash_takeErrors();
+}
+
+/**
+ * @brief erase one sector, without range checks
+ * @note use FLASH_REGION_ERASE()
+ *
+ * @param bank Bank 1 or 2
+ * @param highCyclic true if the sector is high cyclic memory, its cells are known to be erased afterwards
+ * @param sector the sector number
+ * @return false    OK
+ * @return true     Error
+ */
+static inline __attribute__((always_inline)) bool flashRegion_erase(const uint32_t bank, const bool highCyclic, const uint32_t sector)
+{
+    if (flashRegion_unlock())
+    {
+        return true;
+    }
+    highCyclic_forgetSector(bank, sector);
+    FLASH->NSCR = (FLASH->NSCR & FLASH_CR_INTERRUPTS) | (sector << FLASH_CR_SNB_Pos) | ((bank - 1) << FLASH_CR_BKSEL_Pos) | FLASH_CR_SER;
+    FLASH->NSCR |= FLASH_CR_START;
+    FLASH_WAIT_BSY();
+    FLASH->NSCR = FLASH_CR_LOCK;
+    flashCache_invalidate();
+    if (flash_takeErrors())
+    {
+        return true;
+    }
+    if (highCyclic)
+    {
+        highCyclic_markSectorBlank(bank, sector);
+    }
+    return false;
+}
+
+#endif // FLASH_REGION_H
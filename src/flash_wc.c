@@ -0,0 +1,181 @@
+#include <string.h>
+#include "flash_wc.h"
+
+#define RETURN_TRUE_IF_TRUE(cond) if(cond) {return true;}
+
+#define FLASH_WC_QUAD           16
+
+/**
+ * @brief program the collected quad-word and start the next one
+ *
+ * A failed program consumes the quad-word, it cannot be programmed again. A refused one leaves
+ * it erased and collected in RAM, the next append or flush programs it.
+ *
+ * @return false    OK
+ * @return true     Error
+ */
+static bool flashWc_program(flashWc_t* wc)
+{
+    memset((uint8_t*) wc->pending + wc->fill, 0xFF, FLASH_WC_QUAD - wc->fill);
+    bool error = flash_write((void*) wc->next, wc->pending, FLASH_WC_QUAD);
+    if (error && flash_refused())
+    {
+        return true;
+    }
+    wc->next += FLASH_WC_QUAD;
+    wc->fill = 0;
+    return error;
+}
+
+/**
+ * @brief open a main flash region for appending, behind the data it already holds
+ *
+ * @param wc the writer
+ * @param address first address of the region, quad-word aligned
+ * @param size size of the region, multiple of 16
+ * @return false    OK
+ * @return true     Error: region invalid or not aligned
+ */
+bool flashWc_open(flashWc_t* wc, void* address, const uint32_t size)
+{
+    uint32_t first = (uint32_t) address;
+    RETURN_TRUE_IF_TRUE(size == 0 || ((first | size) & (FLASH_WC_QUAD - 1)) != 0)
+    RETURN_TRUE_IF_TRUE(first < FLASH_START_BANK1 || first + size - 1 > FLASH_END_BANK2)
+
+    // continue behind the last quad-word programmed before
+    flash_probeResult_t probe;
+    RETURN_TRUE_IF_TRUE(highCyclic_probe(address, size, NULL, &probe))
+
+    wc->next = probe.end;
+    wc->end = first + size;
+    wc->fill = 0;
+    return false;
+}
+
+/**
+ * @brief append bytes to the region, programming every quad-word that is complete
+ *
+ * If another flash operation refuses a program, the append stops in front of the quad-word it
+ * could not program: the bytes up to flashWc_tail() are appended, append the rest again later.
+ *
+ * @param wc the writer
+ * @param data the bytes, any alignment
+ * @param size amount of bytes
+ * @return false    OK
+ * @return true     Error: not enough space left, nothing is appended, programming refused or programming failed
+ */
+bool flashWc_append(flashWc_t* wc, const void* data, const uint32_t size)
+{
+    const uint8_t* bytes = (const uint8_t*) data;
+    uint32_t remaining = size;
+    RETURN_TRUE_IF_TRUE(wc->end - wc->next - wc->fill < size)
+
+    // complete the collected quad-word first
+    if (wc->fill != 0)
+    {
+        uint32_t step = (remaining < FLASH_WC_QUAD - wc->fill) ? remaining : FLASH_WC_QUAD - wc->fill;
+        memcpy((uint8_t*) wc->pending + wc->fill, bytes, step);
+        wc->fill += step;
+        bytes += step;
+        remaining -= step;
+        if (wc->fill == FLASH_WC_QUAD && flashWc_program(wc))
+        {
+            // a refused program keeps the bytes collected before, but none of this append
+            if (flash_refused())
+            {
+                wc->fill -= step;
+            }
+            return true;
+        }
+    }
+
+    // whole quad-words of word aligned data at once, others through the RAM quad-word
+    uint32_t whole = remaining & ~(FLASH_WC_QUAD - 1);
+    if (whole != 0 && ((uint32_t) bytes & 3) == 0)
+    {
+        if (flash_write((void*) wc->next, bytes, whole))
+        {
+            if (!flash_refused())
+            {
+                wc->next += whole;
+            }
+            return true;
+        }
+        wc->next += whole;
+        bytes += whole;
+        remaining -= whole;
+    }
+    while (remaining >= FLASH_WC_QUAD)
+    {
+        memcpy(wc->pending, bytes, FLASH_WC_QUAD);
+        wc->fill = FLASH_WC_QUAD;
+        if (flashWc_program(wc))
+        {
+            if (flash_refused())
+            {
+                wc->fill = 0;
+            }
+            return true;
+        }
+        bytes += FLASH_WC_QUAD;
+        remaining -= FLASH_WC_QUAD;
+    }
+
+    // the rest is shorter than a quad-word, nothing is left if the collected one is not complete yet
+    memcpy((uint8_t*) wc->pending + wc->fill, bytes, remaining);
+    wc->fill += remaining;
+    return false;
+}
+
+/**
+ * @brief program the bytes collected in RAM, padded with 0xFF to a whole quad-word
+ * @note the rest of the quad-word is lost for appends
+ *
+ * @return false    OK, also if nothing was collected
+ * @return true     Error: programming failed, or it was refused and the bytes stay collected
+ */
+bool flashWc_flush(flashWc_t* wc)
+{
+    if (wc->fill == 0)
+    {
+        return false;
+    }
+    return flashWc_program(wc);
+}
+
+/**
+ * @brief read appended bytes, from flash or from the quad-word still collected in RAM
+ *
+ * @param wc the writer
+ * @param address first address, in front of the tail
+ * @param buffer receives the bytes
+ * @param size amount of bytes
+ * @return false    OK
+ * @return true     Error: the range is not within the appended bytes
+ */
+bool flashWc_read(const flashWc_t* wc, const void* address, void* buffer, const uint32_t size)
+{
+    uint32_t first = (uint32_t) address;
+    uint8_t* bytes = (uint8_t*) buffer;
+    RETURN_TRUE_IF_TRUE(first + size > flashWc_tail(wc) || first + size < first)
+
+    uint32_t programmed = (first < wc->next) ? wc->next - first : 0;
+    if (programmed > size)
+    {
+        programmed = size;
+    }
+    memcpy(bytes, address, programmed);
+    if (programmed < size)
+    {
+        memcpy(bytes + programmed, (const uint8_t*) wc->pending + (first + programmed - wc->next), size - programmed);
+    }
+    return false;
+}
+
+/**
+ * @brief address the next appended byte goes to
+ */
+uint32_t flashWc_tail(const flashWc_t* wc)
+{
+    return wc->next + wc->fill;
+}
@@ -0,0 +1,36 @@
+#ifndef FLASH_WC_H
+#define FLASH_WC_H
+/**
+ * @file flash_wc.h
+ * @brief write combining: byte granular appends to main flash, programmed by whole quad-words
+ *
+ * Main flash is programmed in quad-words, each one once between erases. A writer appends any
+ * amount of bytes to a region; they collect in a RAM quad-word and are programmed as soon as it
+ * is full, whole quad-words of larger appends go to the flash directly. The bytes still in RAM
+ * stay readable through flashWc_read().
+ *
+ * flashWc_flush() programs a partial quad-word padded with 0xFF, the next append starts at the
+ * following quad-word. Call it before a reset or whenever the data has to survive a power loss.
+ *
+ * flashWc_t trace;
+ * flashWc_open(&trace, (void*) FLASH_GEOM_SECTOR_ADDRESS(2, 64), 4 * FLASH_PAGE_SIZE);
+ * flashWc_append(&trace, &event, sizeof(event));
+ * flashWc_flush(&trace);
+ */
+#include "flash.h"
+
+typedef struct
+{
+    uint32_t next;                      // address of the quad-word collected in RAM
+    uint32_t end;                       // address behind the region
+    uint32_t pending[4];                // bytes of the quad-word at next
+    uint32_t fill;                      // amount of bytes in pending
+} flashWc_t;
+
+extern bool flashWc_open(flashWc_t* wc, void* address, const uint32_t size);
+extern bool flashWc_append(flashWc_t* wc, const void* data, const uint32_t size);
+extern bool flashWc_flush(flashWc_t* wc);
+extern bool flashWc_read(const flashWc_t* wc, const void* address, void* buffer, const uint32_t size);
+extern uint32_t flashWc_tail(const flashWc_t* wc);
+
+#endif // FLASH_WC_H
@@ -0,0 +1,264 @@
+#include <string.h>
+#include "hc_bd.h"
+#include "flash_ecc.h"
+
+#define RETURN_TRUE_IF_TRUE(cond) if(cond) {return true;}
+
+/**
+ * @brief get the address of an offset in a block
+ */
+static uint32_t hcBd_address(const hcBd_t* bd, const uint32_t block, const uint32_t offset)
+{
+    uint32_t sector = bd->blockFirst + block;
+    return FLASH_GEOM_HC_SECTOR_ADDRESS(1 + sector / FLASH_GEOM_HC_SECTORS_PER_BANK,
+                                        HIGH_CYCLIC_PAGE_OFFSET + sector % FLASH_GEOM_HC_SECTORS_PER_BANK) + offset;
+}
+
+/**
+ * @brief check that a range lies inside one block of the device
+ */
+static bool hcBd_isInside(const hcBd_t* bd, const uint32_t block, const uint32_t offset, const uint32_t size)
+{
+    return block < bd->blockCount && offset <= HCBD_BLOCK_SIZE && size <= HCBD_BLOCK_SIZE - offset;
+}
+
+/**
+ * @brief program the collected range and empty the program cache
+ *
+ * A refused program leaves the cells erased, the range stays in the program cache.
+ *
+ * @return false    OK
+ * @return true     Error: programming failed or was refused
+ */
+static bool hcBd_flush(hcBd_t* bd)
+{
+    if (bd->progBlock == HCBD_NONE)
+    {
+        return false;
+    }
+
+    // a read cache line overlapping the range holds the erased state
+    if (bd->readBlock == bd->progBlock && bd->readOffset < bd->progOffset + bd->progSize &&
+        bd->progOffset < bd->readOffset + HCBD_READ_CACHE_SIZE)
+    {
+        bd->readBlock = HCBD_NONE;
+    }
+
+    // the cells are consumed even if programming fails, they cannot be programmed again
+    bool error = flash_write((void*) hcBd_address(bd, bd->progBlock, bd->progOffset), bd->progCache, bd->progSize);
+    if (!error || !flash_refused())
+    {
+        bd->progBlock = HCBD_NONE;
+    }
+    return error;
+}
+
+/**
+ * @brief fill the read cache with the line holding an offset
+ *
+ * Virgin cells would raise an ECC fault when read, they are probed and filled with 0xFFFF.
+ * Corrupt cells, e.g. torn by a power loss, are read raw; one that reads as erased is filled with
+ * 0x0000, so a filesystem never takes it for an erased cell it may program.
+ *
+ * @return false    OK
+ * @return true     Error: the line could not be probed
+ */
+static bool hcBd_fill(hcBd_t* bd, const uint32_t block, const uint32_t offset)
+{
+    uint32_t lineOffset = offset - offset % HCBD_READ_CACHE_SIZE;
+    const uint16_t* line = (const uint16_t*) hcBd_address(bd, block, lineOffset);
+    uint8_t states[HCBD_READ_CACHE_SIZE / 2];
+    flash_probeResult_t probe;
+
+    bd->readBlock = HCBD_NONE;
+    RETURN_TRUE_IF_TRUE(highCyclic_probe(line, HCBD_READ_CACHE_SIZE, states, &probe))
+
+    for (uint32_t i = 0; i < HCBD_READ_CACHE_SIZE / 2; i++)
+    {
+        bd->readCache[i] = (states[i] == FLASH_CELL_VALID) ? line[i] : 0xFFFF;
+        if (states[i] == FLASH_CELL_CORRUPT)
+        {
+            (void) flashEcc_read16(&line[i], &bd->readCache[i]);
+            bd->readCache[i] = (bd->readCache[i] == 0xFFFF) ? 0x0000 : bd->readCache[i];
+        }
+    }
+    bd->readBlock = block;
+    bd->readOffset = lineOffset;
+    return false;
+}
+
+/**
+ * @brief open the device over consecutive high cyclic sectors
+ *
+ * @param bd the device
+ * @param blockFirst first sector, counted over both banks: 0 is bank 1 sector 120, 8 is bank 2 sector 120
+ * @param blockCount amount of sectors, HCBD_BLOCK_COUNT_MAX for the whole high cyclic memory
+ * @return false    OK
+ * @return true     Error: sectors invalid or not configured as high cyclic memory
+ */
+bool hcBd_open(hcBd_t* bd, const uint8_t blockFirst, const uint8_t blockCount)
+{
+    RETURN_TRUE_IF_TRUE(blockCount == 0 || blockFirst + blockCount > HCBD_BLOCK_COUNT_MAX)
+
+    // check the part in every bank
+    for (uint32_t bank = 1; bank <= 2; bank++)
+    {
+        uint32_t first = (bank - 1) * FLASH_GEOM_HC_SECTORS_PER_BANK;
+        uint32_t last = first + FLASH_GEOM_HC_SECTORS_PER_BANK - 1;
+        if (blockFirst > last || blockFirst + blockCount - 1U < first)
+        {
+            continue;
+        }
+        uint32_t from = (blockFirst > first) ? blockFirst : first;
+        uint32_t to = (blockFirst + blockCount - 1U < last) ? blockFirst + blockCount - 1U : last;
+        RETURN_TRUE_IF_TRUE(flash_checkRegion(bank, true, HIGH_CYCLIC_PAGE_OFFSET + from - first,
+                                              HIGH_CYCLIC_PAGE_OFFSET + to - first))
+    }
+
+    bd->blockFirst = blockFirst;
+    bd->blockCount = blockCount;
+    bd->readBlock = HCBD_NONE;
+    bd->progBlock = HCBD_NONE;
+    return false;
+}
+
+/**
+ * @brief read bytes of a block, including bytes still in the program cache
+ *
+ * @param bd an open device
+ * @param block block relative to the first one of the device
+ * @param offset offset in the block
+ * @param buffer receives the bytes, erased cells read as 0xFF, corrupt ones never do
+ * @param size amount of bytes
+ * @return false    OK
+ * @return true     Error: range invalid
+ */
+bool hcBd_read(hcBd_t* bd, const uint32_t block, const uint32_t offset, void* buffer, const uint32_t size)
+{
+    RETURN_TRUE_IF_TRUE(!hcBd_isInside(bd, block, offset, size))
+
+    uint8_t* bytes = (uint8_t*) buffer;
+    uint32_t position = offset;
+    uint32_t end = offset + size;
+    while (position < end)
+    {
+        uint32_t progEnd = bd->progOffset + bd->progSize;
+        bool progHere = bd->progBlock == block;
+        uint32_t step;
+
+        if (progHere && position >= bd->progOffset && position < progEnd)
+        {
+            step = ((end < progEnd) ? end : progEnd) - position;
+            memcpy(bytes, (const uint8_t*) bd->progCache + position - bd->progOffset, step);
+        }
+        else
+        {
+            if (bd->readBlock != block || position < bd->readOffset || position >= bd->readOffset + (uint32_t) HCBD_READ_CACHE_SIZE)
+            {
+                RETURN_TRUE_IF_TRUE(hcBd_fill(bd, block, position))
+            }
+
+            // up to the end of the line, the program cache overrides the bytes behind its start
+            uint32_t stop = bd->readOffset + HCBD_READ_CACHE_SIZE;
+            stop = (end < stop) ? end : stop;
+            if (progHere && bd->progOffset > position && bd->progOffset < stop)
+            {
+                stop = bd->progOffset;
+            }
+            step = stop - position;
+            memcpy(bytes, (const uint8_t*) bd->readCache + position - bd->readOffset, step);
+        }
+        bytes += step;
+        position += step;
+    }
+    return false;
+}
+
+/**
+ * @brief program bytes of an erased part of a block
+ *
+ * The bytes collect in the program cache as long as every program continues the previous one.
+ * If programming the cache is refused, the bytes taken so far stay in the program cache and
+ * hcBd_sync() programs them once the flash is free.
+ *
+ * @param bd an open device
+ * @param block block relative to the first one of the device
+ * @param offset offset in the block, half-word aligned
+ * @param data the bytes
+ * @param size amount of bytes, multiple of 2
+ * @return false    OK
+ * @return true     Error: range invalid or not aligned, programming of the cache failed or was refused
+ */
+bool hcBd_prog(hcBd_t* bd, const uint32_t block, const uint32_t offset, const void* data, const uint32_t size)
+{
+    RETURN_TRUE_IF_TRUE(!hcBd_isInside(bd, block, offset, size))
+    RETURN_TRUE_IF_TRUE(((offset | size) & (HCBD_PROG_SIZE - 1)) != 0)
+
+    const uint8_t* bytes = (const uint8_t*) data;
+    uint32_t position = offset;
+    uint32_t remaining = size;
+    while (remaining > 0)
+    {
+        if (bd->progBlock != HCBD_NONE && (bd->progBlock != block || bd->progOffset + bd->progSize != position))
+        {
+            RETURN_TRUE_IF_TRUE(hcBd_flush(bd))
+        }
+        if (bd->progBlock == HCBD_NONE)
+        {
+            bd->progBlock = block;
+            bd->progOffset = position;
+            bd->progSize = 0;
+        }
+
+        uint32_t step = HCBD_PROG_CACHE_SIZE - bd->progSize;
+        step = (remaining < step) ? remaining : step;
+        memcpy((uint8_t*) bd->progCache + bd->progSize, bytes, step);
+        bd->progSize += step;
+        bytes += step;
+        position += step;
+        remaining -= step;
+
+        if (bd->progSize == HCBD_PROG_CACHE_SIZE)
+        {
+            RETURN_TRUE_IF_TRUE(hcBd_flush(bd))
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief erase a block, data of the block still in the program cache is dropped
+ *
+ * @param bd an open device
+ * @param block block relative to the first one of the device
+ * @return false    OK
+ * @return true     Error
+ */
+bool hcBd_erase(hcBd_t* bd, const uint32_t block)
+{
+    RETURN_TRUE_IF_TRUE(block >= bd->blockCount)
+
+    if (bd->progBlock == block)
+    {
+        bd->progBlock = HCBD_NONE;
+    }
+    if (bd->readBlock == block)
+    {
+        bd->readBlock = HCBD_NONE;
+    }
+
+    uint32_t sector = bd->blockFirst + block;
+    return flash_erase(1 + sector / FLASH_GEOM_HC_SECTORS_PER_BANK,
+                       HIGH_CYCLIC_PAGE_OFFSET + sector % FLASH_GEOM_HC_SECTORS_PER_BANK);
+}
+
+/**
+ * @brief program the data still in the program cache
+ *
+ * @return false    OK
+ * @return true     Error: programming failed, or it was refused and the data stays in the cache
+ */
+bool hcBd_sync(hcBd_t* bd)
+{
+    return hcBd_flush(bd);
+}
@@ -0,0 +1,65 @@
+#ifndef HC_BD_H
+#define HC_BD_H
+/**
+ * @file hc_bd.h
+ * @brief block device over the high cyclic sectors of both banks, for littlefs-style filesystems
+ *
+ * Block n is high cyclic sector 120 + n % 8 of bank 1 + n / 8, so the 16 blocks of both banks
+ * are contiguous in memory. The geometry reported to a filesystem is the true one: erase blocks
+ * of HIGH_CYCLIC_SECTOR_SIZE bytes, reads and programs of half-words.
+ *
+ * Reads go through a read cache filled by probing, virgin cells read as 0xFF instead of raising
+ * an ECC fault. Programs collect in a program cache and are programmed as one range when the next
+ * program does not continue it, when it is full and by hcBd_sync(). Reads see the data still in
+ * the program cache.
+ *
+ * static int lfsProg(const struct lfs_config* c, lfs_block_t block, lfs_off_t off,
+ *                    const void* buffer, lfs_size_t size)
+ * {
+ *     return hcBd_prog(c->context, block, off, buffer, size) ? LFS_ERR_IO : 0;
+ * }
+ *
+ * .read_size = HCBD_READ_SIZE, .prog_size = HCBD_PROG_SIZE,
+ * .block_size = HCBD_BLOCK_SIZE, .block_count = bd.blockCount
+ */
+#include "flash.h"
+
+#define HCBD_READ_SIZE          2
+#define HCBD_PROG_SIZE          2
+#define HCBD_BLOCK_SIZE         HIGH_CYCLIC_SECTOR_SIZE
+#define HCBD_BLOCK_COUNT_MAX    (2 * FLASH_GEOM_HC_SECTORS_PER_BANK)
+#define HCBD_NONE               0xFFFF
+
+// bytes of the read cache, a line is aligned to its size; probing a line takes a byte per half-word on the stack
+#ifndef HCBD_READ_CACHE_SIZE
+#define HCBD_READ_CACHE_SIZE    128
+#endif
+
+// bytes of the program cache, a littlefs metadata commit usually fits
+#ifndef HCBD_PROG_CACHE_SIZE
+#define HCBD_PROG_CACHE_SIZE    64
+#endif
+
+_Static_assert(HCBD_BLOCK_SIZE % HCBD_READ_CACHE_SIZE == 0, "read cache lines have to tile a block");
+_Static_assert(HCBD_PROG_CACHE_SIZE % 2 == 0, "program cache holds whole half-words");
+
+typedef struct
+{
+    uint8_t blockFirst;                 // first block, high cyclic sectors of both banks counted from bank 1 sector 120
+    uint8_t blockCount;                 // amount of blocks
+    uint16_t readBlock;                 // block of the read cache line, HCBD_NONE if empty
+    uint16_t readOffset;                // offset of the read cache line in its block
+    uint16_t progBlock;                 // block of the program cache, HCBD_NONE if empty
+    uint16_t progOffset;                // offset of the first byte in the program cache
+    uint16_t progSize;                  // amount of bytes in the program cache
+    uint16_t readCache[HCBD_READ_CACHE_SIZE / 2];
+    uint16_t progCache[HCBD_PROG_CACHE_SIZE / 2];
+} hcBd_t;
+
+extern bool hcBd_open(hcBd_t* bd, const uint8_t blockFirst, const uint8_t blockCount);
+extern bool hcBd_read(hcBd_t* bd, const uint32_t block, const uint32_t offset, void* buffer, const uint32_t size);
+extern bool hcBd_prog(hcBd_t* bd, const uint32_t block, const uint32_t offset, const void* data, const uint32_t size);
+extern bool hcBd_erase(hcBd_t* bd, const uint32_t block);
+extern bool hcBd_sync(hcBd_t* bd);
+
+#endif // HC_BD_H
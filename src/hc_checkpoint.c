@@ -0,0 +1,166 @@
+#include <stddef.h>
+#include <string.h>
+#include "hc_checkpoint.h"
+#include "flash_crc.h"
+
+#define RETURN_TRUE_IF_TRUE(cond) if(cond) {return true;}
+
+/**
+ * @brief get the key of a copy of a block
+ */
+static uint16_t blockKey(const uint32_t block, const uint32_t copy)
+{
+    return (uint16_t) (1U + 2U * block + copy);
+}
+
+/**
+ * @brief get the amount of bytes of a block, the last one may be shorter
+ */
+static uint16_t blockLength(const hcCheckpoint_t* checkpoint, const uint32_t block)
+{
+    uint32_t remaining = checkpoint->size - block * HCCHECKPOINT_BLOCK_SIZE;
+    return (uint16_t) ((remaining < HCCHECKPOINT_BLOCK_SIZE) ? remaining : HCCHECKPOINT_BLOCK_SIZE);
+}
+
+/**
+ * @brief get the amount of bytes of the manifest, it lists the hashes of the region's blocks only
+ */
+static uint16_t manifestLength(const hcCheckpoint_t* checkpoint)
+{
+    return (uint16_t) (offsetof(hcCheckpoint_manifest_t, hashes) + checkpoint->blocks * sizeof(uint32_t));
+}
+
+/**
+ * @brief get the copy of a block listed in the manifest
+ */
+static uint32_t manifestCopy(const hcCheckpoint_t* checkpoint, const uint32_t block)
+{
+    return (checkpoint->manifest.copies >> block) & 1U;
+}
+
+/**
+ * @brief open the checkpoint of a RAM region and load its newest manifest
+ *
+ * @param checkpoint the checkpoint
+ * @param store a mounted store used by the checkpoint only
+ * @param region the RAM to checkpoint
+ * @param size bytes of the region, up to HCCHECKPOINT_MAX_BLOCKS blocks
+ * @return false    OK, also if there is no checkpoint of the region yet
+ * @return true     Error: invalid size
+ */
+bool hcCheckpoint_open(hcCheckpoint_t* checkpoint, hcStore_t* store, void* region, const uint16_t size)
+{
+    uint32_t blocks = (size + HCCHECKPOINT_BLOCK_SIZE - 1U) / HCCHECKPOINT_BLOCK_SIZE;
+    RETURN_TRUE_IF_TRUE(size == 0 || blocks > HCCHECKPOINT_MAX_BLOCKS)
+
+    checkpoint->store = store;
+    checkpoint->region = (uint8_t*) region;
+    checkpoint->size = size;
+    checkpoint->blocks = (uint16_t) blocks;
+    checkpoint->pending = false;
+
+    // a manifest of a region with another layout is replaced by the first checkpoint
+    uint16_t length;
+    const hcCheckpoint_manifest_t* manifest = hcStore_find(store, HCCHECKPOINT_KEY_MANIFEST, &length);
+    checkpoint->complete = manifest != NULL && length == manifestLength(checkpoint) &&
+                           manifest->size == size && manifest->blockSize == HCCHECKPOINT_BLOCK_SIZE;
+    if (checkpoint->complete)
+    {
+        memcpy(&checkpoint->manifest, manifest, length);
+    }
+    else
+    {
+        memset(&checkpoint->manifest, 0, sizeof(checkpoint->manifest));
+        checkpoint->manifest.size = size;
+        checkpoint->manifest.blockSize = HCCHECKPOINT_BLOCK_SIZE;
+    }
+    checkpoint->committed = checkpoint->manifest.copies;
+    return false;
+}
+
+/**
+ * @brief copy the newest checkpoint back into the region
+ *
+ * Every block is checked against the hash in the manifest before the first one is copied, so the
+ * region is either restored completely or left unchanged.
+ *
+ * @param checkpoint an open checkpoint
+ * @return false    OK
+ * @return true     Error: no checkpoint or a block failed its hash, the next checkpoint writes all blocks
+ */
+bool hcCheckpoint_restore(hcCheckpoint_t* checkpoint)
+{
+    RETURN_TRUE_IF_TRUE(!checkpoint->complete)
+
+    for (uint32_t block = 0; block < checkpoint->blocks; block++)
+    {
+        uint16_t length;
+        const void* data = hcStore_find(checkpoint->store, blockKey(block, manifestCopy(checkpoint, block)), &length);
+        if (data == NULL || length != blockLength(checkpoint, block) ||
+            flashCrc_crc32(FLASH_CRC32_INIT, data, length) != checkpoint->manifest.hashes[block])
+        {
+            checkpoint->complete = false;
+            return true;
+        }
+    }
+
+    for (uint32_t block = 0; block < checkpoint->blocks; block++)
+    {
+        RETURN_TRUE_IF_TRUE(hcStore_read(checkpoint->store, blockKey(block, manifestCopy(checkpoint, block)),
+                                         checkpoint->region + block * HCCHECKPOINT_BLOCK_SIZE,
+                                         blockLength(checkpoint, block)))
+    }
+    return false;
+}
+
+/**
+ * @brief write the blocks changed since the previous checkpoint and commit them by a new manifest
+ *
+ * Nothing is written if no block changed. A failed checkpoint leaves the previous one in place,
+ * the next one writes the blocks that are still missing.
+ *
+ * @param checkpoint an open checkpoint
+ * @param written receives the amount of blocks written, may be NULL
+ * @return false    OK
+ * @return true     Error: writing a block or the manifest failed
+ */
+bool hcCheckpoint_save(hcCheckpoint_t* checkpoint, uint32_t* written)
+{
+    uint32_t count = 0;
+    for (uint32_t block = 0; block < checkpoint->blocks; block++)
+    {
+        const uint8_t* data = checkpoint->region + block * HCCHECKPOINT_BLOCK_SIZE;
+        uint16_t length = blockLength(checkpoint, block);
+        uint32_t hash = flashCrc_crc32(FLASH_CRC32_INIT, data, length);
+        if (checkpoint->complete && hash == checkpoint->manifest.hashes[block])
+        {
+            continue;
+        }
+
+        // the copy the committed manifest does not list
+        uint32_t copy = ((checkpoint->committed >> block) & 1U) ^ 1U;
+        RETURN_TRUE_IF_TRUE(hcStore_write(checkpoint->store, blockKey(block, copy), data, length))
+        checkpoint->manifest.hashes[block] = hash;
+        checkpoint->manifest.copies = (checkpoint->manifest.copies & ~(1UL << block)) | (copy << block);
+        checkpoint->pending = true;
+        count++;
+    }
+    checkpoint->complete = true;
+
+    if (checkpoint->pending)
+    {
+        checkpoint->manifest.sequence++;
+        if (hcStore_write(checkpoint->store, HCCHECKPOINT_KEY_MANIFEST, &checkpoint->manifest, manifestLength(checkpoint)))
+        {
+            checkpoint->manifest.sequence--;
+            return true;
+        }
+        checkpoint->committed = checkpoint->manifest.copies;
+        checkpoint->pending = false;
+    }
+    if (written != NULL)
+    {
+        *written = count;
+    }
+    return false;
+}
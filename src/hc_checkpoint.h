@@ -0,0 +1,66 @@
+#ifndef HC_CHECKPOINT_H
+#define HC_CHECKPOINT_H
+/**
+ * @file hc_checkpoint.h
+ * @brief incremental checkpoints of a RAM region into a record store, restored after a reset
+ *
+ * The region is split into blocks of HCCHECKPOINT_BLOCK_SIZE bytes. A checkpoint hashes every
+ * block with CRC-32 and writes only the blocks whose hash changed since the previous checkpoint,
+ * then commits them by a manifest record listing the hash of every block and which copy holds it:
+ *
+ * key 0:           manifest (sequence, region size, block size, copy bits, hashes)
+ * key 1 + 2n + c:  copy c of block n
+ *
+ * Every block has two copies. A changed block goes into the copy the committed manifest does not
+ * reference, so until the new manifest is in place the previous checkpoint stays complete. The
+ * manifest is one record, a power loss leaves the old or the new one.
+ *
+ * Programming scales with the changed blocks, hashing with the region at the speed of the CRC
+ * unit. The store is used by the checkpoint alone; both copies of every block stay current records,
+ * so it needs room for twice the region plus the space its garbage collection works in.
+ *
+ * hcStore_mount(&stateStore, 2, 120, 8);
+ * hcCheckpoint_open(&checkpoint, &stateStore, &state, sizeof(state));
+ * hcCheckpoint_restore(&checkpoint);
+ * ...
+ * hcCheckpoint_save(&checkpoint, NULL);
+ */
+#include "hc_store.h"
+
+// bytes per block
+#ifndef HCCHECKPOINT_BLOCK_SIZE
+#define HCCHECKPOINT_BLOCK_SIZE     128
+#endif
+
+// blocks per region, limited by the keys of the store
+#define HCCHECKPOINT_MAX_BLOCKS     ((HCSTORE_MAX_KEYS - 1) / 2)
+#define HCCHECKPOINT_KEY_MANIFEST   0
+
+_Static_assert(HCCHECKPOINT_MAX_BLOCKS <= 32, "copy bits of the manifest hold 32 blocks");
+
+typedef struct
+{
+    uint32_t sequence;                  // checkpoints committed so far
+    uint16_t size;                      // bytes of the region
+    uint16_t blockSize;                 // HCCHECKPOINT_BLOCK_SIZE
+    uint32_t copies;                    // copy holding each block, one bit per block
+    uint32_t hashes[HCCHECKPOINT_MAX_BLOCKS];   // CRC-32 of each block
+} hcCheckpoint_manifest_t;
+
+typedef struct
+{
+    hcStore_t* store;                   // store of the checkpoint
+    uint8_t* region;                    // checkpointed RAM
+    uint16_t size;                      // bytes of the region
+    uint16_t blocks;                    // amount of blocks
+    uint32_t committed;                 // copy bits of the manifest in flash
+    bool pending;                       // blocks were written that no manifest in flash lists yet
+    bool complete;                      // every block is in flash, else the next checkpoint writes all
+    hcCheckpoint_manifest_t manifest;   // next manifest, hashes of the blocks in flash
+} hcCheckpoint_t;
+
+extern bool hcCheckpoint_open(hcCheckpoint_t* checkpoint, hcStore_t* store, void* region, const uint16_t size);
+extern bool hcCheckpoint_restore(hcCheckpoint_t* checkpoint);
+extern bool hcCheckpoint_save(hcCheckpoint_t* checkpoint, uint32_t* written);
+
+#endif // HC_CHECKPOINT_H
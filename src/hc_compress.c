@@ -0,0 +1,253 @@
+#include <string.h>
+#include "hc_compress.h"
+
+#define RETURN_TRUE_IF_TRUE(cond) if(cond) {return true;}
+
+// core cycle counter, the host build has none
+#ifndef FLASH_EMULATION
+#define CYCLES()    (DWT->CYCCNT)
+#else
+#define CYCLES()    0U
+#endif
+
+/**
+ * @brief hash the next HCCOMPRESS_MIN_MATCH bytes
+ */
+static uint32_t hash(const uint8_t* data)
+{
+    uint32_t prefix = ((uint32_t) data[0] << 16) | ((uint32_t) data[1] << 8) | data[2];
+    return ((prefix * 2654435761UL) >> 16) & (HCCOMPRESS_HASH_SIZE - 1U);
+}
+
+/**
+ * @brief LZSS code a payload into the output buffer behind its length field
+ *
+ * @param compress the compressor
+ * @param data the payload
+ * @param length bytes of the payload, up to HCCOMPRESS_MAX_LENGTH
+ * @return bytes of the coded data, 0 if they are not fewer than those of the payload
+ */
+static uint32_t encode(hcCompress_t* compress, const uint8_t* data, const uint32_t length)
+{
+    uint8_t* output = compress->output + 2;
+    for (uint32_t i = 0; i < HCCOMPRESS_HASH_SIZE; i++)
+    {
+        compress->hashes[i] = -1;
+    }
+
+    uint32_t size = 0;
+    uint32_t control = 0;
+    uint32_t items = 8;
+    uint32_t position = 0;
+    while (position < length)
+    {
+        if (items == 8)
+        {
+            control = size++;
+            output[control] = 0;
+            items = 0;
+        }
+
+        // longest match at the last position with the same hash
+        uint32_t match = 0;
+        uint32_t distance = 0;
+        if (position + HCCOMPRESS_MIN_MATCH <= length)
+        {
+            uint32_t h = hash(data + position);
+            int32_t candidate = compress->hashes[h];
+            compress->hashes[h] = (int16_t) position;
+            if (candidate >= 0)
+            {
+                uint32_t max = length - position;
+                max = (max < HCCOMPRESS_MAX_MATCH) ? max : HCCOMPRESS_MAX_MATCH;
+                while (match < max && data[candidate + match] == data[position + match])
+                {
+                    match++;
+                }
+                distance = position - (uint32_t) candidate;
+            }
+        }
+
+        if (match >= HCCOMPRESS_MIN_MATCH)
+        {
+            if (size + 2 >= length)
+            {
+                return 0;
+            }
+            output[size++] = (uint8_t) (distance - 1U);
+            output[size++] = (uint8_t) ((((distance - 1U) >> 8) << 6) | (match - HCCOMPRESS_MIN_MATCH));
+            output[control] |= (uint8_t) (1U << items);
+
+            // the skipped positions are found by later matches as well
+            for (uint32_t i = position + 1; i < position + match && i + HCCOMPRESS_MIN_MATCH <= length; i++)
+            {
+                compress->hashes[hash(data + i)] = (int16_t) i;
+            }
+            position += match;
+        }
+        else
+        {
+            output[size++] = data[position++];
+        }
+        items++;
+
+        if (size >= length)
+        {
+            return 0;
+        }
+    }
+    return size;
+}
+
+/**
+ * @brief decode LZSS coded data, matches are copied from the output decoded so far
+ *
+ * @param data the coded data
+ * @param size bytes of the coded data
+ * @param buffer receives the payload
+ * @param length bytes of the payload
+ * @return false    OK
+ * @return true     Error: the data does not decode to exactly length bytes
+ */
+static bool decode(const uint8_t* data, const uint32_t size, uint8_t* buffer, const uint32_t length)
+{
+    uint32_t position = 0;
+    uint32_t produced = 0;
+    uint32_t control = 0;
+    uint32_t items = 8;
+    while (produced < length)
+    {
+        if (items == 8)
+        {
+            RETURN_TRUE_IF_TRUE(position >= size)
+            control = data[position++];
+            items = 0;
+        }
+
+        if (control & 1U)
+        {
+            RETURN_TRUE_IF_TRUE(position + 2 > size)
+            uint32_t distance = (data[position] | ((uint32_t) (data[position + 1] >> 6) << 8)) + 1U;
+            uint32_t match = (data[position + 1] & 0x3FU) + HCCOMPRESS_MIN_MATCH;
+            position += 2;
+            RETURN_TRUE_IF_TRUE(distance > produced || match > length - produced)
+
+            // byte by byte, a match may overlap the bytes it produces
+            for (uint32_t i = 0; i < match; i++)
+            {
+                buffer[produced] = buffer[produced - distance];
+                produced++;
+            }
+        }
+        else
+        {
+            RETURN_TRUE_IF_TRUE(position >= size)
+            buffer[produced++] = data[position++];
+        }
+        control >>= 1;
+        items++;
+    }
+    return position != size;
+}
+
+/**
+ * @brief initialize a compressor, clear its statistics and start the cycle counter
+ *
+ * @param compress the compressor
+ */
+void hcCompress_init(hcCompress_t* compress)
+{
+    memset(&compress->stats, 0, sizeof(compress->stats));
+#ifndef FLASH_EMULATION
+    DCB->DEMCR |= DCB_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+/**
+ * @brief compress a payload and write it as the record of a key
+ *
+ * @param compress the compressor
+ * @param store a mounted store
+ * @param key the key
+ * @param data the payload
+ * @param length bytes of the payload, up to HCCOMPRESS_MAX_LENGTH
+ * @return false    OK
+ * @return true     Error: payload too long or writing the record failed
+ */
+bool hcCompress_write(hcCompress_t* compress, hcStore_t* store, const uint16_t key, const void* data, const uint16_t length)
+{
+    RETURN_TRUE_IF_TRUE(length > HCCOMPRESS_MAX_LENGTH)
+
+    uint32_t start = CYCLES();
+    uint16_t header = length;
+    uint32_t size = encode(compress, (const uint8_t*) data, length);
+    if (size == 0)
+    {
+        memcpy(compress->output + 2, data, length);
+        size = length;
+        header |= HCCOMPRESS_STORED;
+    }
+    memcpy(compress->output, &header, sizeof(header));
+    compress->stats.compressCycles += CYCLES() - start;
+
+    RETURN_TRUE_IF_TRUE(hcStore_write(store, key, compress->output, (uint16_t) (2 + size)))
+    compress->stats.records++;
+    compress->stats.rawBytes += length;
+    compress->stats.storedBytes += 2 + size;
+    return false;
+}
+
+/**
+ * @brief read the payload of a key, decoded straight from the record in flash
+ *
+ * @param compress the compressor, counts the cycles
+ * @param store a mounted store
+ * @param key the key
+ * @param buffer receives the payload
+ * @param size bytes of the buffer
+ * @param length receives the bytes of the payload
+ * @return false    OK
+ * @return true     Error: no record, payload larger than the buffer or not decodable
+ */
+bool hcCompress_read(hcCompress_t* compress, const hcStore_t* store, const uint16_t key, void* buffer,
+                     const uint16_t size, uint16_t* length)
+{
+    uint16_t recordLength;
+    const uint8_t* record = hcStore_find(store, key, &recordLength);
+    RETURN_TRUE_IF_TRUE(record == NULL || recordLength < 2)
+
+    uint16_t header;
+    memcpy(&header, record, sizeof(header));
+    uint16_t raw = header & (uint16_t) ~HCCOMPRESS_STORED;
+    RETURN_TRUE_IF_TRUE(raw > size)
+
+    uint32_t start = CYCLES();
+    if (header & HCCOMPRESS_STORED)
+    {
+        RETURN_TRUE_IF_TRUE(recordLength - 2U != raw)
+        memcpy(buffer, record + 2, raw);
+    }
+    else
+    {
+        RETURN_TRUE_IF_TRUE(decode(record + 2, recordLength - 2U, (uint8_t*) buffer, raw))
+    }
+    compress->stats.decompressCycles += CYCLES() - start;
+    *length = raw;
+    return false;
+}
+
+/**
+ * @brief get the compression ratio of the records written so far
+ *
+ * @param compress the compressor
+ * @return bytes written to the store per 1000 bytes of payload, 1000 before the first record
+ */
+uint32_t hcCompress_getPermille(const hcCompress_t* compress)
+{
+    if (compress->stats.rawBytes == 0)
+    {
+        return 1000;
+    }
+    return (uint32_t) ((uint64_t) compress->stats.storedBytes * 1000U / compress->stats.rawBytes);
+}
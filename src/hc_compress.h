@@ -0,0 +1,72 @@
+#ifndef HC_COMPRESS_H
+#define HC_COMPRESS_H
+/**
+ * @file hc_compress.h
+ * @brief LZ compression of record payloads in front of a record store
+ *
+ * hcCompress_write() compresses a payload into a RAM buffer and writes that as the record, so
+ * fewer half-words are programmed and more records fit into a sector before it is erased.
+ * hcCompress_read() decodes straight from the record in the memory mapped flash.
+ *
+ * payload: raw length (bit 15 set if stored uncompressed), data
+ *
+ * The data is LZSS coded. A control byte announces the next eight items, least significant bit
+ * first: 0 for a literal byte, 1 for a match of two bytes, a 10 bit distance and a 6 bit length:
+ *
+ * match:   (distance - 1) bits 0 .. 7, (distance - 1) bits 8 .. 9 << 6 | (length - 3)
+ *
+ * Matches refer back into the payload itself, so the window is the record and decoding needs no
+ * RAM besides the output buffer. A hash table of HCCOMPRESS_HASH_SIZE entries finds them. A
+ * payload that does not shrink is stored as it is.
+ *
+ * The statistics of a compressor hold the bytes before and after compression and the core cycles
+ * spent, counted by DWT->CYCCNT. The host build has no cycle counter, its cycles stay 0.
+ *
+ * hcCompress_init(&compress);
+ * hcCompress_write(&compress, &store, KEY_LOG, log, sizeof(log));
+ * hcCompress_read(&compress, &store, KEY_LOG, log, sizeof(log), &length);
+ * hcCompress_getPermille(&compress);   // bytes stored per 1000 bytes written
+ */
+#include "hc_store.h"
+
+// largest payload, matches reach back up to 1024 bytes
+#ifndef HCCOMPRESS_MAX_LENGTH
+#define HCCOMPRESS_MAX_LENGTH   512
+#endif
+
+// entries of the hash table of the compressor
+#ifndef HCCOMPRESS_HASH_SIZE
+#define HCCOMPRESS_HASH_SIZE    256
+#endif
+
+#define HCCOMPRESS_STORED       0x8000
+#define HCCOMPRESS_MIN_MATCH    3
+#define HCCOMPRESS_MAX_MATCH    (HCCOMPRESS_MIN_MATCH + 63)
+#define HCCOMPRESS_MAX_DISTANCE 1024
+
+_Static_assert(HCCOMPRESS_MAX_LENGTH <= HCCOMPRESS_MAX_DISTANCE, "matches have to reach the start of the payload");
+_Static_assert((HCCOMPRESS_HASH_SIZE & (HCCOMPRESS_HASH_SIZE - 1)) == 0, "hash table size has to be a power of 2");
+
+typedef struct
+{
+    uint32_t records;                   // records written
+    uint32_t rawBytes;                  // payload bytes given to hcCompress_write()
+    uint32_t storedBytes;               // payload bytes written to the store, length field included
+    uint32_t compressCycles;            // core cycles spent compressing
+    uint32_t decompressCycles;          // core cycles spent decoding
+} hcCompress_stats_t;
+
+typedef struct
+{
+    int16_t hashes[HCCOMPRESS_HASH_SIZE];           // last position of every hash, -1 if none
+    uint8_t output[2 + HCCOMPRESS_MAX_LENGTH];      // payload of the record to write
+    hcCompress_stats_t stats;
+} hcCompress_t;
+
+extern void hcCompress_init(hcCompress_t* compress);
+extern bool hcCompress_write(hcCompress_t* compress, hcStore_t* store, const uint16_t key, const void* data, const uint16_t length);
+extern bool hcCompress_read(hcCompress_t* compress, const hcStore_t* store, const uint16_t key, void* buffer,
+                            const uint16_t size, uint16_t* length);
+extern uint32_t hcCompress_getPermille(const hcCompress_t* compress);
+
+#endif // HC_COMPRESS_H
@@ -0,0 +1,215 @@
+#include <stddef.h>
+#include "hc_counter.h"
+#include "flash_crc.h"
+
+#define RETURN_TRUE_IF_TRUE(cond) if(cond) {return true;}
+
+/**
+ * @brief get the header of a sector of the ring
+ */
+static const hcCounter_sectorHeader_t* sectorHeader(const hcCounter_t* counter, const uint32_t sector)
+{
+    return (const hcCounter_sectorHeader_t*) FLASH_GEOM_HC_SECTOR_ADDRESS(counter->bank, counter->sectorFirst + sector);
+}
+
+/**
+ * @brief get the address of an increment
+ */
+static const uint16_t* incrementAddress(const hcCounter_t* counter, const uint32_t sector, const uint32_t index)
+{
+    return (const uint16_t*) (sectorHeader(counter, sector) + 1) + index;
+}
+
+/**
+ * @brief get the CRC of a sector header
+ */
+static uint16_t headerCrc(const hcCounter_sectorHeader_t* header)
+{
+    return flashCrc_crc16(FLASH_CRC16_INIT, header, offsetof(hcCounter_sectorHeader_t, crc));
+}
+
+/**
+ * @brief check if a sector carries a valid header
+ */
+static bool isFormatted(const hcCounter_t* counter, const uint32_t sector)
+{
+    const hcCounter_sectorHeader_t* header = sectorHeader(counter, sector);
+    flash_probeResult_t probe;
+    return !highCyclic_probe(header, sizeof(hcCounter_sectorHeader_t), NULL, &probe) &&
+           probe.valid == sizeof(hcCounter_sectorHeader_t) / 2 && header->crc == headerCrc(header);
+}
+
+/**
+ * @brief classify one increment without an ECC fault
+ */
+static flash_cell_t incrementState(const hcCounter_t* counter, const uint32_t sector, const uint32_t index)
+{
+    uint8_t state = FLASH_CELL_CORRUPT;
+    (void) highCyclic_probe(incrementAddress(counter, sector, index), 2, &state, NULL);
+    return (flash_cell_t) state;
+}
+
+/**
+ * @brief start the next sector of the ring with the current value as its base
+ *
+ * @return false    OK
+ * @return true     Error
+ */
+static bool startSector(hcCounter_t* counter)
+{
+    uint32_t sector = (counter->active + 1U) % counter->sectorCount;
+    const hcCounter_sectorHeader_t* address = sectorHeader(counter, sector);
+    flash_probeResult_t probe;
+
+    RETURN_TRUE_IF_TRUE(highCyclic_probe(address, HIGH_CYCLIC_SECTOR_SIZE, NULL, &probe))
+    if (probe.erased != HIGH_CYCLIC_SECTOR_SIZE / 2)
+    {
+        RETURN_TRUE_IF_TRUE(flash_erase(counter->bank, counter->sectorFirst + sector))
+    }
+
+    hcCounter_sectorHeader_t header = {
+        .sequence = counter->sequence + 1,
+        .base = (uint32_t) counter->value,
+        .baseHigh = (uint16_t) (counter->value >> 32),
+    };
+    header.crc = headerCrc(&header);
+    RETURN_TRUE_IF_TRUE(flash_write((void*) address, &header, sizeof(header)))
+
+    counter->active = sector;
+    counter->sequence++;
+    counter->next = 0;
+    return false;
+}
+
+/**
+ * @brief open a counter kept in a ring of high cyclic sectors and compute its value
+ *
+ * @param counter the counter to open
+ * @param bank Bank 1 or 2
+ * @param sectorFirst first sector of the ring
+ * @param sectorCount amount of sectors, at least 2
+ * @return false    OK, a counter never written has the value 0
+ * @return true     Error: sectors not usable
+ */
+bool hcCounter_open(hcCounter_t* counter, const uint8_t bank, const uint8_t sectorFirst, const uint8_t sectorCount)
+{
+    RETURN_TRUE_IF_TRUE(sectorCount < 2)
+    RETURN_TRUE_IF_TRUE(flash_checkRegion(bank, true, sectorFirst, sectorFirst + sectorCount - 1))
+
+    counter->bank = bank;
+    counter->sectorFirst = sectorFirst;
+    counter->sectorCount = sectorCount;
+
+    // nothing counted yet: pretend a full last sector, the first increment starts sector 0
+    counter->active = sectorCount - 1;
+    counter->sequence = 0;
+    counter->next = HCCOUNTER_INCREMENTS;
+    counter->value = 0;
+
+    for (uint32_t sector = 0; sector < sectorCount; sector++)
+    {
+        if (isFormatted(counter, sector) && sectorHeader(counter, sector)->sequence > counter->sequence)
+        {
+            counter->active = sector;
+            counter->sequence = sectorHeader(counter, sector)->sequence;
+        }
+    }
+    if (counter->sequence == 0)
+    {
+        return false;
+    }
+
+    // increments are programmed in order, a binary search finds the first erased one; a cell torn
+    // by a power loss may read as erased, the increment programmed behind it reveals it
+    uint32_t low = 0;
+    uint32_t high = HCCOUNTER_INCREMENTS;
+    for (;;)
+    {
+        while (low < high)
+        {
+            uint32_t middle = (low + high) / 2;
+            if (incrementState(counter, counter->active, middle) == FLASH_CELL_ERASED)
+            {
+                high = middle;
+            }
+            else
+            {
+                low = middle + 1;
+            }
+        }
+        if (low + 1 >= HCCOUNTER_INCREMENTS || incrementState(counter, counter->active, low + 1) == FLASH_CELL_ERASED)
+        {
+            break;
+        }
+        low += 2;
+        high = HCCOUNTER_INCREMENTS;
+    }
+    counter->next = (uint16_t) low;
+
+    // an increment torn by a power loss is not counted
+    const hcCounter_sectorHeader_t* header = sectorHeader(counter, counter->active);
+    counter->value = ((uint64_t) header->baseHigh << 32) | header->base;
+    for (uint32_t i = 0; i < counter->next; i++)
+    {
+        if (incrementState(counter, counter->active, i) == FLASH_CELL_VALID)
+        {
+            counter->value += *incrementAddress(counter, counter->active, i);
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief add to a counter, an amount above 65535 takes several increments
+ *
+ * @param counter an open counter
+ * @param amount amount to add
+ * @return false    OK
+ * @return true     Error: value above HCCOUNTER_MAX, programming or erasing failed or was refused,
+ *                  the value holds the increments programmed before
+ */
+bool hcCounter_add(hcCounter_t* counter, const uint32_t amount)
+{
+    RETURN_TRUE_IF_TRUE(amount > HCCOUNTER_MAX - counter->value)
+
+    uint32_t remaining = amount;
+    bool failed = false;
+    while (remaining > 0)
+    {
+        if (counter->next >= HCCOUNTER_INCREMENTS)
+        {
+            RETURN_TRUE_IF_TRUE(startSector(counter))
+        }
+
+        uint16_t increment = (remaining > 0xFFFF) ? 0xFFFF : (uint16_t) remaining;
+        const uint16_t* address = incrementAddress(counter, counter->active, counter->next);
+
+        // a cell touched by a failed program is consumed, it cannot be programmed again; a cell torn by
+        // a power loss may read as erased and fail once. A refused program leaves the cell erased, it
+        // is tried again, an erased cell between increments would end the search of hcCounter_open().
+        // A second failure in a row is an error
+        if (flash_write((void*) address, &increment, sizeof(increment)))
+        {
+            if (incrementState(counter, counter->active, counter->next) != FLASH_CELL_ERASED)
+            {
+                counter->next++;
+            }
+            RETURN_TRUE_IF_TRUE(failed)
+            failed = true;
+            continue;
+        }
+        counter->next++;
+        failed = false;
+        counter->value += increment;
+        remaining -= increment;
+    }
+    return false;
+}
+
+/**
+ * @brief get the value of a counter
+ */
+uint64_t hcCounter_get(const hcCounter_t* counter)
+{
+    return counter->value;
+}
@@ -0,0 +1,53 @@
+#ifndef HC_COUNTER_H
+#define HC_COUNTER_H
+/**
+ * @file hc_counter.h
+ * @brief monotonic counters in high cyclic sectors, one half-word per increment instead of a rewrite
+ *
+ * The value of a counter is the base in the header of its active sector plus the sum of the
+ * increments programmed behind it, one half-word each:
+ *
+ * sector:  header (sequence, base, crc), increments 1 .. 65535
+ *
+ * Increments fill the sector from its start. When it is full, the next sector of the ring gets a
+ * header with the current value as its base and a higher sequence; it is erased first if
+ * necessary. Opening finds the end of the increments by a binary search and sums them once,
+ * afterwards the value is read from RAM.
+ *
+ * A sector holds HCCOUNTER_INCREMENTS increments, so counting in steps of one erases about 326
+ * sectors per million counts; callers counting faster than they need to persist add the counts
+ * of an interval at once. A power loss loses at most the increment being programmed.
+ */
+#include "flash.h"
+
+typedef struct
+{
+    uint32_t sequence;          // order in which the sectors were started, starting at 1
+    uint32_t base;              // counter value at the start of the sector, bits 0 .. 31
+    uint16_t baseHigh;          // bits 32 .. 47 of the base
+    uint16_t crc;               // CRC-16 over the header up to this field
+} hcCounter_sectorHeader_t;
+
+_Static_assert(sizeof(hcCounter_sectorHeader_t) == 12, "counter sector header layout");
+
+// increments per sector
+#define HCCOUNTER_INCREMENTS    ((HIGH_CYCLIC_SECTOR_SIZE - sizeof(hcCounter_sectorHeader_t)) / 2)
+// largest value, the base holds 48 bits
+#define HCCOUNTER_MAX           0xFFFFFFFFFFFFULL
+
+typedef struct
+{
+    uint8_t bank;               // bank of the sectors
+    uint8_t sectorFirst;        // first sector of the ring
+    uint8_t sectorCount;        // amount of sectors
+    uint8_t active;             // sector increments are programmed to, relative to sectorFirst
+    uint32_t sequence;          // sequence of the active sector, 0 if there is none
+    uint16_t next;              // next increment of the active sector, HCCOUNTER_INCREMENTS if full
+    uint64_t value;             // current value
+} hcCounter_t;
+
+extern bool hcCounter_open(hcCounter_t* counter, const uint8_t bank, const uint8_t sectorFirst, const uint8_t sectorCount);
+extern bool hcCounter_add(hcCounter_t* counter, const uint32_t amount);
+extern uint64_t hcCounter_get(const hcCounter_t* counter);
+
+#endif // HC_COUNTER_H
@@ -0,0 +1,180 @@
+#include <string.h>
+#include "hc_mirror.h"
+
+#define RETURN_TRUE_IF_TRUE(cond) if(cond) {return true;}
+
+/**
+ * @brief find the smallest key of either store above a key
+ *
+ * @param after the key to start behind, -1 for the first key
+ * @param key receives the key
+ * @return false if there is none
+ */
+static bool nextKey(const hcMirror_t* mirror, const int32_t after, uint16_t* key)
+{
+    bool found = false;
+    for (uint32_t copy = 0; copy < 2; copy++)
+    {
+        const hcStore_t* store = mirror->copies[copy];
+        for (uint32_t i = 0; i < store->indexEntries; i++)
+        {
+            // entries are sorted by key, the first one behind is the smallest
+            if (store->index[i].key > after)
+            {
+                if (!found || store->index[i].key < *key)
+                {
+                    *key = store->index[i].key;
+                    found = true;
+                }
+                break;
+            }
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief rewrite one copy of a key with a value
+ *
+ * @return false    OK
+ * @return true     Error
+ */
+static bool repair(hcMirror_t* mirror, const uint32_t copy, const uint16_t key, const void* data, const uint16_t length)
+{
+    if (hcStore_write(mirror->copies[copy], key, data, length))
+    {
+        mirror->counters.failures[copy]++;
+        return true;
+    }
+    mirror->counters.repairs++;
+    return false;
+}
+
+/**
+ * @brief combine two mounted stores, one in each bank, to a mirror
+ *
+ * @param mirror the mirror
+ * @param first store in bank 1, written first
+ * @param second store in bank 2
+ * @return false    OK
+ * @return true     Error: stores not in bank 1 and bank 2
+ */
+bool hcMirror_init(hcMirror_t* mirror, hcStore_t* first, hcStore_t* second)
+{
+    RETURN_TRUE_IF_TRUE(first->bank != 1 || second->bank != 2)
+
+    mirror->copies[0] = first;
+    mirror->copies[1] = second;
+    memset(&mirror->counters, 0, sizeof(mirror->counters));
+    return false;
+}
+
+/**
+ * @brief copy the current value of a key from the first copy that validates
+ *
+ * The first copy missing or failing its CRC while the second one validates is rewritten from it.
+ * A first copy of another length is still the current one, the read fails without a repair.
+ *
+ * @param mirror the mirror
+ * @param key the key
+ * @param buffer receives the payload
+ * @param size size of the buffer, has to match the payload length
+ * @return false    OK, also if the repair failed
+ * @return true     Error: key not found, no copy validates or the current copy has another length
+ */
+bool hcMirror_read(hcMirror_t* mirror, const uint16_t key, void* buffer, const uint16_t size)
+{
+    uint16_t length;
+    const void* value = hcStore_find(mirror->copies[0], key, &length);
+    if (value == NULL)
+    {
+        value = hcStore_find(mirror->copies[1], key, &length);
+        RETURN_TRUE_IF_TRUE(value == NULL || length != size)
+        memcpy(buffer, value, size);
+        mirror->counters.failures[0]++;
+        (void) repair(mirror, 0, key, buffer, size);
+        return false;
+    }
+    RETURN_TRUE_IF_TRUE(length != size)
+    memcpy(buffer, value, size);
+    return false;
+}
+
+/**
+ * @brief write a new value of a key to both copies, the one in bank 1 first
+ *
+ * @param mirror the mirror
+ * @param key the key, up to HCSTORE_KEY_MAX
+ * @param data the value
+ * @param length amount of bytes
+ * @return false    OK
+ * @return true     Error: the first copy failed or was refused and the second one is left as it
+ *                  was, or the second copy failed; reads return the old or the new value until it
+ *                  is rewritten
+ */
+bool hcMirror_write(hcMirror_t* mirror, const uint16_t key, const void* data, const uint16_t length)
+{
+    // a second copy newer than the first one would be rewritten from it by the scrub
+    if (hcStore_write(mirror->copies[0], key, data, length))
+    {
+        mirror->counters.failures[0]++;
+        return true;
+    }
+    if (hcStore_write(mirror->copies[1], key, data, length))
+    {
+        mirror->counters.failures[1]++;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief compare both copies of every key and rewrite the one that differs
+ *
+ * If both copies validate but differ, a power loss hit between the two writes and the first copy
+ * is the newer one.
+ *
+ * @param mirror the mirror
+ * @return false    OK
+ * @return true     Error: a repair failed, the copies still differ
+ */
+bool hcMirror_scrub(hcMirror_t* mirror)
+{
+    bool error = false;
+    int32_t after = -1;
+    uint16_t key = 0;
+    while (nextKey(mirror, after, &key))
+    {
+        uint16_t length[2] = {0, 0};
+        const void* value[2] = {
+            hcStore_find(mirror->copies[0], key, &length[0]),
+            hcStore_find(mirror->copies[1], key, &length[1]),
+        };
+        after = key;
+
+        if (value[0] != NULL && value[1] != NULL)
+        {
+            if (length[0] == length[1] && memcmp(value[0], value[1], length[0]) == 0)
+            {
+                continue;
+            }
+            mirror->counters.mismatches++;
+        }
+        else if (value[0] != NULL || value[1] != NULL)
+        {
+            mirror->counters.failures[value[0] == NULL ? 0 : 1]++;
+        }
+        else
+        {
+            // neither copy validates, nothing to repair from
+            mirror->counters.failures[0]++;
+            mirror->counters.failures[1]++;
+            error = true;
+            continue;
+        }
+
+        uint32_t source = (value[0] != NULL) ? 0 : 1;
+        error = repair(mirror, source ^ 1U, key, value[source], length[source]) || error;
+    }
+    return error;
+}
@@ -0,0 +1,45 @@
+#ifndef HC_MIRROR_H
+#define HC_MIRROR_H
+/**
+ * @file hc_mirror.h
+ * @brief critical records mirrored into record stores of both banks
+ *
+ * Two record stores, one in the high cyclic sectors of each bank, hold the same key space. Every
+ * value is written to the first store, which has to be in bank 1, and then to the second one. A
+ * power loss leaves the copies equal or the first one newer, a read takes the first copy that
+ * validates, so it returns the old or the new value in any case.
+ *
+ * A first copy that is missing or does not validate is rewritten from the second one when it is
+ * read; reads do not check the second copy. hcMirror_scrub() compares both copies of every key,
+ * e.g. after mounting and from the background, and rewrites the second copy from the first one
+ * where they differ. The counters of the mirror report how often the copies diverged.
+ *
+ * Both banks share the program interface of the flash, so the two copies are programmed one after
+ * the other; a write takes the time of two store writes.
+ *
+ * hcStore_mount(&critical1, 1, 124, 4);
+ * hcStore_mount(&critical2, 2, 124, 4);
+ * hcMirror_init(&critical, &critical1, &critical2);
+ * hcMirror_scrub(&critical);
+ */
+#include "hc_store.h"
+
+typedef struct
+{
+    uint32_t failures[2];               // reads and writes that failed on the first and the second copy
+    uint32_t mismatches;                // keys found with two valid but different copies by hcMirror_scrub()
+    uint32_t repairs;                   // copies rewritten from the other one
+} hcMirror_counters_t;
+
+typedef struct
+{
+    hcStore_t* copies[2];               // store in bank 1, written first, and store in bank 2
+    hcMirror_counters_t counters;
+} hcMirror_t;
+
+extern bool hcMirror_init(hcMirror_t* mirror, hcStore_t* first, hcStore_t* second);
+extern bool hcMirror_read(hcMirror_t* mirror, const uint16_t key, void* buffer, const uint16_t size);
+extern bool hcMirror_write(hcMirror_t* mirror, const uint16_t key, const void* data, const uint16_t length);
+extern bool hcMirror_scrub(hcMirror_t* mirror);
+
+#endif // HC_MIRROR_H
@@ -0,0 +1,636 @@
+#include <stddef.h>
+#include "hc_series.h"
+#include "flash_crc.h"
+
+#define RETURN_TRUE_IF_TRUE(cond) if(cond) {return true;}
+
+#define HCSERIES_STREAM_BITS    (HCSERIES_STREAM_WORDS * 16)
+#define HCSERIES_UNKNOWN        0xFFFFFFFFUL
+
+// codes of the change of the delta, shortest first
+typedef struct
+{
+    uint8_t prefixBits;         // length of the prefix
+    uint8_t prefix;             // prefix, ones terminated by a zero unless it is the longest one
+    uint8_t valueBits;          // length of the signed change behind the prefix
+} hcSeries_code_t;
+
+static const hcSeries_code_t codes[] = {
+    {1, 0x0, 0},
+    {2, 0x2, 7},
+    {3, 0x6, 9},
+    {4, 0xE, 12},
+    {4, 0xF, 18},
+};
+
+#define HCSERIES_CODES          (sizeof(codes) / sizeof(codes[0]))
+
+// bit reader over the stream of a block
+typedef struct
+{
+    const uint16_t* words;      // first stream half-word
+    uint32_t available;         // amount of readable bits
+    uint32_t position;          // next bit
+} hcSeries_reader_t;
+
+// position in the samples of a block
+typedef struct
+{
+    hcSeries_reader_t reader;
+    uint32_t remaining;         // samples left according to the sample count, HCSERIES_UNKNOWN if there is none
+    bool started;               // the first sample was returned
+    uint32_t period;
+    uint32_t timestamp;         // of the current sample
+    int32_t value;              // of the current sample
+    int32_t delta;              // difference of the current sample to the previous one
+} hcSeries_cursor_t;
+
+/**
+ * @brief get the first address of a block
+ */
+static uint32_t blockAddress(const hcSeries_t* series, const uint32_t block)
+{
+    return FLASH_GEOM_HC_SECTOR_ADDRESS(series->bank, series->sectorFirst + block / HCSERIES_BLOCKS_PER_SECTOR) +
+           (block % HCSERIES_BLOCKS_PER_SECTOR) * HCSERIES_BLOCK_SIZE;
+}
+
+static const hcSeries_blockHeader_t* blockHeader(const hcSeries_t* series, const uint32_t block)
+{
+    return (const hcSeries_blockHeader_t*) blockAddress(series, block);
+}
+
+static uint16_t* streamAddress(const hcSeries_t* series, const uint32_t block)
+{
+    return (uint16_t*) (blockAddress(series, block) + sizeof(hcSeries_blockHeader_t));
+}
+
+static uint16_t* countAddress(const hcSeries_t* series, const uint32_t block)
+{
+    return (uint16_t*) (blockAddress(series, block) + HCSERIES_BLOCK_SIZE - 2);
+}
+
+/**
+ * @brief summarize the cells of a range without an ECC fault
+ */
+static flash_probeResult_t probe(const void* address, const uint32_t size)
+{
+    flash_probeResult_t result = {0};
+    (void) highCyclic_probe(address, size, NULL, &result);
+    return result;
+}
+
+static uint16_t headerCrc(const hcSeries_blockHeader_t* header)
+{
+    return flashCrc_crc16(FLASH_CRC16_INIT, header, offsetof(hcSeries_blockHeader_t, crc));
+}
+
+/**
+ * @brief check if a block carries a valid header
+ */
+static bool isValidBlock(const hcSeries_t* series, const uint32_t block)
+{
+    const hcSeries_blockHeader_t* header = blockHeader(series, block);
+    return probe(header, sizeof(hcSeries_blockHeader_t)).valid == sizeof(hcSeries_blockHeader_t) / 2 &&
+           header->crc == headerCrc(header);
+}
+
+/**
+ * @brief get the sample count of a block and the amount of stream half-words safe to read
+ *
+ * @return the sample count, HCSERIES_UNKNOWN if the block was not closed
+ */
+static uint32_t blockCount(const hcSeries_t* series, const uint32_t block, uint32_t* words)
+{
+    if (block == series->active)
+    {
+        *words = series->words;
+        return series->count;
+    }
+
+    const uint16_t* count = countAddress(series, block);
+    if (probe(count, 2).valid == 1)
+    {
+        *words = HCSERIES_STREAM_WORDS;
+        return *count;
+    }
+
+    // not closed, e.g. by a power loss: the stream ends at the first half-word that is not programmed
+    const uint16_t* stream = streamAddress(series, block);
+    *words = 0;
+    while (*words < HCSERIES_STREAM_WORDS && probe(&stream[*words], 2).valid == 1)
+    {
+        (*words)++;
+    }
+    return HCSERIES_UNKNOWN;
+}
+
+/**
+ * @brief read bits from the stream, most significant first
+ * @return false if the stream ends before
+ */
+static bool readBits(hcSeries_reader_t* reader, const uint32_t bits, uint32_t* value)
+{
+    if (reader->position + bits > reader->available)
+    {
+        return false;
+    }
+    *value = 0;
+    for (uint32_t i = 0; i < bits; i++, reader->position++)
+    {
+        uint32_t bit = (reader->words[reader->position / 16] >> (15 - reader->position % 16)) & 1;
+        *value = (*value << 1) | bit;
+    }
+    return true;
+}
+
+/**
+ * @brief read the change of the delta of the next sample
+ * @return false if the stream ends before
+ */
+static bool readChange(hcSeries_reader_t* reader, int32_t* change)
+{
+    // count the leading ones of the prefix
+    uint32_t code = 0;
+    uint32_t bit = 1;
+    while (code < HCSERIES_CODES - 1 && bit == 1)
+    {
+        if (!readBits(reader, 1, &bit))
+        {
+            return false;
+        }
+        code += bit;
+    }
+
+    uint32_t valueBits = codes[code].valueBits;
+    uint32_t value = 0;
+    if (valueBits != 0 && !readBits(reader, valueBits, &value))
+    {
+        return false;
+    }
+    // sign extend
+    *change = (valueBits == 0) ? 0 : (int32_t) (value << (32 - valueBits)) >> (32 - valueBits);
+    return true;
+}
+
+static void cursorStart(const hcSeries_t* series, const uint32_t block, hcSeries_cursor_t* cursor)
+{
+    const hcSeries_blockHeader_t* header = blockHeader(series, block);
+    uint32_t words;
+
+    cursor->remaining = blockCount(series, block, &words);
+    cursor->reader.words = streamAddress(series, block);
+    cursor->reader.available = words * 16;
+    cursor->reader.position = 0;
+    cursor->started = false;
+    cursor->period = header->period;
+    cursor->timestamp = header->timestamp;
+    cursor->value = header->first;
+    cursor->delta = 0;
+}
+
+/**
+ * @brief continue with the next sample of the block
+ * @return false if there is none
+ */
+static bool cursorNext(hcSeries_cursor_t* cursor)
+{
+    if (cursor->remaining == 0)
+    {
+        return false;
+    }
+    if (cursor->started)
+    {
+        int32_t change;
+        if (!readChange(&cursor->reader, &change))
+        {
+            return false;
+        }
+        cursor->delta += change;
+        cursor->value += cursor->delta;
+        cursor->timestamp += cursor->period;
+    }
+    cursor->started = true;
+    if (cursor->remaining != HCSERIES_UNKNOWN)
+    {
+        cursor->remaining--;
+    }
+    return true;
+}
+
+/**
+ * @brief append bits to the pending bits of the active block
+ *
+ * @param value the bits, right aligned
+ * @param bits amount of bits, up to 16
+ */
+static void pushBits(hcSeries_t* series, const uint32_t value, const uint32_t bits)
+{
+    series->bits = (series->bits << bits) | (value & ((1UL << bits) - 1));
+    series->bitCount += bits;
+}
+
+/**
+ * @brief program every complete half-word of the pending bits
+ *
+ * A refused program leaves its half-word erased and pending, it is programmed again later.
+ *
+ * @return false    OK
+ * @return true     Error: programming failed or was refused
+ */
+static bool programWords(hcSeries_t* series)
+{
+    while (series->bitCount >= 16)
+    {
+        uint16_t word = (uint16_t) (series->bits >> (series->bitCount - 16));
+        bool error = flash_write(&streamAddress(series, series->active)[series->words], &word, sizeof(word));
+        if (error && flash_refused())
+        {
+            return true;
+        }
+        series->bitCount -= 16;
+        series->bits &= (1ULL << series->bitCount) - 1;
+        series->words++;
+        RETURN_TRUE_IF_TRUE(error)
+    }
+    return false;
+}
+
+/**
+ * @brief end the active block after its stream failed to program
+ *
+ * A failed half-word tears the block, queries end it there. A refused one is still erased, the
+ * block stays active.
+ *
+ * @return true     always, for the caller to return
+ */
+static bool streamFailed(hcSeries_t* series)
+{
+    if (!flash_refused())
+    {
+        series->active = HCSERIES_NONE;
+    }
+    return true;
+}
+
+/**
+ * @brief program the pending bits padded with ones and the sample count
+ *
+ * The padding reads as the start of the longest code, which never completes, so even a block
+ * whose sample count is missing decodes correctly. A refused program keeps the block active
+ * without the padding, so it can be closed again or continued.
+ *
+ * @return false    OK
+ * @return true     Error
+ */
+static bool closeBlock(hcSeries_t* series)
+{
+    if (programWords(series))
+    {
+        return streamFailed(series);
+    }
+    if (series->bitCount != 0)
+    {
+        uint8_t bitCount = series->bitCount;
+        uint64_t bits = series->bits;
+        pushBits(series, 0xFFFF, 16 - bitCount);
+        if (programWords(series))
+        {
+            series->bitCount = bitCount;
+            series->bits = bits;
+            return streamFailed(series);
+        }
+    }
+    if (flash_write(countAddress(series, series->active), &series->count, sizeof(series->count)))
+    {
+        return streamFailed(series);
+    }
+    series->active = HCSERIES_NONE;
+    return false;
+}
+
+/**
+ * @brief open the next block with a first sample, erasing the sector with the oldest blocks
+ *        when the next block starts it
+ *
+ * @return false    OK
+ * @return true     Error: erasing failed or was refused, or no block could be programmed
+ */
+static bool openBlock(hcSeries_t* series, const uint32_t timestamp, const int16_t value)
+{
+    for (uint32_t attempt = 0; attempt < series->blocks; attempt++)
+    {
+        uint32_t block = series->next;
+        series->next = (block + 1) % series->blocks;
+
+        if (block % HCSERIES_BLOCKS_PER_SECTOR == 0 &&
+            probe((const void*) blockAddress(series, block), HIGH_CYCLIC_SECTOR_SIZE).erased != HIGH_CYCLIC_SECTOR_SIZE / 2)
+        {
+            if (flash_erase(series->bank, series->sectorFirst + block / HCSERIES_BLOCKS_PER_SECTOR))
+            {
+                // a refused erase left the sector as it was, it is opened next time again
+                series->next = flash_refused() ? block : series->next;
+                return true;
+            }
+            if (series->oldest != HCSERIES_NONE && series->oldest / HCSERIES_BLOCKS_PER_SECTOR == block / HCSERIES_BLOCKS_PER_SECTOR)
+            {
+                series->oldest = (block + HCSERIES_BLOCKS_PER_SECTOR) % series->blocks;
+            }
+        }
+
+        // a block left torn by a power loss is skipped until its sector is erased
+        if (probe((const void*) blockAddress(series, block), HCSERIES_BLOCK_SIZE).erased != HCSERIES_BLOCK_SIZE / 2)
+        {
+            continue;
+        }
+
+        hcSeries_blockHeader_t header = {
+            .sequence = series->sequence + 1,
+            .timestamp = timestamp,
+            .period = series->period,
+            .first = value,
+        };
+        header.crc = headerCrc(&header);
+        if (flash_write((void*) blockAddress(series, block), &header, sizeof(header)))
+        {
+            if (flash_refused())
+            {
+                series->next = block;
+                return true;
+            }
+            continue;
+        }
+
+        series->sequence++;
+        series->active = block;
+        series->count = 1;
+        series->words = 0;
+        series->bits = 0;
+        series->bitCount = 0;
+        series->delta = 0;
+        series->timestamp = timestamp;
+        series->value = value;
+        if (series->oldest == HCSERIES_NONE)
+        {
+            series->oldest = block;
+        }
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief open a series, finding its oldest and newest block
+ *
+ * The newest block is closed, new samples start a new block.
+ *
+ * @param series the series to open
+ * @param bank Bank 1 or 2
+ * @param sectorFirst first sector of the series, a high cyclic sector
+ * @param sectorCount amount of sectors, at least 2
+ * @param period timestamp difference of consecutive samples, at least 1
+ * @return false    OK
+ * @return true     Error: region not usable or invalid parameters
+ */
+bool hcSeries_open(hcSeries_t* series, const uint8_t bank, const uint8_t sectorFirst,
+                   const uint8_t sectorCount, const uint32_t period)
+{
+    RETURN_TRUE_IF_TRUE(sectorCount < 2 || period == 0)
+    RETURN_TRUE_IF_TRUE(flash_checkRegion(bank, true, sectorFirst, sectorFirst + sectorCount - 1))
+
+    series->bank = bank;
+    series->sectorFirst = sectorFirst;
+    series->sectorCount = sectorCount;
+    series->period = period;
+    series->blocks = sectorCount * HCSERIES_BLOCKS_PER_SECTOR;
+    series->oldest = HCSERIES_NONE;
+    series->active = HCSERIES_NONE;
+    series->sequence = 0;
+
+    uint32_t newest = HCSERIES_NONE;
+    uint32_t oldestSequence = 0;
+    for (uint32_t block = 0; block < series->blocks; block++)
+    {
+        if (!isValidBlock(series, block))
+        {
+            continue;
+        }
+        uint32_t sequence = blockHeader(series, block)->sequence;
+        if (series->oldest == HCSERIES_NONE || sequence < oldestSequence)
+        {
+            series->oldest = block;
+            oldestSequence = sequence;
+        }
+        if (sequence > series->sequence)
+        {
+            newest = block;
+            series->sequence = sequence;
+        }
+    }
+    if (newest == HCSERIES_NONE)
+    {
+        series->next = 0;
+        return false;
+    }
+    series->next = (newest + 1) % series->blocks;
+
+    // the newest sample, appends have to follow it
+    hcSeries_cursor_t cursor;
+    uint16_t count = 0;
+    cursorStart(series, newest, &cursor);
+    bool closed = cursor.remaining != HCSERIES_UNKNOWN;
+    while (cursorNext(&cursor))
+    {
+        count++;
+    }
+    series->timestamp = cursor.timestamp;
+    series->value = (int16_t) cursor.value;
+
+    // close it if a power loss left it open, later queries do not have to probe its stream
+    const uint16_t* countCell = countAddress(series, newest);
+    if (!closed && probe(countCell, 2).erased == 1)
+    {
+        (void) flash_write((void*) countCell, &count, sizeof(count));
+    }
+    return false;
+}
+
+/**
+ * @brief append a sample
+ *
+ * A sample exactly one period behind the previous one is coded into the active block, any other
+ * timestamp starts a new block.
+ *
+ * @param series an open series
+ * @param timestamp timestamp of the sample, after the one of the newest sample
+ * @param value the sample
+ * @return false    OK
+ * @return true     Error: timestamp not increasing, erasing or programming failed. If it was
+ *                  refused, the sample is not appended and the series is unchanged
+ */
+bool hcSeries_append(hcSeries_t* series, const uint32_t timestamp, const int16_t value)
+{
+    RETURN_TRUE_IF_TRUE(series->sequence != 0 && timestamp <= series->timestamp)
+
+    if (series->active != HCSERIES_NONE && timestamp - series->timestamp == series->period)
+    {
+        int32_t delta = value - series->value;
+        int32_t change = delta - series->delta;
+
+        const hcSeries_code_t* code = codes;
+        while (code->valueBits != 18 &&
+               (code->valueBits == 0 ? change != 0 :
+                (change < -(1L << (code->valueBits - 1)) || change >= (1L << (code->valueBits - 1)))))
+        {
+            code++;
+        }
+
+        if (series->words * 16U + series->bitCount + code->prefixBits + code->valueBits <= HCSERIES_STREAM_BITS)
+        {
+            // a half-word left pending by a refused program goes first
+            if (programWords(series))
+            {
+                return streamFailed(series);
+            }
+            uint8_t bitCount = series->bitCount;
+            uint64_t bits = series->bits;
+            uint16_t words = series->words;
+
+            pushBits(series, code->prefix, code->prefixBits);
+            if (code->valueBits > 16)
+            {
+                pushBits(series, (uint32_t) change >> 16, code->valueBits - 16);
+            }
+            if (code->valueBits != 0)
+            {
+                pushBits(series, (uint32_t) change, code->valueBits > 16 ? 16 : code->valueBits);
+            }
+            // refused behind a programmed half-word of the sample, the rest stays pending
+            if (programWords(series) && !(flash_refused() && series->words != words))
+            {
+                if (flash_refused())
+                {
+                    // nothing of the sample is programmed, it is not appended
+                    series->bitCount = bitCount;
+                    series->bits = bits;
+                }
+                return streamFailed(series);
+            }
+
+            series->count++;
+            series->delta = delta;
+            series->value = value;
+            series->timestamp = timestamp;
+            return false;
+        }
+    }
+
+    bool error = false;
+    if (series->active != HCSERIES_NONE)
+    {
+        error = closeBlock(series);
+        // a refused close keeps the block active, the sample is not appended
+        RETURN_TRUE_IF_TRUE(error && series->active != HCSERIES_NONE)
+    }
+    return openBlock(series, timestamp, value) || error;
+}
+
+/**
+ * @brief close the active block, so all samples are in flash
+ * @note the next sample starts a new block, flush only before a reset or a power down
+ *
+ * @return false    OK, also if no block is open
+ * @return true     Error: programming failed, or it was refused and the block stays open
+ */
+bool hcSeries_flush(hcSeries_t* series)
+{
+    if (series->active == HCSERIES_NONE)
+    {
+        return false;
+    }
+    return closeBlock(series);
+}
+
+/**
+ * @brief decode the samples of a time range
+ *
+ * Samples of the active block that are still in RAM, at most 15 bits unless a program was
+ * refused, are not returned before their half-word is programmed.
+ *
+ * @param series an open series
+ * @param from first timestamp of the range
+ * @param to last timestamp of the range
+ * @param samples receives the samples in the order of their timestamps
+ * @param maxSamples size of samples, a full buffer ends the query, continue behind its last timestamp
+ * @param count receives the amount of samples
+ * @return false    OK
+ * @return true     Error: from behind to
+ */
+bool hcSeries_query(const hcSeries_t* series, const uint32_t from, const uint32_t to,
+                    hcSeries_sample_t* samples, const uint32_t maxSamples, uint32_t* count)
+{
+    *count = 0;
+    RETURN_TRUE_IF_TRUE(from > to)
+    if (series->oldest == HCSERIES_NONE)
+    {
+        return false;
+    }
+
+    // binary search in the order of the blocks from the oldest one for the last block starting at
+    // or before from, blocks without a valid header in between are skipped
+    uint32_t low = 0;
+    uint32_t high = series->blocks;
+    uint32_t start = 0;
+    while (low < high)
+    {
+        uint32_t middle = (low + high) / 2;
+        uint32_t valid = middle;
+        while (valid < high && !isValidBlock(series, (series->oldest + valid) % series->blocks))
+        {
+            valid++;
+        }
+        if (valid == high)
+        {
+            high = middle;
+        }
+        else if (blockHeader(series, (series->oldest + valid) % series->blocks)->timestamp <= from)
+        {
+            start = valid;
+            low = valid + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    for (uint32_t i = start; i < series->blocks; i++)
+    {
+        uint32_t block = (series->oldest + i) % series->blocks;
+        if (!isValidBlock(series, block))
+        {
+            continue;
+        }
+        if (blockHeader(series, block)->timestamp > to)
+        {
+            break;
+        }
+
+        hcSeries_cursor_t cursor;
+        cursorStart(series, block, &cursor);
+        while (cursorNext(&cursor) && cursor.timestamp <= to)
+        {
+            if (cursor.timestamp < from)
+            {
+                continue;
+            }
+            if (*count == maxSamples)
+            {
+                return false;
+            }
+            samples[*count].timestamp = cursor.timestamp;
+            samples[*count].value = (int16_t) cursor.value;
+            (*count)++;
+        }
+    }
+    return false;
+}
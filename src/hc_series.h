@@ -0,0 +1,88 @@
+#ifndef HC_SERIES_H
+#define HC_SERIES_H
+/**
+ * @file hc_series.h
+ * @brief time series of 16 bit samples, delta-of-delta encoded into high cyclic sectors
+ *
+ * A series records one channel sampled at a fixed period into consecutive high cyclic sectors of
+ * a bank, used as a ring: when all blocks are used, the sector with the oldest blocks is erased.
+ * Sectors are split into blocks of HCSERIES_BLOCK_SIZE bytes.
+ *
+ * block:   header (sequence, timestamp, period, first value, crc), bit stream, sample count
+ *
+ * The header holds the first sample. Every further sample is coded by the change of its delta to
+ * the previous sample, most significant bit first:
+ *
+ * 0                        delta unchanged
+ * 10   + 7 bit             change -64 .. 63
+ * 110  + 9 bit             change -256 .. 255
+ * 1110 + 12 bit            change -2048 .. 2047
+ * 1111 + 18 bit            any other change
+ *
+ * A slowly changing signal takes one to ten bits per sample instead of 16. The stream is
+ * programmed a half-word at a time as soon as 16 bits are complete; the sample count at the end
+ * of the block is programmed when the block is closed. A block is closed when it is full, when a
+ * sample does not follow its predecessor by exactly one period and by hcSeries_flush(). After a
+ * power loss the samples of the complete half-words stay readable. A refused program leaves its
+ * half-word pending in RAM, the append fails without appending the sample.
+ *
+ * Queries find the first block by a binary search over the block headers and decode straight from
+ * the memory mapped flash.
+ */
+#include "flash.h"
+
+// bytes per block, a sector holds a whole number of blocks
+#define HCSERIES_BLOCK_SIZE             512
+#define HCSERIES_BLOCKS_PER_SECTOR      (HIGH_CYCLIC_SECTOR_SIZE / HCSERIES_BLOCK_SIZE)
+#define HCSERIES_NONE                   0xFFFF
+
+_Static_assert(HIGH_CYCLIC_SECTOR_SIZE % HCSERIES_BLOCK_SIZE == 0, "sector not a multiple of blocks");
+
+typedef struct
+{
+    uint32_t sequence;          // order in which the blocks were opened, starting at 1
+    uint32_t timestamp;         // timestamp of the first sample
+    uint32_t period;            // timestamp difference of consecutive samples
+    int16_t first;              // value of the first sample
+    uint16_t crc;               // CRC-16 over the header up to this field
+} hcSeries_blockHeader_t;
+
+_Static_assert(sizeof(hcSeries_blockHeader_t) == 16, "block header layout");
+
+// half-words of the bit stream of a block, between header and sample count
+#define HCSERIES_STREAM_WORDS   ((HCSERIES_BLOCK_SIZE - sizeof(hcSeries_blockHeader_t) - 2) / 2)
+
+typedef struct
+{
+    uint32_t timestamp;
+    int16_t value;
+} hcSeries_sample_t;
+
+typedef struct
+{
+    uint8_t bank;               // bank of the series
+    uint8_t sectorFirst;        // first sector of the series
+    uint8_t sectorCount;        // amount of sectors
+    uint32_t period;            // timestamp difference of consecutive samples
+    uint16_t blocks;            // amount of blocks
+    uint16_t oldest;            // block with the oldest samples, HCSERIES_NONE if the series is empty
+    uint16_t next;              // block opened next
+    uint16_t active;            // block samples are appended to, HCSERIES_NONE if none is open
+    uint32_t sequence;          // sequence of the newest block, 0 if there is none
+    uint32_t timestamp;         // timestamp of the newest sample
+    int16_t value;              // value of the newest sample
+    int32_t delta;              // difference of the two newest samples of the active block
+    uint16_t count;             // samples in the active block
+    uint16_t words;             // programmed stream half-words of the active block
+    uint64_t bits;              // stream bits not programmed yet, right aligned
+    uint8_t bitCount;           // amount of stream bits not programmed yet, below 16 unless a program was refused
+} hcSeries_t;
+
+extern bool hcSeries_open(hcSeries_t* series, const uint8_t bank, const uint8_t sectorFirst,
+                          const uint8_t sectorCount, const uint32_t period);
+extern bool hcSeries_append(hcSeries_t* series, const uint32_t timestamp, const int16_t value);
+extern bool hcSeries_flush(hcSeries_t* series);
+extern bool hcSeries_query(const hcSeries_t* series, const uint32_t from, const uint32_t to,
+                           hcSeries_sample_t* samples, const uint32_t maxSamples, uint32_t* count);
+
+#endif // HC_SERIES_H
@@ -0,0 +1,297 @@
+#include <stddef.h>
+#include <string.h>
+#include "hc_slot.h"
+#include "flash_crc.h"
+
+#define RETURN_TRUE_IF_TRUE(cond) if(cond) {return true;}
+
+/**
+ * @brief get the first address of one of the two sectors
+ */
+static uint32_t sectorAddress(const hcSlot_t* slot, const uint32_t sector)
+{
+    return FLASH_GEOM_HC_SECTOR_ADDRESS(slot->bank, slot->sectorFirst + sector);
+}
+
+/**
+ * @brief get the address of a slot
+ */
+static const uint8_t* slotAddress(const hcSlot_t* slot, const uint32_t sector, const uint32_t index)
+{
+    return (const uint8_t*) (sectorAddress(slot, sector) + sizeof(hcSlot_sectorHeader_t) + index * HCSLOT_SLOT_SIZE(slot->valueSize));
+}
+
+/**
+ * @brief check if every half-word of a range is erased
+ */
+static bool isErased(const void* address, const uint32_t size)
+{
+    flash_probeResult_t probe;
+    return !highCyclic_probe(address, size, NULL, &probe) && probe.erased == size / 2;
+}
+
+/**
+ * @brief check if a range is completely programmed and readable
+ */
+static bool isProgrammed(const void* address, const uint32_t size)
+{
+    flash_probeResult_t probe;
+    return !highCyclic_probe(address, size, NULL, &probe) && probe.valid == size / 2;
+}
+
+/**
+ * @brief get the CRC of a sector header
+ */
+static uint16_t headerCrc(const hcSlot_sectorHeader_t* header)
+{
+    return flashCrc_crc16(FLASH_CRC16_INIT, header, offsetof(hcSlot_sectorHeader_t, crc));
+}
+
+/**
+ * @brief check if a sector carries a valid header for the value size
+ */
+static bool isFormatted(const hcSlot_t* slot, const uint32_t sector)
+{
+    const hcSlot_sectorHeader_t* header = (const hcSlot_sectorHeader_t*) sectorAddress(slot, sector);
+    return isProgrammed(header, sizeof(hcSlot_sectorHeader_t)) && header->valueSize == slot->valueSize &&
+           header->crc == headerCrc(header);
+}
+
+/**
+ * @brief check if a slot holds a completely programmed value that passes its CRC
+ */
+static bool isValidSlot(const hcSlot_t* slot, const uint32_t sector, const uint32_t index)
+{
+    const uint8_t* address = slotAddress(slot, sector, index);
+    uint32_t size = HCSLOT_SLOT_SIZE(slot->valueSize);
+    uint16_t crc;
+
+    if (!isProgrammed(address, size))
+    {
+        return false;
+    }
+    memcpy(&crc, address + size - 2, sizeof(crc));
+    return crc == flashCrc_crc16(FLASH_CRC16_INIT, address, slot->valueSize);
+}
+
+/**
+ * @brief find the first erased slot of a sector and the newest valid slot in front of it
+ *
+ * Slots are programmed in order, so the programmed ones form a prefix of the sector and a binary
+ * search finds its end. A slot torn by a power loss is the last one of the prefix, the slot in
+ * front of it holds the newest value then.
+ *
+ * @param next receives the first erased slot, HCSLOT_SLOTS() if the sector is full
+ * @return the newest valid slot, HCSLOT_NONE if there is none
+ */
+static uint16_t newestSlot(const hcSlot_t* slot, const uint32_t sector, uint16_t* next)
+{
+    uint32_t low = 0;
+    uint32_t high = HCSLOT_SLOTS(slot->valueSize);
+    while (low < high)
+    {
+        uint32_t middle = (low + high) / 2;
+        if (isErased(slotAddress(slot, sector, middle), HCSLOT_SLOT_SIZE(slot->valueSize)))
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+    *next = (uint16_t) low;
+
+    while (low-- > 0)
+    {
+        if (isValidSlot(slot, sector, low))
+        {
+            return (uint16_t) low;
+        }
+    }
+    return HCSLOT_NONE;
+}
+
+/**
+ * @brief program the value and its CRC into the next slot of the active sector
+ *
+ * The CRC is programmed last, a slot torn by a power loss fails it. The caller advances to the
+ * next slot.
+ *
+ * @return false    OK
+ * @return true     Error
+ */
+static bool writeSlot(hcSlot_t* slot, const void* value)
+{
+    uint8_t* address = (uint8_t*) slotAddress(slot, slot->active, slot->next);
+    uint16_t crc = flashCrc_crc16(FLASH_CRC16_INIT, value, slot->valueSize);
+    uint16_t chunk[16];
+
+    // copy the value through an aligned buffer, an odd size is padded with 0xFF
+    for (uint32_t done = 0; done < slot->valueSize; done += sizeof(chunk))
+    {
+        uint32_t size = (slot->valueSize - done < sizeof(chunk)) ? slot->valueSize - done : sizeof(chunk);
+        if (size & 0x1)
+        {
+            chunk[size / 2] = 0xFFFF;
+        }
+        memcpy(chunk, (const uint8_t*) value + done, size);
+        RETURN_TRUE_IF_TRUE(flash_write(address + done, chunk, (size + 1U) & ~1U))
+    }
+    return flash_write(address + HCSLOT_SLOT_SIZE(slot->valueSize) - 2, &crc, sizeof(crc));
+}
+
+/**
+ * @brief continue in the other sector: erase it if necessary and program its header
+ *
+ * @return false    OK
+ * @return true     Error
+ */
+static bool switchSector(hcSlot_t* slot)
+{
+    uint32_t other = slot->active ^ 1U;
+    if (!isErased((const void*) sectorAddress(slot, other), HIGH_CYCLIC_SECTOR_SIZE))
+    {
+        RETURN_TRUE_IF_TRUE(flash_erase(slot->bank, slot->sectorFirst + other))
+    }
+
+    hcSlot_sectorHeader_t header = {
+        .sequence = slot->sequence + 1,
+        .valueSize = slot->valueSize,
+    };
+    header.crc = headerCrc(&header);
+    RETURN_TRUE_IF_TRUE(flash_write((void*) sectorAddress(slot, other), &header, sizeof(header)))
+
+    slot->active = other;
+    slot->sequence++;
+    slot->next = 0;
+    return false;
+}
+
+/**
+ * @brief open the value kept in two consecutive high cyclic sectors and find its newest slot
+ *
+ * @param slot the value to open
+ * @param bank Bank 1 or 2
+ * @param sectorFirst first of the two sectors
+ * @param valueSize bytes per value, at least 1, two slots have to fit into a sector
+ * @return false    OK, also if no value was written yet
+ * @return true     Error: sectors not usable or invalid value size
+ */
+bool hcSlot_open(hcSlot_t* slot, const uint8_t bank, const uint8_t sectorFirst, const uint16_t valueSize)
+{
+    RETURN_TRUE_IF_TRUE(valueSize == 0 || HCSLOT_SLOTS(valueSize) < 2)
+    RETURN_TRUE_IF_TRUE(flash_checkRegion(bank, true, sectorFirst, sectorFirst + 1))
+
+    slot->bank = bank;
+    slot->sectorFirst = sectorFirst;
+    slot->valueSize = valueSize;
+
+    // nothing written yet: pretend a full sector 1, the first write starts sector 0
+    slot->active = 1;
+    slot->sequence = 0;
+    slot->next = HCSLOT_SLOTS(valueSize);
+    slot->newestSector = 0;
+    slot->newest = HCSLOT_NONE;
+
+    // the sector with the higher sequence first, it is the newer one unless its first value is torn
+    bool formatted[2] = {isFormatted(slot, 0), isFormatted(slot, 1)};
+    uint32_t sequence[2] = {
+        formatted[0] ? ((const hcSlot_sectorHeader_t*) sectorAddress(slot, 0))->sequence : 0,
+        formatted[1] ? ((const hcSlot_sectorHeader_t*) sectorAddress(slot, 1))->sequence : 0,
+    };
+    uint32_t first = (sequence[1] > sequence[0]) ? 1 : 0;
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        uint32_t sector = first ^ i;
+        uint16_t next;
+        uint16_t newest = formatted[sector] ? newestSlot(slot, sector, &next) : HCSLOT_NONE;
+        if (newest != HCSLOT_NONE)
+        {
+            slot->active = sector;
+            slot->sequence = sequence[sector];
+            slot->next = next;
+            slot->newestSector = sector;
+            slot->newest = newest;
+            break;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief get the newest value
+ *
+ * @return the value in flash, NULL if none was written yet
+ */
+const void* hcSlot_find(const hcSlot_t* slot)
+{
+    if (slot->newest == HCSLOT_NONE)
+    {
+        return NULL;
+    }
+    return slotAddress(slot, slot->newestSector, slot->newest);
+}
+
+/**
+ * @brief copy the newest value
+ *
+ * @param slot an open value
+ * @param value receives valueSize bytes
+ * @return false    OK
+ * @return true     Error: no value written yet
+ */
+bool hcSlot_read(const hcSlot_t* slot, void* value)
+{
+    const void* newest = hcSlot_find(slot);
+    RETURN_TRUE_IF_TRUE(newest == NULL)
+    memcpy(value, newest, slot->valueSize);
+    return false;
+}
+
+/**
+ * @brief write a new value into the next erased slot
+ *
+ * A slot that fails to program is skipped, it cannot be programmed again. A slot that is still
+ * erased, because the program was refused, is tried again; the programmed slots stay a prefix of
+ * the sector. When the active sector is full, the value starts the other sector and the full one
+ * is erased once the value is in place.
+ *
+ * @param slot an open value
+ * @param value valueSize bytes
+ * @return false    OK
+ * @return true     Error: programming or erasing failed HCSLOT_WRITE_ATTEMPTS times, the newest
+ *                  value is the previous one unless the final erase failed
+ */
+bool hcSlot_write(hcSlot_t* slot, const void* value)
+{
+    bool switched = false;
+    for (uint32_t attempt = 0;; attempt++)
+    {
+        RETURN_TRUE_IF_TRUE(attempt == HCSLOT_WRITE_ATTEMPTS)
+        if (slot->next >= HCSLOT_SLOTS(slot->valueSize))
+        {
+            // a second switch would mean a whole sector failed to program
+            RETURN_TRUE_IF_TRUE(switched)
+            RETURN_TRUE_IF_TRUE(switchSector(slot))
+            switched = true;
+        }
+        if (!writeSlot(slot, value))
+        {
+            break;
+        }
+        if (!isErased(slotAddress(slot, slot->active, slot->next), HCSLOT_SLOT_SIZE(slot->valueSize)))
+        {
+            slot->next++;
+        }
+    }
+    slot->newestSector = slot->active;
+    slot->newest = slot->next++;
+
+    if (switched)
+    {
+        // the previous value is no longer needed, empty the full sector for the next switch
+        return flash_erase(slot->bank, slot->sectorFirst + (slot->active ^ 1U));
+    }
+    return false;
+}
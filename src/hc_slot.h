@@ -0,0 +1,56 @@
+#ifndef HC_SLOT_H
+#define HC_SLOT_H
+/**
+ * @file hc_slot.h
+ * @brief a single fixed-size value in two high cyclic sectors, updated without an erase per update
+ *
+ * Every update programs the value into the next erased slot of the active sector, so a sector is
+ * filled slot by slot from its start. The newest value is the last programmed slot; opening finds
+ * it by a binary search for the first erased slot, probing about log2(slots) slots.
+ *
+ * sector:  header (sequence, value size, crc), slots
+ * slot:    value (padded to an even size), crc
+ *
+ * When the active sector is full, the value goes into the first slot of the other sector under a
+ * higher sequence, and the full sector is erased afterwards. An 8 byte value takes a 10 byte slot,
+ * 613 of them per sector, so a sector is erased once per 613 updates instead of once per update.
+ * A power loss at any point leaves the previous or the new value.
+ */
+#include "flash.h"
+
+#define HCSLOT_NONE             0xFFFF
+// programs of one update, failed or refused, before hcSlot_write() gives up
+#define HCSLOT_WRITE_ATTEMPTS   4
+
+typedef struct
+{
+    uint32_t sequence;          // order in which the sectors were activated, starting at 1
+    uint16_t valueSize;         // bytes per value
+    uint16_t crc;               // CRC-16 over the header up to this field
+} hcSlot_sectorHeader_t;
+
+_Static_assert(sizeof(hcSlot_sectorHeader_t) == 8, "slot sector header layout");
+
+// bytes per slot: value padded to half-words and its CRC-16
+#define HCSLOT_SLOT_SIZE(valueSize)     ((((valueSize) + 1U) & ~1U) + 2U)
+// slots per sector
+#define HCSLOT_SLOTS(valueSize)         ((HIGH_CYCLIC_SECTOR_SIZE - sizeof(hcSlot_sectorHeader_t)) / HCSLOT_SLOT_SIZE(valueSize))
+
+typedef struct
+{
+    uint8_t bank;               // bank of the sectors
+    uint8_t sectorFirst;        // first of the two consecutive sectors
+    uint16_t valueSize;         // bytes per value
+    uint8_t active;             // sector values are written to, relative to sectorFirst
+    uint32_t sequence;          // sequence of the active sector
+    uint16_t next;              // first erased slot of the active sector, HCSLOT_SLOTS() if full
+    uint8_t newestSector;       // sector of the newest value, relative to sectorFirst
+    uint16_t newest;            // slot of the newest value, HCSLOT_NONE if there is none
+} hcSlot_t;
+
+extern bool hcSlot_open(hcSlot_t* slot, const uint8_t bank, const uint8_t sectorFirst, const uint16_t valueSize);
+extern const void* hcSlot_find(const hcSlot_t* slot);
+extern bool hcSlot_read(const hcSlot_t* slot, void* value);
+extern bool hcSlot_write(hcSlot_t* slot, const void* value);
+
+#endif // HC_SLOT_H
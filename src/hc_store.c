@@ -0,0 +1,754 @@
+#include <string.h>
+#include "hc_store.h"
+#include "flash_ecc.h"
+#include "flash_ob.h"
+
+#define RETURN_TRUE_IF_TRUE(cond) if(cond) {return true;}
+
+/**
+ * @brief get the header of a store sector
+ */
+static const hcStore_sectorHeader_t* sectorHeader(const hcStore_t* store, const uint32_t sector)
+{
+    return (const hcStore_sectorHeader_t*) (store->start + sector * store->sectorSize);
+}
+
+/**
+ * @brief get the size of a record in the store, padded to the program granule
+ */
+static uint32_t recordSize(const hcStore_t* store, const uint32_t length)
+{
+    return HCSTORE_RECORD_SIZE_IN(length, store->granule);
+}
+
+/**
+ * @brief check if a sector carries a valid header, probing it first since the sector may be virgin
+ */
+static bool isFormatted(const hcStore_t* store, const uint32_t sector)
+{
+    const hcStore_sectorHeader_t* header = sectorHeader(store, sector);
+    flash_probeResult_t probe;
+
+    if (highCyclic_probe(header, sizeof(hcStore_sectorHeader_t), NULL, &probe) ||
+        probe.valid != sizeof(hcStore_sectorHeader_t) / store->granule)
+    {
+        return false;
+    }
+    return header->magic == HCSTORE_MAGIC && header->version == HCSTORE_VERSION && header->crc == hcStore_headerCrc(header);
+}
+
+/**
+ * @brief check a record header at an offset of the store and its CRC
+ *
+ * @return the record, NULL if it is invalid
+ */
+static const hcStore_recordHeader_t* validRecord(const hcStore_t* store, const uint32_t offset)
+{
+    uint32_t sectorEnd = (offset / store->sectorSize + 1) * store->sectorSize;
+    const hcStore_recordHeader_t* record = (const hcStore_recordHeader_t*) (store->start + offset);
+
+    if ((offset & (store->granule - 1U)) != 0 || offset + sizeof(hcStore_recordHeader_t) > sectorEnd ||
+        offset + recordSize(store, record->length) > sectorEnd ||
+        record->crc != hcStore_recordCrc(record, record + 1))
+    {
+        return NULL;
+    }
+    return record;
+}
+
+/**
+ * @brief check a record which may be torn or worn out, probing every cell before it is read
+ *
+ * @return the record, NULL if it is not completely programmed, fails ECC or its CRC
+ */
+static const hcStore_recordHeader_t* probedRecord(const hcStore_t* store, const uint32_t offset)
+{
+    uint32_t sectorEnd = (offset / store->sectorSize + 1) * store->sectorSize;
+    const uint8_t* record = (const uint8_t*) (store->start + offset);
+    uint32_t headerSize = recordSize(store, 0);
+    flash_probeResult_t probe;
+
+    // the cells holding the header first, the length is read from them
+    if (offset + headerSize > sectorEnd ||
+        highCyclic_probe(record, headerSize, NULL, &probe) ||
+        probe.valid != headerSize / store->granule)
+    {
+        return NULL;
+    }
+    uint32_t size = recordSize(store, ((const hcStore_recordHeader_t*) record)->length);
+    if (offset + size > sectorEnd)
+    {
+        return NULL;
+    }
+    if (size > headerSize &&
+        (highCyclic_probe(record + headerSize, size - headerSize, NULL, &probe) ||
+         probe.valid != (size - headerSize) / store->granule))
+    {
+        return NULL;
+    }
+    return validRecord(store, offset);
+}
+
+/**
+ * @brief get the position of a key in the index, or where it has to be inserted
+ */
+static uint32_t indexPosition(const hcStore_t* store, const uint16_t key)
+{
+    // binary search, entries are sorted by key
+    uint32_t low = 0;
+    uint32_t high = store->indexEntries;
+    while (low < high)
+    {
+        uint32_t middle = (low + high) / 2;
+        if (store->index[middle].key < key)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/**
+ * @brief point the index entry of a key to a record
+ *
+ * @return false    OK
+ * @return true     Error: index full
+ */
+static bool indexUpdate(hcStore_t* store, const uint16_t key, const uint32_t offset)
+{
+    uint32_t position = indexPosition(store, key);
+    if (position == store->indexEntries || store->index[position].key != key)
+    {
+        RETURN_TRUE_IF_TRUE(store->indexEntries == HCSTORE_MAX_KEYS)
+        memmove(&store->index[position + 1], &store->index[position],
+                (store->indexEntries - position) * sizeof(hcStore_indexEntry_t));
+        store->indexEntries++;
+        store->index[position].key = key;
+    }
+    store->index[position].offset = (uint16_t) offset;
+    return false;
+}
+
+/**
+ * @brief apply the records of a sector to the index, starting at an offset within the sector
+ *
+ * Stops at the first erased record header, which is the tail of the sector. A record that is
+ * partially programmed, corrupt or fails its CRC was torn by a power loss; nothing behind it
+ * can be trusted or programmed, so the sector counts as full.
+ *
+ * @return offset of the tail within the sector, the sector size if the sector is full
+ */
+static uint32_t replaySector(hcStore_t* store, const uint32_t sector, uint32_t offset)
+{
+    uint32_t sectorStart = sector * store->sectorSize;
+    uint32_t headerSize = recordSize(store, 0);
+    flash_probeResult_t probe;
+
+    while (offset + headerSize <= store->sectorSize)
+    {
+        const hcStore_recordHeader_t* record = (const hcStore_recordHeader_t*) (store->start + sectorStart + offset);
+        if (highCyclic_probe(record, headerSize, NULL, &probe) ||
+            probe.erased == headerSize / store->granule)
+        {
+            return offset;
+        }
+        if (probedRecord(store, sectorStart + offset) == NULL)
+        {
+            break;
+        }
+
+        if (record->key == HCSTORE_KEY_INDEX)
+        {
+            // an index checkpoint replaces the index
+            uint32_t entries = record->length / sizeof(hcStore_indexEntry_t);
+            if (entries > HCSTORE_MAX_KEYS)
+            {
+                break;
+            }
+            memcpy(store->index, record + 1, entries * sizeof(hcStore_indexEntry_t));
+            store->indexEntries = entries;
+        }
+        else if (indexUpdate(store, record->key, sectorStart + offset))
+        {
+            break;
+        }
+        offset += recordSize(store, record->length);
+    }
+    return store->sectorSize;
+}
+
+/**
+ * @brief program a record at the tail of the active sector
+ *
+ * The header is programmed before the payload, a record torn by a power loss fails its CRC.
+ * The tail moves behind the record once it is programmed. If programming fails, the tail stays
+ * if the driver refused before touching a cell; otherwise the record is torn and, as for the
+ * replay, nothing behind it in the sector can be used.
+ *
+ * @return false    OK
+ * @return true     Error
+ */
+static bool appendRecord(hcStore_t* store, const uint16_t key, const void* data, const uint16_t length)
+{
+    hcStore_recordHeader_t record = {.key = key, .length = length};
+    uint8_t* address = (uint8_t*) (store->start + store->tail);
+    uint32_t size = recordSize(store, length);
+    uint32_t chunk[8];
+    uint8_t* bytes = (uint8_t*) chunk;
+
+    record.crc = hcStore_recordCrc(&record, data);
+
+    // stream header, payload and 0xFF padding through an aligned buffer of whole program granules
+    for (uint32_t done = 0; done < size; done += sizeof(chunk))
+    {
+        uint32_t step = (size - done < sizeof(chunk)) ? size - done : sizeof(chunk);
+        memset(bytes, 0xFF, step);
+        for (uint32_t i = 0; i < step; i++)
+        {
+            uint32_t position = done + i;
+            if (position < sizeof(record))
+            {
+                bytes[i] = ((const uint8_t*) &record)[position];
+            }
+            else if (position < sizeof(record) + length)
+            {
+                bytes[i] = ((const uint8_t*) data)[position - sizeof(record)];
+            }
+        }
+        if (flash_write(address + done, chunk, step))
+        {
+            flash_probeResult_t probe;
+            if (!flash_refused() || highCyclic_probe(address, size, NULL, &probe) ||
+                probe.erased != size / store->granule)
+            {
+                store->tail = (store->active + 1U) * store->sectorSize;
+            }
+            return true;
+        }
+    }
+    store->tail += size;
+    return false;
+}
+
+/**
+ * @brief continue in the next sector without a valid header, erasing it if necessary
+ *
+ * @return false    OK
+ * @return true     Error: no free sector left
+ */
+static bool openSector(hcStore_t* store)
+{
+    for (uint32_t i = 1; i <= store->sectorCount; i++)
+    {
+        uint32_t sector = (store->active + i) % store->sectorCount;
+        const hcStore_sectorHeader_t* header = sectorHeader(store, sector);
+        if (sector < store->retired || isFormatted(store, sector))
+        {
+            continue;
+        }
+
+        // virgin sectors are used as they are, anything else left by a power loss is erased
+        flash_probeResult_t probe;
+        RETURN_TRUE_IF_TRUE(highCyclic_probe(header, store->sectorSize, NULL, &probe))
+        if (probe.erased != store->sectorSize / store->granule)
+        {
+            RETURN_TRUE_IF_TRUE(flash_erase(store->bank, store->sectorFirst + sector))
+        }
+
+        hcStore_sectorHeader_t format = {
+            .magic = HCSTORE_MAGIC,
+            .version = HCSTORE_VERSION,
+            .used = sizeof(hcStore_sectorHeader_t),
+            .sequence = store->sequence + 1,
+            .indexOffset = HCSTORE_NONE,
+        };
+        format.crc = hcStore_headerCrc(&format);
+        RETURN_TRUE_IF_TRUE(flash_write((void*) header, &format, sizeof(format)))
+
+        store->sequence++;
+        store->active = sector;
+        store->tail = sector * store->sectorSize + sizeof(hcStore_sectorHeader_t);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief get the amount of bytes of the records in a sector that are still current
+ */
+static uint32_t liveBytes(const hcStore_t* store, const uint32_t sector)
+{
+    uint32_t bytes = 0;
+    for (uint32_t i = 0; i < store->indexEntries; i++)
+    {
+        if (store->index[i].offset / store->sectorSize == sector)
+        {
+            const hcStore_recordHeader_t* record = (const hcStore_recordHeader_t*) (store->start + store->index[i].offset);
+            bytes += recordSize(store, record->length);
+        }
+    }
+    return bytes;
+}
+
+static bool advanceSector(hcStore_t* store);
+
+/**
+ * @brief copy the current records of a sector behind the tail, then erase the sector
+ *
+ * The copies are newer than the originals, so a power loss at any point leaves either of them
+ * current. A record that no longer reads back is dropped from the index.
+ *
+ * @return false    OK
+ * @return true     Error: no space for the copies or programming failed
+ */
+static bool relocateSector(hcStore_t* store, const uint32_t sector)
+{
+    if (sector == store->active)
+    {
+        RETURN_TRUE_IF_TRUE(advanceSector(store))
+    }
+
+    for (uint32_t i = 0; i < store->indexEntries; i++)
+    {
+        uint32_t offset = store->index[i].offset;
+        if (offset / store->sectorSize != sector)
+        {
+            continue;
+        }
+
+        const hcStore_recordHeader_t* record = probedRecord(store, offset);
+        if (record == NULL)
+        {
+            store->indexEntries--;
+            memmove(&store->index[i], &store->index[i + 1], (store->indexEntries - i) * sizeof(hcStore_indexEntry_t));
+            i--;
+            continue;
+        }
+
+        if (store->tail + recordSize(store, record->length) > (store->active + 1U) * store->sectorSize)
+        {
+            RETURN_TRUE_IF_TRUE(advanceSector(store))
+        }
+        uint32_t copy = store->tail;
+        RETURN_TRUE_IF_TRUE(appendRecord(store, record->key, record + 1, record->length))
+        store->index[i].offset = (uint16_t) copy;
+    }
+    return flash_erase(store->bank, store->sectorFirst + sector);
+}
+
+/**
+ * @brief free a sector: relocate the sector with the fewest current records into the space left
+ *        in the active sector
+ *
+ * @return false    OK
+ * @return true     Error: the current records do not fit
+ */
+static bool reclaimSector(hcStore_t* store)
+{
+    uint32_t space = (store->active + 1U) * store->sectorSize - store->tail;
+    uint32_t best = store->sectorCount;
+    uint32_t bestBytes = space + 1;
+
+    for (uint32_t sector = 0; sector < store->sectorCount; sector++)
+    {
+        uint32_t bytes = liveBytes(store, sector);
+        if (sector != store->active && sector >= store->retired && bytes < bestBytes)
+        {
+            best = sector;
+            bestBytes = bytes;
+        }
+    }
+    RETURN_TRUE_IF_TRUE(best == store->sectorCount)
+    return relocateSector(store, best);
+}
+
+/**
+ * @brief check if a sector of the store takes new records and has no valid header yet
+ */
+static bool hasFreeSector(const hcStore_t* store)
+{
+    for (uint32_t sector = store->retired; sector < store->sectorCount; sector++)
+    {
+        if (sector != store->active && !isFormatted(store, sector))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief continue in a free sector and keep another one free
+ *
+ * The current records of a reclaimed sector are copied behind the tail, so a sector is reclaimed
+ * right after a new one was opened, while that one still has room for them. Only a store that a
+ * power loss left without a free sector reuses its active sector if nothing in it is current, or
+ * reclaims into the space left in it.
+ *
+ * @return false    OK
+ * @return true     Error: store full
+ */
+static bool advanceSector(hcStore_t* store)
+{
+    if (openSector(store))
+    {
+        // a copy torn right after the sector was opened fills it without anything current in it
+        if (liveBytes(store, store->active) == 0 && sectorHeader(store, store->active)->indexOffset == HCSTORE_NONE)
+        {
+            RETURN_TRUE_IF_TRUE(flash_erase(store->bank, store->sectorFirst + store->active))
+        }
+        else
+        {
+            RETURN_TRUE_IF_TRUE(reclaimSector(store))
+        }
+        RETURN_TRUE_IF_TRUE(openSector(store))
+    }
+
+    // if no sector holds few enough current records, the store is full and the next advance says so
+    if (!hasFreeSector(store))
+    {
+        (void) reclaimSector(store);
+    }
+    return false;
+}
+
+/**
+ * @brief mount a store in high cyclic memory or main flash: replay its records from the newest
+ *        index checkpoint on
+ *
+ * @return false    OK
+ * @return true     Error: region not usable or index checkpoint invalid
+ */
+static bool mountStore(hcStore_t* store, const uint8_t bank, const bool highCyclic, const uint8_t sectorFirst,
+                       const uint8_t sectorCount)
+{
+    RETURN_TRUE_IF_TRUE(sectorCount == 0 || sectorCount > HCSTORE_MAX_SECTORS)
+    RETURN_TRUE_IF_TRUE(flash_checkRegion(bank, highCyclic, sectorFirst, sectorFirst + sectorCount - 1))
+
+    store->start = highCyclic ? FLASH_GEOM_HC_SECTOR_ADDRESS(bank, sectorFirst) : FLASH_GEOM_SECTOR_ADDRESS(bank, sectorFirst);
+    store->sectorSize = highCyclic ? HIGH_CYCLIC_SECTOR_SIZE : FLASH_PAGE_SIZE;
+    store->granule = highCyclic ? 2 : 16;
+    store->bank = bank;
+    store->sectorFirst = sectorFirst;
+    store->sectorCount = sectorCount;
+    store->active = sectorCount - 1;
+    store->retired = 0;
+    store->sequence = 0;
+    store->tail = sectorCount * store->sectorSize;
+    store->indexEntries = 0;
+
+    // the newest sector holding an index checkpoint, replay starts there
+    // the headers of free sectors are not read, virgin cells would fault; their sequence stays 0
+    bool formatted[HCSTORE_MAX_SECTORS];
+    uint32_t sequences[HCSTORE_MAX_SECTORS];
+    uint32_t indexedSequence = 0;
+    for (uint32_t sector = 0; sector < sectorCount; sector++)
+    {
+        const hcStore_sectorHeader_t* header = sectorHeader(store, sector);
+        formatted[sector] = isFormatted(store, sector);
+        sequences[sector] = formatted[sector] ? header->sequence : 0;
+        if (formatted[sector] && header->indexOffset != HCSTORE_NONE && header->sequence >= indexedSequence)
+        {
+            indexedSequence = header->sequence;
+        }
+    }
+
+    // replay sector by sector in the order they were filled
+    for (;;)
+    {
+        uint32_t next = sectorCount;
+        for (uint32_t sector = 0; sector < sectorCount; sector++)
+        {
+            uint32_t sequence = sequences[sector];
+            if (formatted[sector] && sequence > store->sequence && sequence >= indexedSequence &&
+                (next == sectorCount || sequence < sequences[next]))
+            {
+                next = sector;
+            }
+        }
+        if (next == sectorCount)
+        {
+            break;
+        }
+
+        const hcStore_sectorHeader_t* header = sectorHeader(store, next);
+        uint32_t offset = sizeof(hcStore_sectorHeader_t);
+        if (header->sequence == indexedSequence && header->indexOffset != HCSTORE_NONE)
+        {
+            // the checkpoint has to be valid, records in front of it are covered by it
+            offset = header->indexOffset;
+            const hcStore_recordHeader_t* record = (const hcStore_recordHeader_t*) (store->start + next * store->sectorSize + offset);
+            flash_probeResult_t probe;
+            RETURN_TRUE_IF_TRUE((offset & (store->granule - 1U)) != 0 ||
+                                highCyclic_probe(record, recordSize(store, 0), NULL, &probe) ||
+                                probe.valid != recordSize(store, 0) / store->granule || record->key != HCSTORE_KEY_INDEX)
+        }
+
+        store->sequence = header->sequence;
+        store->active = next;
+        store->tail = next * store->sectorSize + replaySector(store, next, offset);
+    }
+    return false;
+}
+
+/**
+ * @brief mount a store: replay its records from the newest index checkpoint on
+ *
+ * Every read of the store is probed first, so virgin sectors and records torn by a power loss
+ * never cause a double ECC fault. Sectors without a valid header are free and get erased and
+ * formatted once records are appended to them.
+ *
+ * @param store the store to mount
+ * @param bank Bank 1 or 2
+ * @param sectorFirst first sector of the store, a high cyclic sector
+ * @param sectorCount amount of sectors
+ * @return false    OK
+ * @return true     Error: region not usable or index checkpoint invalid
+ */
+bool hcStore_mount(hcStore_t* store, const uint8_t bank, const uint8_t sectorFirst, const uint8_t sectorCount)
+{
+    return mountStore(store, bank, true, sectorFirst, sectorCount);
+}
+
+/**
+ * @brief mount a store in main flash sectors, for data that is rarely rewritten
+ *
+ * Same format as in high cyclic memory, but records are padded to whole quad-words and sectors
+ * are 8 KB. Main flash wears out after far fewer erase cycles than high cyclic memory.
+ *
+ * @param store the store to mount
+ * @param bank Bank 1 or 2
+ * @param sectorFirst first sector of the store, a main flash sector
+ * @param sectorCount amount of sectors, up to HCSTORE_MAX_SECTORS
+ * @return false    OK
+ * @return true     Error: region not usable or index checkpoint invalid
+ */
+bool hcStore_mountMain(hcStore_t* store, const uint8_t bank, const uint8_t sectorFirst, const uint8_t sectorCount)
+{
+    return mountStore(store, bank, false, sectorFirst, sectorCount);
+}
+
+/**
+ * @brief find the current value of a key
+ *
+ * @param store a mounted store
+ * @param key the key
+ * @param length receives the payload length, may be NULL
+ * @return the payload in flash, NULL if the key does not exist or its record is corrupt
+ */
+const void* hcStore_find(const hcStore_t* store, const uint16_t key, uint16_t* length)
+{
+    uint32_t position = indexPosition(store, key);
+    if (position == store->indexEntries || store->index[position].key != key)
+    {
+        return NULL;
+    }
+
+    const hcStore_recordHeader_t* record = validRecord(store, store->index[position].offset);
+    if (record == NULL || record->key != key)
+    {
+        return NULL;
+    }
+    if (length != NULL)
+    {
+        *length = record->length;
+    }
+    return record + 1;
+}
+
+/**
+ * @brief copy the current value of a key
+ *
+ * @param store a mounted store
+ * @param key the key
+ * @param buffer receives the payload
+ * @param size size of the buffer, has to match the payload length
+ * @return false    OK
+ * @return true     Error: key not found, corrupt or of a different length
+ */
+bool hcStore_read(const hcStore_t* store, const uint16_t key, void* buffer, const uint16_t size)
+{
+    uint16_t length;
+    const void* payload = hcStore_find(store, key, &length);
+    RETURN_TRUE_IF_TRUE(payload == NULL || length != size)
+    memcpy(buffer, payload, size);
+    return false;
+}
+
+/**
+ * @brief append a new value of a key
+ * @note the key's previous records stay in flash until their sector is reused
+ *
+ * @param store a mounted store
+ * @param key the key, up to HCSTORE_KEY_MAX
+ * @param data the value
+ * @param length amount of bytes, the record has to fit into one sector
+ * @return false    OK
+ * @return true     Error: invalid key, too many keys, store full or programming failed
+ */
+bool hcStore_write(hcStore_t* store, const uint16_t key, const void* data, const uint16_t length)
+{
+    uint32_t size = recordSize(store, length);
+    RETURN_TRUE_IF_TRUE(key > HCSTORE_KEY_MAX)
+    RETURN_TRUE_IF_TRUE(size > store->sectorSize - sizeof(hcStore_sectorHeader_t))
+
+    uint32_t position = indexPosition(store, key);
+    RETURN_TRUE_IF_TRUE(store->indexEntries == HCSTORE_MAX_KEYS &&
+                        (position == store->indexEntries || store->index[position].key != key))
+
+    if (store->tail + size > (store->active + 1U) * store->sectorSize)
+    {
+        RETURN_TRUE_IF_TRUE(advanceSector(store))
+    }
+
+    uint32_t offset = store->tail;
+    RETURN_TRUE_IF_TRUE(appendRecord(store, key, data, length))
+    return indexUpdate(store, key, offset);
+}
+
+/**
+ * @brief rewrite the current records of a sector into fresh space and erase the sector
+ *
+ * @param store a mounted store
+ * @param sector the sector number, one of the store's sectors
+ * @return false    OK
+ * @return true     Error: sector not part of the store, no free sector or programming failed
+ */
+bool hcStore_refresh(hcStore_t* store, const uint8_t sector)
+{
+    RETURN_TRUE_IF_TRUE(sector < store->sectorFirst || sector >= store->sectorFirst + store->sectorCount)
+    return relocateSector(store, sector - store->sectorFirst);
+}
+
+/**
+ * @brief refresh the sectors of a store that collected too many corrected ECC errors
+ * @note call from the background, e.g. the main loop, with flashEcc_enableCorrectionMonitor() enabled
+ *
+ * @param store a mounted store
+ * @return false    OK
+ * @return true     Error: a refresh failed, the sector stays due
+ */
+bool hcStore_maintain(hcStore_t* store)
+{
+    for (uint32_t sector = store->sectorFirst; sector < store->sectorFirst + store->sectorCount; sector++)
+    {
+        if (flashEcc_refreshDue(store->bank, sector))
+        {
+            RETURN_TRUE_IF_TRUE(hcStore_refresh(store, sector))
+            flashEcc_refreshDone(store->bank, sector);
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief erase a sector of the store unless it is erased already
+ *
+ * @return false    OK
+ * @return true     Error
+ */
+static bool eraseSector(const hcStore_t* store, const uint32_t sector)
+{
+    flash_probeResult_t probe;
+    RETURN_TRUE_IF_TRUE(highCyclic_probe(sectorHeader(store, sector), store->sectorSize, NULL, &probe))
+    if (probe.erased == store->sectorSize / store->granule)
+    {
+        return false;
+    }
+    return flash_erase(store->bank, store->sectorFirst + sector);
+}
+
+/**
+ * @brief move the current records out of the sectors below store->retired and out of every
+ *        sector holding an index checkpoint, leaving those sectors erased
+ *
+ * Checkpoints list offsets from the first address of the store, which moves with the area.
+ *
+ * @return false    OK
+ * @return true     Error: the records do not fit into the remaining sectors or programming failed
+ */
+static bool migrateSectors(hcStore_t* store)
+{
+    // copies go behind the tail, which has to be in a sector that stays
+    if (store->active < store->retired)
+    {
+        RETURN_TRUE_IF_TRUE(advanceSector(store))
+    }
+
+    for (uint32_t sector = 0; sector < store->sectorCount; sector++)
+    {
+        bool formatted = isFormatted(store, sector);
+        if (formatted && (sector < store->retired || sectorHeader(store, sector)->indexOffset != HCSTORE_NONE))
+        {
+            RETURN_TRUE_IF_TRUE(relocateSector(store, sector))
+        }
+        else if (sector < store->retired)
+        {
+            // left by a power loss or never used, nothing current in there
+            RETURN_TRUE_IF_TRUE(eraseSector(store, sector))
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief grow or shrink the high cyclic area of the store's bank, the store grows or shrinks with it
+ *
+ * The store has to start at the first sector of the area. Sectors leaving the area are emptied
+ * first: their current records are copied into the remaining sectors and they are erased. Sectors
+ * joining the area have to be erased main flash, their owner moves their contents elsewhere
+ * beforehand. The area is then reprogrammed and the store mounted again to rebuild its index.
+ * A power loss at any point leaves a store that mounts with either the old or the new area.
+ *
+ * @param store a store mounted by hcStore_mount(), starting at the first high cyclic sector of its bank
+ * @param sectorCount new amount of high cyclic sectors of the bank
+ * @return false    OK
+ * @return true     Error: main flash store, store not at the start of the area, records do not fit, main flash
+ *                  sectors not erased or reprogramming failed
+ */
+bool hcStore_resize(hcStore_t* store, const uint8_t sectorCount)
+{
+    uint32_t area = highCyclic_getSectorCount(store->bank);
+    RETURN_TRUE_IF_TRUE(store->granule != 2)
+    RETURN_TRUE_IF_TRUE(store->sectorFirst != FLASH_PAGES_PER_BANK - area)
+    RETURN_TRUE_IF_TRUE(sectorCount > FLASH_GEOM_HC_SECTORS_PER_BANK)
+    RETURN_TRUE_IF_TRUE(store->sectorCount + sectorCount <= area)
+    if (sectorCount == area)
+    {
+        return false;
+    }
+
+    uint8_t sectorFirst = FLASH_PAGES_PER_BANK - sectorCount;
+    uint8_t storeSectors = store->sectorCount + sectorCount - area;
+    if (sectorCount > area)
+    {
+        // joining main flash sectors are taken over, whatever they hold would be lost
+        for (uint32_t sector = sectorFirst; sector < store->sectorFirst; sector++)
+        {
+            flash_probeResult_t probe;
+            RETURN_TRUE_IF_TRUE(flash_checkRegion(store->bank, false, sector, sector))
+            RETURN_TRUE_IF_TRUE(highCyclic_probe((const void*) FLASH_GEOM_SECTOR_ADDRESS(store->bank, sector),
+                                                 FLASH_PAGE_SIZE, NULL, &probe) ||
+                                probe.erased != FLASH_PAGE_SIZE / 16)
+        }
+    }
+    else
+    {
+        store->retired = area - sectorCount;
+    }
+
+    bool failed = migrateSectors(store);
+    store->retired = 0;
+    RETURN_TRUE_IF_TRUE(failed)
+
+    flashOb_transaction_t transaction;
+    flashOb_begin(&transaction);
+    RETURN_TRUE_IF_TRUE(flashOb_stageHighCyclic(&transaction, store->bank, sectorCount))
+    RETURN_TRUE_IF_TRUE(flashOb_commit(&transaction, NULL))
+
+    return hcStore_mount(store, store->bank, sectorFirst, storeSectors);
+}
@@ -0,0 +1,39 @@
+#ifndef HC_STORE_H
+#define HC_STORE_H
+#include "flash.h"
+#include "hc_store_format.h"
+
+// maximum amount of keys of a store, sizes the RAM index
+#ifndef HCSTORE_MAX_KEYS
+#define HCSTORE_MAX_KEYS        64
+#endif
+
+// maximum amount of sectors of a store, record offsets are 16 bit wide and 8 main flash sectors span 64 KB
+#define HCSTORE_MAX_SECTORS     8
+
+typedef struct
+{
+    uint32_t start;                     // first address of the store
+    uint16_t sectorSize;                // HIGH_CYCLIC_SECTOR_SIZE, FLASH_PAGE_SIZE in main flash
+    uint8_t granule;                    // program granule, 2 in high cyclic memory, 16 in main flash
+    uint8_t bank;                       // bank of the store
+    uint8_t sectorFirst;                // first sector of the store
+    uint8_t sectorCount;                // amount of sectors
+    uint8_t active;                     // sector records are appended to, relative to sectorFirst
+    uint8_t retired;                    // sectors below this one, relative to sectorFirst, take no new records
+    uint32_t sequence;                  // highest sector sequence of the store
+    uint32_t tail;                      // offset of the next record from the first address of the store
+    hcStore_indexEntry_t index[HCSTORE_MAX_KEYS];   // current record of every key, sorted by key
+    uint32_t indexEntries;              // amount of index entries
+} hcStore_t;
+
+extern bool hcStore_mount(hcStore_t* store, const uint8_t bank, const uint8_t sectorFirst, const uint8_t sectorCount);
+extern bool hcStore_mountMain(hcStore_t* store, const uint8_t bank, const uint8_t sectorFirst, const uint8_t sectorCount);
+extern const void* hcStore_find(const hcStore_t* store, const uint16_t key, uint16_t* length);
+extern bool hcStore_read(const hcStore_t* store, const uint16_t key, void* buffer, const uint16_t size);
+extern bool hcStore_write(hcStore_t* store, const uint16_t key, const void* data, const uint16_t length);
+extern bool hcStore_refresh(hcStore_t* store, const uint8_t sector);
+extern bool hcStore_maintain(hcStore_t* store);
+extern bool hcStore_resize(hcStore_t* store, const uint8_t sectorCount);
+
+#endif // HC_STORE_H
@@ -0,0 +1,79 @@
+#ifndef HC_STORE_FORMAT_H
+#define HC_STORE_FORMAT_H
+/**
+ * @file hc_store_format.h
+ * @brief on-flash format of the high cyclic record store, shared by the firmware and host tools
+ *
+ * A store spans consecutive high cyclic sectors of one bank. Every sector in use starts with a
+ * sector header, followed by records; sectors not in use stay erased. Records are half-word
+ * aligned and never cross a sector boundary. A store in main flash sectors has the same format,
+ * but its records are quad-word aligned and padded to whole quad-words with 0xFF.
+ *
+ * record:  key, length, crc, payload (length bytes, padded to an even size)
+ *
+ * The newest record of a key is its current value. An index checkpoint is a record with key
+ * HCSTORE_KEY_INDEX, its payload lists the current record of every key sorted by key, so mounting
+ * only has to replay the records behind the newest checkpoint.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include "flash_crc.h"
+
+#define HCSTORE_MAGIC           0x54534348UL    // "HCST"
+#define HCSTORE_VERSION         1
+#define HCSTORE_NONE            0xFFFF
+
+#define HCSTORE_KEY_INDEX       0xFFFE          // index checkpoint
+#define HCSTORE_KEY_MAX         0xFFFD          // highest key usable for data
+
+typedef struct
+{
+    uint32_t magic;             // HCSTORE_MAGIC
+    uint16_t version;           // HCSTORE_VERSION
+    uint16_t used;              // bytes programmed together with the header, incl. the header itself
+    uint32_t sequence;          // order in which sectors were filled, starting at 1
+    uint16_t indexOffset;       // offset of an index checkpoint in this sector, HCSTORE_NONE if there is none
+    uint16_t crc;               // CRC-16 over the header up to this field
+} hcStore_sectorHeader_t;
+
+typedef struct
+{
+    uint16_t key;
+    uint16_t length;            // payload bytes
+    uint16_t crc;               // CRC-16 over key, length and payload
+} hcStore_recordHeader_t;
+
+typedef struct
+{
+    uint16_t key;
+    uint16_t offset;            // offset of the record from the first address of the store
+} hcStore_indexEntry_t;
+
+_Static_assert(sizeof(hcStore_sectorHeader_t) == 16, "sector header layout");
+_Static_assert(sizeof(hcStore_recordHeader_t) == 6, "record header layout");
+_Static_assert(sizeof(hcStore_indexEntry_t) == 4, "index entry layout");
+
+#define HCSTORE_PADDED(length)  (((length) + 1U) & ~1U)
+#define HCSTORE_RECORD_SIZE(length) (sizeof(hcStore_recordHeader_t) + HCSTORE_PADDED(length))
+// record size for a program granule of 2 (high cyclic memory) or 16 bytes (main flash)
+#define HCSTORE_RECORD_SIZE_IN(length, granule) \
+    ((sizeof(hcStore_recordHeader_t) + (length) + (granule) - 1U) & ~((granule) - 1U))
+
+/**
+ * @brief CRC of a sector header
+ */
+static inline uint16_t hcStore_headerCrc(const hcStore_sectorHeader_t* header)
+{
+    return flashCrc_crc16(FLASH_CRC16_INIT, header, offsetof(hcStore_sectorHeader_t, crc));
+}
+
+/**
+ * @brief CRC of a record, the payload follows its header directly
+ */
+static inline uint16_t hcStore_recordCrc(const hcStore_recordHeader_t* record, const void* payload)
+{
+    uint16_t crc = flashCrc_crc16(FLASH_CRC16_INIT, record, offsetof(hcStore_recordHeader_t, crc));
+    return flashCrc_crc16(crc, payload, record->length);
+}
+
+#endif // HC_STORE_FORMAT_H
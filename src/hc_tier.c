@@ -0,0 +1,212 @@
+#include <string.h>
+#include "hc_tier.h"
+
+#define RETURN_TRUE_IF_TRUE(cond) if(cond) {return true;}
+
+/**
+ * @brief get the current value of a key in one store, an empty record means it is not there
+ */
+static const void* storeValue(const hcStore_t* store, const uint16_t key, uint16_t* length)
+{
+    uint16_t size;
+    const void* payload = hcStore_find(store, key, &size);
+    if (payload == NULL || size == 0)
+    {
+        return NULL;
+    }
+    if (length != NULL)
+    {
+        *length = size;
+    }
+    return payload;
+}
+
+/**
+ * @brief get the usage entry of a key, inserting it if it does not exist yet
+ *
+ * @return the entry, NULL if the table is full
+ */
+static hcTier_usage_t* usageEntry(hcTier_t* tier, const uint16_t key)
+{
+    // binary search, entries are sorted by key
+    uint32_t low = 0;
+    uint32_t high = tier->usageEntries;
+    while (low < high)
+    {
+        uint32_t middle = (low + high) / 2;
+        if (tier->usage[middle].key < key)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    if (low == tier->usageEntries || tier->usage[low].key != key)
+    {
+        if (tier->usageEntries == HCSTORE_MAX_KEYS)
+        {
+            return NULL;
+        }
+        memmove(&tier->usage[low + 1], &tier->usage[low], (tier->usageEntries - low) * sizeof(hcTier_usage_t));
+        tier->usageEntries++;
+        tier->usage[low] = (hcTier_usage_t) {.key = key};
+    }
+    return &tier->usage[low];
+}
+
+/**
+ * @brief move a key from one store to the other: write its value to the destination, then
+ *        empty it in the source
+ *
+ * @return false    OK
+ * @return true     Error: the destination is full or programming failed
+ */
+static bool moveKey(hcStore_t* from, hcStore_t* to, const uint16_t key, const void* data, const uint16_t length)
+{
+    RETURN_TRUE_IF_TRUE(hcStore_write(to, key, data, length))
+    if (storeValue(from, key, NULL) != NULL)
+    {
+        RETURN_TRUE_IF_TRUE(hcStore_write(from, key, NULL, 0))
+    }
+    return false;
+}
+
+/**
+ * @brief set up the tiers over two mounted stores
+ *
+ * Keys found in the hot store start their statistics there and turn cold unless they are written.
+ *
+ * @param tier the tiers
+ * @param hot a store mounted by hcStore_mount()
+ * @param cold a store mounted by hcStore_mountMain()
+ */
+void hcTier_init(hcTier_t* tier, hcStore_t* hot, hcStore_t* cold)
+{
+    tier->hot = hot;
+    tier->cold = cold;
+    tier->usageEntries = 0;
+
+    for (uint32_t i = 0; i < hot->indexEntries; i++)
+    {
+        if (storeValue(hot, hot->index[i].key, NULL) != NULL)
+        {
+            (void) usageEntry(tier, hot->index[i].key);
+        }
+    }
+}
+
+/**
+ * @brief find the current value of a key in either store
+ *
+ * @param tier the tiers
+ * @param key the key
+ * @param length receives the payload length, may be NULL
+ * @return the payload in flash, NULL if the key does not exist or its record is corrupt
+ */
+const void* hcTier_find(const hcTier_t* tier, const uint16_t key, uint16_t* length)
+{
+    // a key in both stores was interrupted while moving, the hot store has the newer value
+    const void* payload = storeValue(tier->hot, key, length);
+    if (payload == NULL)
+    {
+        payload = storeValue(tier->cold, key, length);
+    }
+    return payload;
+}
+
+/**
+ * @brief copy the current value of a key
+ *
+ * @param tier the tiers
+ * @param key the key
+ * @param buffer receives the payload
+ * @param size size of the buffer, has to match the payload length
+ * @return false    OK
+ * @return true     Error: key not found, corrupt or of a different length
+ */
+bool hcTier_read(const hcTier_t* tier, const uint16_t key, void* buffer, const uint16_t size)
+{
+    uint16_t length;
+    const void* payload = hcTier_find(tier, key, &length);
+    RETURN_TRUE_IF_TRUE(payload == NULL || length != size)
+    memcpy(buffer, payload, size);
+    return false;
+}
+
+/**
+ * @brief check if a key is kept in the hot store
+ */
+bool hcTier_isHot(const hcTier_t* tier, const uint16_t key)
+{
+    return storeValue(tier->hot, key, NULL) != NULL;
+}
+
+/**
+ * @brief write a new value of a key to the store of its tier, moving the key to the hot store
+ *        once it is written often enough
+ *
+ * @param tier the tiers
+ * @param key the key, up to HCSTORE_KEY_MAX
+ * @param data the value
+ * @param length amount of bytes, at least 1
+ * @return false    OK
+ * @return true     Error: empty value, too many keys, store full or programming failed
+ */
+bool hcTier_write(hcTier_t* tier, const uint16_t key, const void* data, const uint16_t length)
+{
+    RETURN_TRUE_IF_TRUE(length == 0)
+    hcTier_usage_t* usage = usageEntry(tier, key);
+    RETURN_TRUE_IF_TRUE(usage == NULL)
+
+    if (usage->writes < UINT8_MAX)
+    {
+        usage->writes++;
+    }
+    usage->idle = 0;
+
+    if (hcTier_isHot(tier, key))
+    {
+        return hcStore_write(tier->hot, key, data, length);
+    }
+    if (usage->writes >= HCTIER_HOT_WRITES)
+    {
+        return moveKey(tier->cold, tier->hot, key, data, length);
+    }
+    return hcStore_write(tier->cold, key, data, length);
+}
+
+/**
+ * @brief end a period: move hot keys that were not written for HCTIER_COLD_PERIODS periods to
+ *        the cold store and restart counting writes
+ *
+ * @param tier the tiers
+ * @return false    OK
+ * @return true     Error: a key could not be moved, it stays hot and is moved by a later call
+ */
+bool hcTier_age(hcTier_t* tier)
+{
+    bool error = false;
+    for (uint32_t i = 0; i < tier->usageEntries; i++)
+    {
+        hcTier_usage_t* usage = &tier->usage[i];
+        uint16_t length;
+        const void* payload = storeValue(tier->hot, usage->key, &length);
+
+        if (payload != NULL && usage->writes == 0)
+        {
+            if (usage->idle < UINT8_MAX)
+            {
+                usage->idle++;
+            }
+            if (usage->idle >= HCTIER_COLD_PERIODS)
+            {
+                error |= moveKey(tier->hot, tier->cold, usage->key, payload, length);
+            }
+        }
+        usage->writes = 0;
+    }
+    return error;
+}
@@ -0,0 +1,51 @@
+#ifndef HC_TIER_H
+#define HC_TIER_H
+/**
+ * @file hc_tier.h
+ * @brief placement of records by update frequency: hot keys in high cyclic memory, cold keys in main flash
+ *
+ * Two record stores back one key space: a hot one in high cyclic sectors and a cold one in main
+ * flash sectors, mounted with hcStore_mount() and hcStore_mountMain(). New keys start cold. A key
+ * written HCTIER_HOT_WRITES times within one period moves to the hot store; a hot key not written
+ * for HCTIER_COLD_PERIODS periods moves back. The caller defines the period by calling
+ * hcTier_age(), e.g. once a minute from the main loop.
+ *
+ * A key leaves a store by an empty record, so values written through the tiers are never empty.
+ * Moving writes the destination first and empties the source afterwards; a power loss in between
+ * leaves the key in both stores with the same or a newer value in the hot one, which wins.
+ */
+#include "hc_store.h"
+
+// writes of a key within one period that move it to the hot store
+#ifndef HCTIER_HOT_WRITES
+#define HCTIER_HOT_WRITES       4
+#endif
+
+// periods without a write that move a hot key to the cold store
+#ifndef HCTIER_COLD_PERIODS
+#define HCTIER_COLD_PERIODS     8
+#endif
+
+typedef struct
+{
+    uint16_t key;
+    uint8_t writes;                     // writes in the current period, saturating
+    uint8_t idle;                       // periods without a write
+} hcTier_usage_t;
+
+typedef struct
+{
+    hcStore_t* hot;                     // store in high cyclic memory
+    hcStore_t* cold;                    // store in main flash
+    hcTier_usage_t usage[HCSTORE_MAX_KEYS];     // write statistics, sorted by key
+    uint32_t usageEntries;              // amount of usage entries
+} hcTier_t;
+
+extern void hcTier_init(hcTier_t* tier, hcStore_t* hot, hcStore_t* cold);
+extern const void* hcTier_find(const hcTier_t* tier, const uint16_t key, uint16_t* length);
+extern bool hcTier_read(const hcTier_t* tier, const uint16_t key, void* buffer, const uint16_t size);
+extern bool hcTier_write(hcTier_t* tier, const uint16_t key, const void* data, const uint16_t length);
+extern bool hcTier_isHot(const hcTier_t* tier, const uint16_t key);
+extern bool hcTier_age(hcTier_t* tier);
+
+#endif // HC_TIER_H
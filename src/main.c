@@ -1,6 +1,8 @@
 
 #include "stm32h563.h"
+#include "clock.h"
 #include "flash.h"
+#include "flash_cache.h"
 
 //#define TEST1
 #define TEST2
@@ -31,7 +33,14 @@ volatile __USED bool data_section_integrity;
 
 int main (void)
 {
-    highCyclic_setArea(8, 8);
+    clock_init();
+
+    // configure the high cyclic area on the first boot only, later hcStore_resize() may have changed it
+    if (highCyclic_getSectorCount(1) == 0 && highCyclic_getSectorCount(2) == 0)
+    {
+        highCyclic_setArea(8, 8);
+    }
+    flashCache_enable();
 
     // ------------------------------------------------------------------------
     // Check integrity of test_data section